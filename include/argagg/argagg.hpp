@@ -34,17 +34,50 @@
 #include <algorithm>
 #include <array>
 #include <cctype>
+#include <cerrno>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <iterator>
+#include <memory>
+#include <new>
 #include <ostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+// std::string_view arguments are accepted by the range overloads of parse()
+// when compiling as C++17 or later.
+#if __cplusplus >= 201703L
+#define ARGAGG_HAS_STRING_VIEW 1
+#include <string_view>
+#endif
+
+// Response files are memory-mapped on POSIX systems and read into memory
+// elsewhere or when ARGAGG_DISABLE_MMAP is defined.
+#if !defined(ARGAGG_DISABLE_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define ARGAGG_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <cstdio>
+#endif
+
+// Vectorized lexing is only implemented for x86 with GCC and Clang since it
+// relies on their target attributes and CPU detection builtins.
+#if !defined(ARGAGG_DISABLE_SIMD) && \
+    (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define ARGAGG_HAS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
 
 /**
  * @brief
@@ -89,9 +122,12 @@
  * Options aren't the only thing parsed though. Positional arguments are also
  * parsed. Thus a parser produces a result that contains both option results
  * and positional arguments. The parser results are represented by the
- * argagg::parser_results struct. All option results are stored in a mapping
- * from option name to the argagg::option_results. All positional arguments are
- * simply stored in a vector of C-strings.
+ * argagg::parser_results struct. Option results are stored in a vector of
+ * argagg::option_results keyed by the definition's position in the parser's
+ * definitions vector (its "ordinal"), with entries only for the options that
+ * actually occurred. A mapping from option name to ordinal is built once per
+ * parser and shared with the results so options can still be looked up by
+ * name. All positional arguments are simply stored in a vector of C-strings.
  */
 namespace argagg {
 
@@ -119,6 +155,17 @@ struct unexpected_option_error
 };
 
 
+/**
+ * @brief
+ * This exception is thrown when long flag abbreviations are allowed and an
+ * abbreviated long flag is the start of the flags of several options.
+ */
+struct ambiguous_option_error
+: public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+
 /**
  * @brief
  * This exception is thrown when an option requires an argument but is not
@@ -155,6 +202,50 @@ struct unknown_option
 };
 
 
+/**
+ * @brief
+ * This exception is thrown when a command line string given to
+ * split_command_line() ends inside of quotes or with an escaping backslash.
+ */
+struct command_line_error
+: public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+
+/**
+ * @brief
+ * This exception is thrown when a response file exists but can't be read or
+ * when response files are nested too deeply.
+ */
+struct response_file_error
+: public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+
+/**
+ * @brief
+ * This exception is thrown when a subcommand_parser finds a subcommand that
+ * doesn't exist.
+ */
+struct unexpected_subcommand_error
+: public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+
+/**
+ * @brief
+ * This exception is thrown when a multicall_registry is invoked under a
+ * program name it doesn't know.
+ */
+struct unexpected_program_error
+: public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+
 /**
  * @brief
  * The set of template instantiations that convert C-strings to other types for
@@ -319,12 +410,45 @@ struct option_result {
 };
 
 
+/**
+ * @brief
+ * A contiguous run of option parse results inside the @ref
+ * parser_results::values buffer. Offers the element access part of the
+ * std::vector interface.
+ */
+struct option_result_span {
+
+  /**
+   * @brief
+   * The first option parse result in the run. This is nullptr for an empty
+   * run.
+   */
+  option_result* first;
+
+  /**
+   * @brief
+   * The number of option parse results in the run.
+   */
+  std::size_t len;
+
+  // std::vector style element access.
+  option_result* begin() const;
+  option_result* end() const;
+  option_result* data() const;
+  std::size_t size() const;
+  bool empty() const;
+  option_result& operator [] (std::size_t index) const;
+  option_result& front() const;
+  option_result& back() const;
+
+};
+
+
 /**
  * @brief
  * Represents multiple option parse results for a single option. If treated as
- * a single parse result it defaults to the last parse result. Note that an
- * instance of this struct is always created even if no option results are
- * parsed for a given definition. In that case it will simply be empty.
+ * a single parse result it defaults to the last parse result. Options that
+ * didn't show up are answered with an empty instance of this struct.
  *
  * To check if the associated option showed up at all simply use the implicit
  * boolean conversion or check if count() is greater than zero.
@@ -333,9 +457,10 @@ struct option_results {
 
   /**
    * @brief
-   * All option parse results for this option.
+   * All option parse results for this option. They live in the @ref
+   * parser_results::values buffer of the results this came from.
    */
-  std::vector<option_result> all;
+  option_result_span all;
 
   /**
    * @brief
@@ -405,996 +530,8088 @@ struct option_results {
 
 /**
  * @brief
- * Represents all results of the parser including options and positional
- * arguments.
+ * A lightweight reference to an option definition by its ordinal (its
+ * position in the definitions vector). Handles are returned by parser::add()
+ * and compiled_parser::handle() and are looked up directly in @ref
+ * parser_results::ordinals so reading an option through a handle involves no
+ * hashing, allocation, or exceptions.
  */
-struct parser_results {
+struct option_handle {
 
   /**
    * @brief
-   * Returns the name of the program from the original arguments list. This is
-   * always the first argument.
+   * The ordinal of the definition this handle refers to.
    */
-  const char* program;
+  std::size_t index;
 
-  /**
-   * @brief
-   * Maps from definition name to the structure which contains the parser
-   * results for that definition.
-   */
-  std::unordered_map<std::string, option_results> options;
+};
 
-  /**
-   * @brief
-   * Vector of positional arguments.
-   */
-  std::vector<const char*> pos;
 
-  /**
-   * @brief
-   * Used to check if an option was specified at all.
-   */
-  bool has_option(const std::string& name) const;
+/**
+ * @brief
+ * An @ref option_handle that also carries the type its option's argument
+ * should be converted to. Reading it with parser_results::get() converts the
+ * last argument using argagg::convert::arg<T>().
+ */
+template <typename T>
+struct typed_option_handle {
 
   /**
    * @brief
-   * Get the parser results for the given definition. If the definition never
-   * showed up then the exception from the unordered_map access will bubble
-   * through so check if the flag exists in the first place with has_option().
+   * The ordinal of the definition this handle refers to.
    */
-  option_results& operator [] (const std::string& name);
+  std::size_t index;
 
   /**
    * @brief
-   * Get the parser results for the given definition. If the definition never
-   * showed up then the exception from the unordered_map access will bubble
-   * through so check if the flag exists in the first place with has_option().
+   * Drops the type so the handle can be used wherever an untyped @ref
+   * option_handle is expected.
    */
-  const option_results& operator [] (const std::string& name) const;
+  operator option_handle () const;
 
-  /**
-   * @brief
-   * Gets the number of positional arguments.
-   */
-  std::size_t count() const;
+};
 
-  /**
-   * @brief
-   * Gets a positional argument by index.
-   */
-  const char* operator [] (std::size_t index) const;
+
+/**
+ * @brief
+ * Maps from definition name to the definition's ordinal, that is its position
+ * in the definitions vector. Built once by validate_definitions() and shared
+ * with every argagg::parser_results parsed using it.
+ */
+using option_name_index = std::unordered_map<std::string, std::size_t>;
+
+
+/**
+ * @brief
+ * Interface for the memory that parser_results keeps its option storage in.
+ * Mirrors C++17's std::pmr::memory_resource.
+ */
+struct results_memory {
+
+  virtual ~results_memory() = default;
 
   /**
    * @brief
-   * Gets a positional argument converted to the given type.
+   * Allocates bytes with the given alignment or throws std::bad_alloc.
    */
-  template <typename T>
-  T as(std::size_t i = 0) const;
+  virtual void* allocate(std::size_t bytes, std::size_t alignment) = 0;
 
   /**
    * @brief
-   * Gets all positional arguments converted to the given type.
+   * Returns memory previously obtained from allocate().
    */
-  template <typename T>
-  std::vector<T> all_as() const;
+  virtual void deallocate(
+    void* p, std::size_t bytes, std::size_t alignment) = 0;
 
 };
 
 
 /**
  * @brief
- * An option definition which essentially represents what an option is.
+ * A results_memory that hands out memory from large blocks by bumping a
+ * pointer and never frees individual allocations. Everything is freed at
+ * once by release() or the destructor, so tearing down results that used
+ * this arena costs a single free per block (usually one).
  */
-struct definition {
+struct monotonic_arena : public results_memory {
 
   /**
    * @brief
-   * Name of the option. Option parser results are keyed by this name.
+   * Creates an arena whose first block, allocated lazily, has the given size
+   * (or room for at least one byte after the block header). Later blocks
+   * double in size.
    */
-  const std::string name;
+  explicit monotonic_arena(std::size_t block_size = 4096);
 
-  /**
-   * @brief
-   * List of strings to match that correspond to this option. Should be fully
-   * specified with hyphens (e.g. "-v" or "--verbose").
-   */
-  std::vector<std::string> flags;
+  monotonic_arena(const monotonic_arena&) = delete;
+  monotonic_arena& operator = (const monotonic_arena&) = delete;
 
-  /**
-   * @brief
-   * Help string for this option.
-   */
-  std::string help;
+  ~monotonic_arena();
 
-  /**
-   * @brief
-   * Number of arguments this option requires. Must be 0 or 1. All other values
-   * have undefined behavior. Okay, the code actually works with positive
-   * values in general, but it's unorthodox command line behavior.
-   */
-  unsigned int num_args;
+  void* allocate(std::size_t bytes, std::size_t alignment) override;
 
   /**
    * @brief
-   * Returns true if this option does not want any arguments.
+   * Does nothing, memory is only reclaimed by release().
    */
-  bool wants_no_arguments() const;
+  void deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
 
   /**
    * @brief
-   * Returns true if this option requires arguments.
+   * Frees every block. Anything allocated from the arena must no longer be
+   * in use.
    */
-  bool requires_arguments() const;
+  void release();
+
+private:
+
+  struct block_header {
+    block_header* next;
+  };
+
+  block_header* blocks_;
+  char* cursor_;
+  char* end_;
+  std::size_t next_block_size_;
 
 };
 
 
 /**
  * @brief
- * Checks whether or not a command line argument should be processed as an
- * option flag. This is very similar to is_valid_flag_definition() but must
- * allow for short flag groups (e.g. "-abc") and equal-assigned long flag
- * arguments (e.g. "--output=foo.txt").
+ * A standard allocator that draws from a results_memory, or from the global
+ * operator new when the memory is nullptr. Used by the containers in
+ * parser_results.
  */
-bool cmd_line_arg_is_option_flag(
-  const char* s);
+template <typename T>
+struct results_allocator {
+
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  /**
+   * @brief
+   * Where memory comes from, nullptr for the global operator new.
+   */
+  results_memory* memory;
+
+  results_allocator(results_memory* memory = nullptr) noexcept;
+
+  template <typename U>
+  results_allocator(const results_allocator<U>& other) noexcept;
+
+  T* allocate(std::size_t n);
+
+  void deallocate(T* p, std::size_t n) noexcept;
+
+};
+
+
+template <typename T, typename U>
+bool operator == (const results_allocator<T>& a, const results_allocator<U>& b);
+
+
+template <typename T, typename U>
+bool operator != (const results_allocator<T>& a, const results_allocator<U>& b);
 
 
 /**
  * @brief
- * Checks whether a flag in an option definition is valid. I suggest reading
- * through the function source to understand what dictates a valid.
+ * A std::vector that allocates through a results_allocator.
  */
-bool is_valid_flag_definition(
-  const char* s);
+template <typename T>
+using results_vector = std::vector<T, results_allocator<T>>;
 
 
 /**
  * @brief
- * Tests whether or not a valid flag is short. Assumes the provided cstring is
- * already a valid flag.
+ * A span of the original argv, such as the arguments left unparsed by a
+ * parse that stops early (see @ref stop_at). When the original argv is
+ * terminated by a null pointer, as main()'s is, so is the span, which means
+ * data can be handed straight to execv().
  */
-bool flag_is_short(
-  const char* s);
+struct argv_span {
+
+  const char** data;
+
+  std::size_t size;
+
+  const char** begin() const;
+
+  const char** end() const;
+
+  bool empty() const;
+
+};
 
 
 /**
  * @brief
- * Contains two maps which aid in option parsing. The first map, @ref
- * short_map, maps from a short flag (just a character) to a pointer to the
- * original @ref definition that the flag represents. The second map, @ref
- * long_map, maps from a long flag (an std::string) to a pointer to the
- * original @ref definition that the flag represents.
- *
- * This object is usually a temporary that only exists during the parsing
- * operation. It is typically constructed using @ref validate_definitions().
+ * Where the parse(int, const char**, stop_at) overloads stop parsing. The
+ * arguments after that point are not parsed or copied, they are left in
+ * parser_results::remainder.
  */
-struct parser_map {
+enum class stop_at {
 
   /**
    * @brief
-   * Maps from a short flag (just a character) to a pointer to the original
-   * @ref definition that the flag represents.
+   * At the first positional argument, like getopt() with POSIXLY_CORRECT
+   * set. The positional argument starts the remainder. A "--" before it also
+   * stops parsing and the remainder starts after the "--".
    */
-  std::array<const definition*, 256> short_map;
+  first_positional,
 
   /**
    * @brief
-   * Maps from a long flag (an std::string) to a pointer to the original @ref
-   * definition that the flag represents.
+   * At "--". The remainder starts after it and positional arguments before
+   * it go to parser_results::pos as usual.
    */
-  std::unordered_map<std::string, const definition*> long_map;
+  separator,
+
+};
+
+
+/**
+ * @brief
+ * What the parse() overloads taking a forwarded argument vector pass through
+ * to it instead of handling themselves, for wrapper programs.
+ *
+ * An argument is forwarded as an unknown option when it is a long flag that
+ * isn't defined, along with any "=argument" in it, or a short flag group
+ * whose first flag isn't defined, along with the rest of the group (as in
+ * "-Wall" or "-I/usr/include"). Arguments of unknown options that are
+ * separate command line arguments can't be told apart from positional
+ * arguments so they aren't forwarded with them. An undefined short flag
+ * after defined ones in a group can't be forwarded on its own and is still
+ * an error.
+ */
+enum class forward {
 
   /**
    * @brief
-   * Returns true if the provided short flag exists in the map object.
+   * Only unknown options. Positional arguments go to parser_results::pos.
    */
-  bool known_short_flag(
-    const char flag) const;
+  unknown_options,
 
   /**
    * @brief
-   * If the short flag exists in the map object then it is returned by this
-   * method. If it doesn't then nullptr will be returned.
+   * Unknown options and positional arguments, including "--" and everything
+   * after it, keeping their order. parser_results::pos stays empty.
    */
-  const definition* get_definition_for_short_flag(
-    const char flag) const;
+  unknown_options_and_positionals,
+
+};
+
+
+/**
+ * @brief
+ * Represents all results of the parser including options and positional
+ * arguments.
+ *
+ * Every option parse result lives in one contiguous buffer, @ref values,
+ * grouped by definition. Each entry in @ref options is an offset and count
+ * into that buffer (a compressed sparse row layout). The option storage can
+ * be placed in a caller supplied results_memory such as a monotonic_arena.
+ */
+struct parser_results {
 
   /**
    * @brief
-   * Returns true if the provided long flag exists in the map object.
+   * Creates empty results whose option storage uses the global operator
+   * new.
    */
-  bool known_long_flag(
-    const std::string& flag) const;
+  parser_results();
 
   /**
    * @brief
-   * If the long flag exists in the map object then it is returned by this
-   * method. If it doesn't then nullptr will be returned.
+   * Creates empty results whose option storage (@ref options, @ref
+   * ordinals, @ref values and @ref value_ordinals) is allocated from the
+   * given memory, which must outlive the results. Parse into these with
+   * parse_into().
    */
-  const definition* get_definition_for_long_flag(
-    const std::string& flag) const;
+  explicit parser_results(results_memory* memory);
 
-};
+  /**
+   * @brief
+   * Copies the results, pointing the copied option results at the copied
+   * @ref values buffer.
+   */
+  parser_results(const parser_results& other);
 
+  parser_results(parser_results&& other) = default;
 
-/**
- * @brief
- * Validates a collection (specifically an std::vector) of @ref definition
- * objects by checking if the contained flags are valid. If the set of @ref
- * definition objects is not valid then an exception is thrown. Upon successful
- * validation a @ref parser_map object is returned.
- */
-parser_map validate_definitions(
-  const std::vector<definition>& definitions);
+  parser_results& operator = (const parser_results& other);
 
+  parser_results& operator = (parser_results&& other) = default;
 
-/**
- * @brief
- * A list of option definitions used to inform how to parse arguments.
- */
-struct parser {
+  /**
+   * @brief
+   * Returns the name of the program from the original arguments list. This is
+   * always the first argument.
+   */
+  const char* program;
 
   /**
    * @brief
-   * Vector of the option definitions which inform this parser how to parse
-   * the command line arguments.
+   * The parser results for each definition that occurred on the command
+   * line, in ascending order of definition ordinal (see @ref ordinals).
+   * Definitions that didn't occur have no entry so parsing costs nothing per
+   * definition. The accessors below answer for those with empty results.
    */
-  std::vector<definition> definitions;
+  results_vector<option_results> options;
 
   /**
    * @brief
-   * Parses the provided command line arguments and returns the results as
-   * @ref parser_results.
-   *
-   * @note
-   * This method is not thread-safe and assumes that no modifications are made
-   * to the definitions member field during the extent of this method call.
+   * The ordinal of the definition for each entry in @ref options, in
+   * ascending order.
    */
-  parser_results parse(int argc, const char** argv) const;
+  results_vector<std::size_t> ordinals;
 
   /**
    * @brief
-   * Through strict interpretation of pointer casting rules, despite this being
-   * a safe operation, C++ doesn't allow implicit casts from <tt>char**</tt> to
-   * <tt>const char**</tt> so here's an overload that performs a const_cast,
-   * which is typically frowned upon but is safe here.
+   * Every option parse result, grouped by definition in the same order as
+   * @ref options.
    */
-  parser_results parse(int argc, char** argv) const;
+  results_vector<option_result> values;
+
+  /**
+   * @brief
+   * The ordinal of the definition for each entry in @ref values.
+   */
+  results_vector<std::size_t> value_ordinals;
+
+  /**
+   * @brief
+   * Vector of positional arguments.
+   */
+  std::vector<const char*> pos;
+
+  /**
+   * @brief
+   * Length of each positional argument, parallel to @ref pos, so that they
+   * don't have to be measured again.
+   */
+  std::vector<std::size_t> pos_lengths;
+
+  /**
+   * @brief
+   * The arguments left unparsed when parsing stopped early, see @ref
+   * stop_at. This points into the original argv and is empty when parsing
+   * went through all of the arguments.
+   */
+  argv_span remainder;
+
+  /**
+   * @brief
+   * Maps from definition name to definition ordinal. Shared with the @ref
+   * parser_map that produced these results. This is nullptr for default
+   * constructed results.
+   */
+  std::shared_ptr<const option_name_index> names;
+
+  /**
+   * @brief
+   * Used to check if an option was specified at all.
+   */
+  bool has_option(const std::string& name) const;
+
+  /**
+   * @brief
+   * Used to check if an option was specified at all. The handle must come
+   * from the parser that produced these results.
+   */
+  bool has_option(option_handle handle) const;
+
+  /**
+   * @brief
+   * Gets the ordinal of the definition with the given name as a handle. If
+   * there is no definition with the given name then an argagg::unknown_option
+   * exception is thrown.
+   */
+  option_handle handle(const std::string& name) const;
+
+  /**
+   * @brief
+   * Returns the parser results for the given definition or nullptr if it
+   * didn't occur. The handle must come from the parser that produced these
+   * results.
+   */
+  const option_results* find(option_handle handle) const;
+
+  /**
+   * @brief
+   * Returns the parser results for the given definition, adding empty
+   * results for it if it didn't occur. Adding results may invalidate
+   * references previously returned by the non-const accessors.
+   */
+  option_results& emplace(option_handle handle);
+
+  /**
+   * @brief
+   * Get the parser results for the given definition. If there is no
+   * definition with the given name then an argagg::unknown_option exception
+   * is thrown. See emplace() for definitions that didn't occur.
+   */
+  option_results& operator [] (const std::string& name);
+
+  /**
+   * @brief
+   * Get the parser results for the given definition. If there is no
+   * definition with the given name then an argagg::unknown_option exception
+   * is thrown.
+   */
+  const option_results& operator [] (const std::string& name) const;
+
+  /**
+   * @brief
+   * Get the parser results for the given definition. The handle must come
+   * from the parser that produced these results. See emplace() for
+   * definitions that didn't occur.
+   */
+  option_results& operator [] (option_handle handle);
+
+  /**
+   * @brief
+   * Get the parser results for the given definition. The handle must come
+   * from the parser that produced these results. Definitions that didn't
+   * occur get a shared empty result.
+   */
+  const option_results& operator [] (option_handle handle) const;
+
+  /**
+   * @brief
+   * Converts the last argument of the given option to the handle's type. See
+   * option_results::as().
+   */
+  template <typename T>
+  T get(typed_option_handle<T> handle) const;
+
+  /**
+   * @brief
+   * Converts the last argument of the given option to the handle's type or
+   * returns the provided default value. See option_results::as(const T&).
+   */
+  template <typename T>
+  T get(typed_option_handle<T> handle, const T& t) const;
+
+  /**
+   * @brief
+   * Gets the number of positional arguments.
+   */
+  std::size_t count() const;
+
+  /**
+   * @brief
+   * Gets a positional argument by index.
+   */
+  const char* operator [] (std::size_t index) const;
+
+  /**
+   * @brief
+   * Gets a positional argument converted to the given type.
+   */
+  template <typename T>
+  T as(std::size_t i = 0) const;
+
+  /**
+   * @brief
+   * Gets all positional arguments converted to the given type.
+   */
+  template <typename T>
+  std::vector<T> all_as() const;
+
+};
+
+
+/**
+ * @brief
+ * An option definition which essentially represents what an option is.
+ */
+struct definition {
+
+  /**
+   * @brief
+   * Name of the option. Option parser results are keyed by this name.
+   */
+  const std::string name;
+
+  /**
+   * @brief
+   * List of strings to match that correspond to this option. Should be fully
+   * specified with hyphens (e.g. "-v" or "--verbose"). Flags ending in '*'
+   * (e.g. "-Wl,*") are prefix flags, see flag_is_prefix().
+   */
+  std::vector<std::string> flags;
+
+  /**
+   * @brief
+   * Help string for this option.
+   */
+  std::string help;
+
+  /**
+   * @brief
+   * Number of arguments this option requires. Must be 0 or 1. All other values
+   * have undefined behavior. Okay, the code actually works with positive
+   * values in general, but it's unorthodox command line behavior.
+   */
+  unsigned int num_args;
+
+  /**
+   * @brief
+   * Returns true if this option does not want any arguments.
+   */
+  bool wants_no_arguments() const;
+
+  /**
+   * @brief
+   * Returns true if this option requires arguments.
+   */
+  bool requires_arguments() const;
+
+};
+
+
+/**
+ * @brief
+ * Character class bits returned by char_class().
+ */
+constexpr unsigned char char_class_alnum = 0x1;
+constexpr unsigned char char_class_hyphen = 0x2;
+constexpr unsigned char char_class_equal_sign = 0x4;
+
+
+/**
+ * @brief
+ * Classifies a character with a 256-entry table built at compile time. Only
+ * ASCII letters and digits are alpha-numeric so, unlike std::isalnum(), the
+ * result doesn't depend on the current locale.
+ */
+constexpr unsigned char char_class(
+  char c);
+
+
+/**
+ * @brief
+ * Locale independent replacement for std::isalnum() used when validating
+ * and lexing flags.
+ */
+constexpr bool char_is_alnum(
+  char c);
+
+
+/**
+ * @brief
+ * The kinds of command line argument recognized by lex_arg().
+ */
+enum class arg_kind {
+
+  /**
+   * @brief
+   * Anything that isn't flag-like, including "-" and malformed flags like
+   * "---a" or "--a@b".
+   */
+  positional,
+
+  /**
+   * @brief
+   * A single hyphen followed by an alpha-numeric character, which is a short
+   * flag, a group of short flags, or a short flag with an attached argument
+   * (e.g. "-v", "-abc", "-I/usr/local/include").
+   */
+  short_group,
+
+  /**
+   * @brief
+   * Two hyphens followed by a valid long flag name, optionally followed by
+   * an equal sign and an argument (e.g. "--verbose", "--output=foo.txt").
+   */
+  long_flag,
+
+  /**
+   * @brief
+   * Exactly "--", which stops flag processing.
+   */
+  terminator,
+
+};
+
+
+/**
+ * @brief
+ * A command line argument classified by lex_arg(). All spans point into the
+ * original argument.
+ */
+struct arg_token {
+
+  /**
+   * @brief
+   * What kind of argument this is.
+   */
+  arg_kind kind;
+
+  /**
+   * @brief
+   * The original argument.
+   */
+  const char* arg;
+
+  /**
+   * @brief
+   * Length of the original argument.
+   */
+  std::size_t len;
+
+  /**
+   * @brief
+   * For long flags this is the flag up to the equal sign including the
+   * hyphens (e.g. "--output" for "--output=foo"). For short flag groups this
+   * is everything after the hyphen. Otherwise it is nullptr.
+   */
+  const char* name;
+
+  /**
+   * @brief
+   * Length of @ref name.
+   */
+  std::size_t name_len;
+
+  /**
+   * @brief
+   * For long flags with an equal sign this is everything after the equal
+   * sign (null terminated since it is the tail of the argument). Otherwise
+   * it is nullptr.
+   */
+  const char* value;
+
+  /**
+   * @brief
+   * Length of @ref value.
+   */
+  std::size_t value_len;
+
+  /**
+   * @brief
+   * Returns true for short flag groups and long flags.
+   */
+  bool is_flag() const;
+
+};
+
+
+/**
+ * @brief
+ * Classifies a command line argument in a single pass over its characters.
+ * The classification follows the rules of cmd_line_arg_is_option_flag().
+ */
+arg_token lex_arg(
+  const char* s);
+
+
+/**
+ * @brief
+ * Same as lex_arg() above for an argument whose length is already known, so
+ * it is never recomputed. Only s[0] to s[len - 1] are read, so the argument
+ * doesn't need to be null terminated. Arguments with embedded null characters
+ * are never flags.
+ */
+arg_token lex_arg(
+  const char* s,
+  std::size_t len);
+
+
+/**
+ * @brief
+ * A command line argument and its length, as seen by the range overloads of
+ * parse(). The data must be null terminated at data[size] since option
+ * arguments and positional arguments are handed out as C strings.
+ */
+struct arg_view {
+
+  const char* data;
+
+  std::size_t size;
+
+};
+
+
+/**
+ * @brief
+ * Converts the elements of an argument range for the range overloads of
+ * parse(). Other argument types can be supported by overloading to_arg_view()
+ * in the namespace of the type so that it is found through argument
+ * dependent lookup.
+ */
+arg_view to_arg_view(const char* s);
+
+arg_view to_arg_view(const arg_view& s);
+
+arg_view to_arg_view(const std::string& s);
+
+arg_view to_arg_view(const std::pair<const char*, std::size_t>& s);
+
+#ifdef ARGAGG_HAS_STRING_VIEW
+arg_view to_arg_view(std::string_view s);
+#endif
+
+
+/**
+ * @brief
+ * Command line arguments with response files expanded, as GCC and MSVC do.
+ * Every argument after the program name of the form "@path" naming a file
+ * that can be opened is replaced by the arguments in that file. Arguments
+ * that name files that can't be opened are kept as they are.
+ *
+ * A response file containing a null character holds null delimited
+ * arguments (such as the output of "find -print0"). Otherwise arguments are
+ * separated by whitespace and may be quoted with single or double quotes,
+ * with a backslash escaping the next character. Response files may
+ * reference other response files.
+ *
+ * Files are memory-mapped privately and tokenized in place, so the expanded
+ * arguments point straight into the mappings instead of being copied one by
+ * one. Null delimited files are only read and so stay shared with the page
+ * cache. Writing the terminators and unquoting whitespace delimited files
+ * makes the kernel copy every page that ends an argument, which is nearly all
+ * of them, so such a file costs about its size in private memory. Pass the
+ * range to parser::parse(ForwardIt, ForwardIt); the response_files must
+ * outlive the results:
+ *
+ * @code
+ * argagg::response_files args(argc, argv);
+ * argagg::parser_results results = argparser.parse(args.begin(), args.end());
+ * @endcode
+ */
+struct response_files {
+
+  /**
+   * @brief
+   * How deeply response files may reference other response files before
+   * expansion gives up with a response_file_error.
+   */
+  static constexpr unsigned max_depth = 64;
+
+  /**
+   * @brief
+   * Expands the response files in argv, which must outlive this object.
+   */
+  response_files(int argc, const char** argv);
+
+  /**
+   * @brief
+   * Same as response_files(int, const char**), a const_cast convenience
+   * overload.
+   */
+  response_files(int argc, char** argv);
+
+  response_files(const response_files&) = delete;
+  response_files& operator = (const response_files&) = delete;
+
+  response_files(response_files&& other) noexcept;
+  response_files& operator = (response_files&& other) noexcept;
+
+  ~response_files();
+
+  const arg_view* begin() const;
+
+  const arg_view* end() const;
+
+  /**
+   * @brief
+   * Number of expanded arguments, including the program name.
+   */
+  std::size_t size() const;
+
+private:
+
+  struct mapping {
+    char* data;
+    std::size_t size;
+  };
+
+  void expand(const char* arg, std::size_t len, unsigned depth);
+
+  bool load(const char* path, unsigned depth);
+
+  void tokenize(char* first, char* last, bool writable_end, unsigned depth);
+
+  void tokenize_copy(const std::vector<char>& contents, unsigned depth);
+
+  void add(char* arg, std::size_t len, bool terminated, unsigned depth);
+
+  void unmap();
+
+  std::vector<arg_view> args_;
+
+  std::vector<mapping> mappings_;
+
+  // Files that couldn't be mapped and arguments that had no room for a null
+  // terminator in their mapping.
+  std::vector<std::unique_ptr<char[]>> buffers_;
+
+};
+
+
+/**
+ * @brief
+ * Splits the command line string in [first, last) into arguments following
+ * POSIX shell quoting: arguments are separated by unquoted whitespace,
+ * backslashes escape the next character (and remove escaped newlines),
+ * single quotes preserve everything up to the closing quote and double
+ * quotes preserve everything except backslashes escaping $, `, ", \ or a
+ * newline. No expansions of any kind are performed.
+ *
+ * The arguments are unquoted and null terminated in place, so *last must be
+ * writable too, and an @ref arg_view for each one is written to out. Throws a
+ * command_line_error for unterminated quotes and trailing backslashes.
+ */
+template <typename OutputIt>
+OutputIt split_command_line(char* first, char* last, OutputIt out);
+
+
+/**
+ * @brief
+ * A command line string split into arguments by split_command_line(), for
+ * commands received as whole strings (e.g. from a console or over RPC). The
+ * first argument is taken to be the program name by parse(). Reusing a
+ * command_line for the next command reuses its storage, so splitting
+ * commands no longer than previous ones doesn't allocate:
+ *
+ * @code
+ * argagg::command_line cmd;
+ * while (read_command(line)) {
+ *   cmd.split(line);
+ *   compiled.parse_into(cmd.begin(), cmd.end(), results);
+ *   ...
+ * }
+ * @endcode
+ */
+struct command_line {
+
+  /**
+   * @brief
+   * Copies the command into this object's buffer and splits it there.
+   * Arguments from the previous command are no longer valid afterwards.
+   */
+  void split(const char* command, std::size_t len);
+
+  void split(const char* command);
+
+  void split(const std::string& command);
+
+  const arg_view* begin() const;
+
+  const arg_view* end() const;
+
+  /**
+   * @brief
+   * Number of arguments, including the program name.
+   */
+  std::size_t size() const;
+
+private:
+
+  std::vector<char> buffer_;
+
+  std::vector<arg_view> args_;
+
+};
+
+
+/**
+ * @brief
+ * The instruction set used to scan long flag names while lexing. Only scalar
+ * is available when argagg isn't built with GCC or Clang for x86 or when
+ * ARGAGG_DISABLE_SIMD is defined.
+ */
+enum class simd_level {
+  scalar,
+  sse2,
+  avx2,
+};
+
+
+/**
+ * @brief
+ * Returns the best instruction set supported by the CPU we're running on.
+ * Detection happens once, the first time this is called.
+ */
+simd_level best_simd_level();
+
+
+/**
+ * @brief
+ * Classifies the command line arguments in [first, last) into out, which
+ * must have room for (last - first) tokens. The result is identical to
+ * calling lex_arg() on each argument but the instruction set is selected
+ * once for the whole batch.
+ */
+void lex_args(
+  const char* const* first,
+  const char* const* last,
+  arg_token* out);
+
+
+/**
+ * @brief
+ * Same as lex_args() above but with an explicit instruction set. Levels the
+ * CPU doesn't support must not be requested.
+ */
+void lex_args(
+  const char* const* first,
+  const char* const* last,
+  arg_token* out,
+  simd_level level);
+
+
+/**
+ * @brief
+ * Checks whether or not a command line argument should be processed as an
+ * option flag. This is very similar to is_valid_flag_definition() but must
+ * allow for short flag groups (e.g. "-abc") and equal-assigned long flag
+ * arguments (e.g. "--output=foo.txt").
+ */
+bool cmd_line_arg_is_option_flag(
+  const char* s);
+
+
+/**
+ * @brief
+ * Checks whether a flag in an option definition is valid. I suggest reading
+ * through the function source to understand what dictates a valid.
+ */
+bool is_valid_flag_definition(
+  const char* s);
+
+
+/**
+ * @brief
+ * Tests whether or not a valid flag is short. Assumes the provided cstring is
+ * already a valid flag.
+ */
+bool flag_is_short(
+  const char* s);
+
+
+/**
+ * @brief
+ * Tests whether a flag in an option definition is a prefix flag, one that
+ * ends in '*' such as "-Wl,*" or "-fno-*". A prefix flag matches any
+ * flag-like argument that starts with the part before the '*' and the rest
+ * of the argument becomes the option's argument.
+ */
+bool flag_is_prefix(
+  const char* s);
+
+
+/**
+ * @brief
+ * Checks whether a prefix flag is valid. The part before the '*' has to start
+ * like a short or long flag, with one or two hyphens and an alpha-numeric
+ * character, and can be followed by anything but another '*'. Since only
+ * flags are matched against prefix flags, the name of a long prefix flag up
+ * to any equal sign may only contain the characters of long flag names
+ * (alpha-numerics and hyphens).
+ */
+bool is_valid_prefix_flag_definition(
+  const char* s);
+
+
+/**
+ * @brief
+ * A single long flag and the definition it belongs to as stored in a @ref
+ * long_flag_map.
+ */
+struct long_flag_entry {
+
+  /**
+   * @brief
+   * The long flag including its leading hyphens (e.g. "--verbose").
+   */
+  std::string flag;
+
+  /**
+   * @brief
+   * Pointer to the @ref definition the flag represents.
+   */
+  const definition* defn;
+
+};
+
+
+/**
+ * @brief
+ * A read-only map from long flag to @ref definition built as a minimal
+ * perfect hash over a fixed set of flags.
+ *
+ * Every flag hashes into one of a small number of buckets. Each bucket stores
+ * a displacement that was searched for on build() such that every flag in
+ * every bucket lands on its own slot of a table with exactly one slot per
+ * flag. A lookup is then one hash of the candidate, one table probe and one
+ * comparison, and it works directly on a (pointer, length) pair so parsing
+ * "--output=foo" doesn't have to build an std::string for "--output".
+ *
+ * Searching for the displacements costs more than the handful of lookups a
+ * single parse does, so a map that is only used once can instead be built
+ * with build_sorted(), which keeps the flags in order and binary searches
+ * them.
+ */
+struct long_flag_map {
+
+  /**
+   * @brief
+   * Seed for the flag hash. Changed by build() if no set of displacements
+   * could be found with the previous seed.
+   */
+  std::uint64_t seed;
+
+  /**
+   * @brief
+   * Displacement for each bucket. Empty if the map was built by
+   * build_sorted().
+   */
+  std::vector<std::uint32_t> displacements;
+
+  /**
+   * @brief
+   * One entry per flag, stored at the slot its flag hashes to or in flag
+   * order if the map was built by build_sorted().
+   */
+  std::vector<long_flag_entry> entries;
+
+  /**
+   * @brief
+   * Builds the perfect hash over the given entries, replacing whatever was in
+   * the map. The flags must be unique; a std::logic_error is thrown if they
+   * are not.
+   */
+  void build(std::vector<long_flag_entry> flags);
+
+  /**
+   * @brief
+   * Stores the given entries without hashing them, replacing whatever was in
+   * the map. The flags must be unique and sorted.
+   */
+  void build_sorted(std::vector<long_flag_entry> flags);
+
+  /**
+   * @brief
+   * Returns the definition for the given flag or nullptr if the flag isn't in
+   * the map. The flag doesn't have to be null terminated.
+   */
+  const definition* find(
+    const char* flag,
+    std::size_t len) const;
+
+  /**
+   * @brief
+   * Gets the number of flags in the map.
+   */
+  std::size_t size() const;
+
+};
+
+
+/**
+ * @brief
+ * A read-only trie over the prefix flags of a set of definitions (see
+ * flag_is_prefix()) that finds the longest prefix flag an argument starts
+ * with in a single walk over the argument. Built over long flags instead it
+ * resolves abbreviations of them, see @ref long_flag_abbreviations.
+ *
+ * The nodes and their outgoing edges are stored in flat arrays. The edges of
+ * a node are contiguous and sorted by character, which keeps a walk within a
+ * few cache lines.
+ */
+struct prefix_flag_trie {
+
+  /**
+   * @brief
+   * A trie node, the prefix spelled by the edges from the root to it.
+   */
+  struct node {
+
+    /**
+     * @brief
+     * Index of the first outgoing edge in @ref edge_chars and @ref
+     * edge_targets.
+     */
+    std::uint32_t first_edge;
+
+    /**
+     * @brief
+     * Number of outgoing edges.
+     */
+    std::uint32_t num_edges;
+
+    /**
+     * @brief
+     * The definition whose prefix flag ends at this node or nullptr.
+     */
+    const definition* defn;
+
+    /**
+     * @brief
+     * The definition that every prefix flag below this node belongs to or
+     * nullptr if they belong to several.
+     */
+    const definition* unique_defn;
+
+  };
+
+  /**
+   * @brief
+   * All nodes. The root, the empty prefix, is the first node if there are
+   * any.
+   */
+  std::vector<node> nodes;
+
+  /**
+   * @brief
+   * Character of each edge.
+   */
+  std::vector<char> edge_chars;
+
+  /**
+   * @brief
+   * Index of the node each edge leads to.
+   */
+  std::vector<std::uint32_t> edge_targets;
+
+  /**
+   * @brief
+   * Builds the trie over the given prefixes (without their '*') and the
+   * definitions they belong to, replacing whatever was in the trie. The
+   * prefixes must be sorted and unique.
+   */
+  void build(const std::vector<long_flag_entry>& prefixes);
+
+  /**
+   * @brief
+   * Returns the definition of the longest prefix flag that arg starts with,
+   * storing the length of the prefix in prefix_len, or nullptr if there is
+   * none.
+   */
+  const definition* find_longest(
+    const char* arg,
+    std::size_t len,
+    std::size_t& prefix_len) const;
+
+  /**
+   * @brief
+   * Returns the definition that all prefix flags starting with the given
+   * string belong to, or nullptr if there are none or they belong to several.
+   * In the latter case ambiguous is set. This is how abbreviated long flags
+   * are resolved when the trie is built over the long flags.
+   */
+  const definition* find_unique(
+    const char* s,
+    std::size_t len,
+    bool& ambiguous) const;
+
+  /**
+   * @brief
+   * Returns true if there are no prefix flags.
+   */
+  bool empty() const;
+
+private:
+
+  std::uint32_t build_node(
+    const std::vector<long_flag_entry>& prefixes,
+    std::size_t first,
+    std::size_t last,
+    std::size_t depth);
+
+};
+
+
+/**
+ * @brief
+ * Contains the maps which aid in option parsing. The first map, @ref
+ * short_map, maps from a short flag (just a character) to a pointer to the
+ * original @ref definition that the flag represents. The second map, @ref
+ * long_map, maps from a long flag to a pointer to the original @ref
+ * definition that the flag represents. The third, @ref names,
+ * maps from a definition name to the definition's ordinal and is handed to
+ * the @ref parser_results.
+ *
+ * This object is usually a temporary that only exists during the parsing
+ * operation. It is typically constructed using @ref validate_definitions().
+ */
+struct parser_map {
+
+  /**
+   * @brief
+   * Maps from a short flag (just a character) to a pointer to the original
+   * @ref definition that the flag represents.
+   */
+  std::array<const definition*, 256> short_map;
+
+  /**
+   * @brief
+   * Maps from a long flag to a pointer to the original @ref definition that
+   * the flag represents.
+   */
+  long_flag_map long_map;
+
+  /**
+   * @brief
+   * Trie over the prefix flags, such as "-Wl,*", of the definitions.
+   */
+  prefix_flag_trie prefix_map;
+
+  /**
+   * @brief
+   * Trie over the long flags for resolving abbreviations of them. Empty
+   * unless abbreviations are allowed.
+   */
+  prefix_flag_trie abbreviation_map;
+
+  /**
+   * @brief
+   * Maps from definition name to the definition's ordinal. This is shared
+   * with the @ref parser_results so that they can be indexed by name.
+   */
+  std::shared_ptr<const option_name_index> names;
+
+  /**
+   * @brief
+   * Returns true if the provided short flag exists in the map object.
+   */
+  bool known_short_flag(
+    const char flag) const;
+
+  /**
+   * @brief
+   * If the short flag exists in the map object then it is returned by this
+   * method. If it doesn't then nullptr will be returned.
+   */
+  const definition* get_definition_for_short_flag(
+    const char flag) const;
+
+  /**
+   * @brief
+   * Returns true if the provided long flag exists in the map object.
+   */
+  bool known_long_flag(
+    const std::string& flag) const;
+
+  /**
+   * @brief
+   * If the long flag exists in the map object then it is returned by this
+   * method. If it doesn't then nullptr will be returned.
+   */
+  const definition* get_definition_for_long_flag(
+    const std::string& flag) const;
+
+  /**
+   * @brief
+   * Same as get_definition_for_long_flag(const std::string&) but works on a
+   * flag that isn't null terminated, such as the "--output" in
+   * "--output=foo".
+   */
+  const definition* get_definition_for_long_flag(
+    const char* flag,
+    std::size_t len) const;
+
+  /**
+   * @brief
+   * Returns the definition with the longest prefix flag that the argument
+   * starts with and stores the prefix length in prefix_len. If there is no
+   * such prefix flag then nullptr will be returned.
+   */
+  const definition* get_definition_for_prefix_flag(
+    const char* arg,
+    std::size_t len,
+    std::size_t& prefix_len) const;
+
+  /**
+   * @brief
+   * Returns the definition of the long flag that the given flag is an
+   * abbreviation of or nullptr. Sets ambiguous if it is an abbreviation of
+   * the flags of several definitions.
+   */
+  const definition* get_definition_for_abbreviated_flag(
+    const char* flag,
+    std::size_t len,
+    bool& ambiguous) const;
+
+};
+
+
+/**
+ * @brief
+ * Whether long flags can be abbreviated.
+ */
+enum class long_flag_abbreviations {
+
+  /**
+   * @brief
+   * Only complete long flags are recognized.
+   */
+  disallowed,
+
+  /**
+   * @brief
+   * Like getopt_long(), the start of a long flag is recognized as that flag
+   * (e.g. "--verb" for "--verbose") unless it is also the start of another
+   * option's long flag, which is an ambiguous_option_error. Complete flags
+   * and prefix flags take precedence over abbreviations.
+   */
+  allowed,
+
+};
+
+
+/**
+ * @brief
+ * How the long flags of a @ref parser_map are indexed.
+ */
+enum class long_flag_index {
+
+  /**
+   * @brief
+   * The flags are hashed with a minimal perfect hash, see @ref long_flag_map.
+   * Pays off when the map is used to parse more than one command line.
+   */
+  perfect_hash,
+
+  /**
+   * @brief
+   * The flags are kept sorted and binary searched. Cheaper to build, which is
+   * what a map that is thrown away after a single parse wants.
+   */
+  sorted,
+
+};
+
+
+/**
+ * @brief
+ * Validates a collection (specifically an std::vector) of @ref definition
+ * objects by checking if the contained flags are valid. If the set of @ref
+ * definition objects is not valid then an exception is thrown. Upon successful
+ * validation a @ref parser_map object is returned. The abbreviation index is
+ * only built when abbreviations are allowed.
+ */
+parser_map validate_definitions(
+  const std::vector<definition>& definitions,
+  long_flag_abbreviations abbreviations =
+    long_flag_abbreviations::disallowed,
+  long_flag_index index = long_flag_index::perfect_hash);
+
+
+/**
+ * @brief
+ * Returned by flag lookups when a flag doesn't belong to any definition.
+ */
+constexpr std::size_t no_option = static_cast<std::size_t>(-1);
+
+
+/**
+ * @brief
+ * Returned by long flag lookups when an abbreviated flag is the start of the
+ * flags of several definitions.
+ */
+constexpr std::size_t ambiguous_option = static_cast<std::size_t>(-2);
+
+
+/**
+ * @brief
+ * Adapts a @ref parser_map to the flag lookup interface used by the parsing
+ * state machine (see parse_step()): flags resolve to definition ordinals (or
+ * no_option) and ordinals resolve to the number of arguments the definition
+ * expects. @ref static_parser implements the same interface.
+ */
+struct parser_map_lookup {
+
+  const std::vector<definition>& definitions;
+
+  const parser_map& map;
+
+  std::size_t find_short_flag(char flag) const;
+
+  std::size_t find_long_flag(const char* flag, std::size_t len) const;
+
+  std::size_t find_prefix_flag(
+    const char* arg,
+    std::size_t len,
+    std::size_t& prefix_len) const;
+
+  std::size_t find_abbreviated_flag(const char* flag, std::size_t len) const;
+
+  unsigned int num_args(std::size_t ordinal) const;
+
+  const definition* definition_for(std::size_t ordinal) const;
+
+  std::size_t ordinal(const definition* defn) const;
+
+};
+
+
+/**
+ * @brief
+ * The kinds of @ref parse_event.
+ */
+enum class parse_event_kind {
+  option,
+  positional,
+};
+
+
+/**
+ * @brief
+ * Something the parser found on the command line: either a complete option
+ * occurrence (including its argument if it takes one) or a positional
+ * argument. Events are produced in command line order.
+ */
+struct parse_event {
+
+  /**
+   * @brief
+   * Whether this is an option or a positional argument.
+   */
+  parse_event_kind kind;
+
+  /**
+   * @brief
+   * The ordinal of the option's definition, no_option for positional
+   * arguments.
+   */
+  std::size_t ordinal;
+
+  /**
+   * @brief
+   * The option's definition. This is nullptr for positional arguments and
+   * for options parsed by a @ref static_parser (use the ordinal instead).
+   */
+  const definition* defn;
+
+  /**
+   * @brief
+   * The option's argument (nullptr if it has none) or the positional
+   * argument.
+   */
+  const char* value;
+
+  /**
+   * @brief
+   * Length of @ref value.
+   */
+  std::size_t value_len;
+
+  /**
+   * @brief
+   * Index of the command line argument the option's flag or the positional
+   * argument was found in, counting the program name as zero.
+   */
+  std::size_t argv_index;
+
+};
+
+
+/**
+ * @brief
+ * What the parsing state machine remembers between command line arguments.
+ * Start from initial_parse_state().
+ */
+struct parse_state {
+
+  /**
+   * @brief
+   * Set once "--" has been seen. All following arguments are positional.
+   */
+  bool ignore_flags;
+
+  /**
+   * @brief
+   * The flag argument of the option waiting for arguments, for error
+   * messages.
+   */
+  const char* last_flag_expecting_args;
+
+  /**
+   * @brief
+   * Ordinal of the option waiting for arguments.
+   */
+  std::size_t last_option_expecting_args;
+
+  /**
+   * @brief
+   * Index of the argument holding the flag of the option waiting for
+   * arguments.
+   */
+  std::size_t last_option_argv_index;
+
+  /**
+   * @brief
+   * How many more arguments the waiting option will consume.
+   */
+  unsigned int num_option_args_to_consume;
+
+  /**
+   * @brief
+   * When in the middle of a short flag group, the index of the next flag
+   * character to process. Zero otherwise.
+   */
+  std::size_t group_pos;
+
+};
+
+
+/**
+ * @brief
+ * Returns the state the parsing state machine starts in.
+ */
+parse_state initial_parse_state();
+
+
+/**
+ * @brief
+ * The kinds of errors found in command lines. Each corresponds to the
+ * exception parse() throws for it.
+ */
+enum class parse_error_kind {
+
+  /**
+   * @brief
+   * No error.
+   */
+  none,
+
+  /**
+   * @brief
+   * A flag that isn't defined (unexpected_option_error).
+   */
+  unexpected_option,
+
+  /**
+   * @brief
+   * An equal sign argument for an option that takes none
+   * (unexpected_argument_error).
+   */
+  unexpected_argument,
+
+  /**
+   * @brief
+   * The command line ended before an option got its arguments
+   * (option_lacks_argument_error).
+   */
+  option_lacks_argument,
+
+  /**
+   * @brief
+   * A character in a short flag group that can't be a flag
+   * (std::domain_error).
+   */
+  non_alphanumeric_flag,
+
+  /**
+   * @brief
+   * An abbreviated long flag that several options' flags start with
+   * (ambiguous_option_error).
+   */
+  ambiguous_option,
+
+};
+
+
+/**
+ * @brief
+ * A compact record of an error found in a command line, returned by
+ * try_parse() instead of throwing. Recording an error doesn't allocate or
+ * format anything; the message is only built when message() is called and
+ * needs the command line arguments to still be around.
+ */
+struct parse_error {
+
+  /**
+   * @brief
+   * What went wrong, none if nothing did.
+   */
+  parse_error_kind kind;
+
+  /**
+   * @brief
+   * Index of the offending argument in argv. For options lacking arguments
+   * this is the option's flag.
+   */
+  std::size_t argv_index;
+
+  /**
+   * @brief
+   * Offset of the offending character within the argument: the flag
+   * character in short flag groups, the start of the argument after the
+   * equal sign for unexpected arguments and zero otherwise.
+   */
+  std::size_t offset;
+
+  /**
+   * @brief
+   * The offending argument.
+   */
+  const char* arg;
+
+  /**
+   * @brief
+   * Returns true if there is an error.
+   */
+  explicit operator bool () const;
+
+  /**
+   * @brief
+   * Formats the same message the corresponding exception would have.
+   */
+  std::string message() const;
+
+  /**
+   * @brief
+   * Throws the exception parse() would have thrown for this error. Does
+   * nothing if there is no error.
+   */
+  void raise() const;
+
+};
+
+
+/**
+ * @brief
+ * Writes each error's message on its own line, prefixed with the position of
+ * the offending argument (e.g. "argument 3: found unexpected flag: --foo").
+ */
+void write_parse_errors(
+  std::ostream& os,
+  const std::vector<parse_error>& errors);
+
+
+template <typename Parser>
+struct incremental_parser;
+
+
+template <typename Parser>
+struct parse_event_range;
+
+
+struct compiled_parser;
+
+
+/**
+ * @brief
+ * A list of option definitions used to inform how to parse arguments.
+ */
+struct parser {
+
+  /**
+   * @brief
+   * Vector of the option definitions which inform this parser how to parse
+   * the command line arguments.
+   */
+  std::vector<definition> definitions;
+
+  /**
+   * @brief
+   * Appends a definition and returns a handle that can be used to read its
+   * results from @ref parser_results without a name lookup.
+   */
+  option_handle add(definition defn);
+
+  /**
+   * @brief
+   * Appends a definition and returns a handle that can be used to read its
+   * results, converted to T, from @ref parser_results using
+   * parser_results::get().
+   */
+  template <typename T>
+  typed_option_handle<T> add(definition defn);
+
+  /**
+   * @brief
+   * Parses the provided command line arguments and returns the results as
+   * @ref parser_results.
+   *
+   * @note
+   * This method is not thread-safe and assumes that no modifications are made
+   * to the definitions member field during the extent of this method call.
+   */
+  parser_results parse(int argc, const char** argv) const;
+
+  /**
+   * @brief
+   * Through strict interpretation of pointer casting rules, despite this being
+   * a safe operation, C++ doesn't allow implicit casts from <tt>char**</tt> to
+   * <tt>const char**</tt> so here's an overload that performs a const_cast,
+   * which is typically frowned upon but is safe here.
+   */
+  parser_results parse(int argc, char** argv) const;
+
+  /**
+   * @brief
+   * Same as parse() but writes the results into out, reusing the capacity of
+   * its containers. Since the definitions are validated on every call this
+   * still allocates; use compiled_parser::parse_into() when that matters.
+   */
+  void parse_into(int argc, const char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as parser::parse_into(int, const char**, parser_results&), a
+   * const_cast convenience overload.
+   */
+  void parse_into(int argc, char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as parse() but stops parsing where stop says. The arguments after
+   * that are left in parser_results::remainder, pointing into argv.
+   */
+  parser_results parse(int argc, const char** argv, stop_at stop) const;
+
+  /**
+   * @brief
+   * Same as parse(int, const char**, stop_at), a const_cast convenience
+   * overload.
+   */
+  parser_results parse(int argc, char** argv, stop_at stop) const;
+
+  /**
+   * @brief
+   * Same as parse() but passes the arguments selected by what through to
+   * forwarded instead of handling them, see @ref forward. They are appended
+   * in their original order followed by a null pointer, so after putting the
+   * wrapped program's name into forwarded first its data() can be passed to
+   * execv() as is. The forwarded arguments point into argv.
+   */
+  parser_results parse(
+    int argc,
+    const char** argv,
+    std::vector<const char*>& forwarded,
+    forward what = forward::unknown_options) const;
+
+  /**
+   * @brief
+   * Same as parse(int, const char**, std::vector<const char*>&, forward), a
+   * const_cast convenience overload.
+   */
+  parser_results parse(
+    int argc,
+    char** argv,
+    std::vector<const char*>& forwarded,
+    forward what = forward::unknown_options) const;
+
+  /**
+   * @brief
+   * Parses a forward range of arguments, such as an std::vector of
+   * std::string, instead of an argv array. Like argv the first element is
+   * the program name. Elements are converted with to_arg_view() so lengths
+   * that are already known aren't recomputed. The elements must outlive the
+   * results since those point into them.
+   */
+  template <typename ForwardIt>
+  parser_results parse(ForwardIt first, ForwardIt last) const;
+
+  /**
+   * @brief
+   * Same as parse(ForwardIt, ForwardIt) but writes the results into out.
+   */
+  template <typename ForwardIt>
+  void parse_into(ForwardIt first, ForwardIt last, parser_results& out) const;
+
+  /**
+   * @brief
+   * Validates the definitions once and returns a @ref compiled_parser that
+   * owns a copy of them along with the prebuilt @ref parser_map. Use this when
+   * the same definitions are used to parse many command lines. Long flag
+   * abbreviations are only recognized by the compiled parser if allowed here.
+   */
+  compiled_parser compile(
+    long_flag_abbreviations abbreviations =
+      long_flag_abbreviations::disallowed) const;
+
+};
+
+
+/**
+ * @brief
+ * A parser whose definitions have been validated and frozen. The @ref
+ * parser_map is built once on construction so parse() only has to walk the
+ * command line arguments.
+ *
+ * The definitions are owned by this object (the @ref parser_map points into
+ * them) so they are only exposed as a const reference. Copying a compiled
+ * parser rebuilds the map for the copy.
+ *
+ * A compiled parser is immutable so all of its const methods, including
+ * parse(), are safe to call concurrently from any number of threads.
+ */
+struct compiled_parser {
+
+  /**
+   * @brief
+   * Takes ownership of the definitions and validates them using
+   * validate_definitions(). Throws the same exceptions as
+   * validate_definitions() if the definitions are invalid.
+   */
+  explicit compiled_parser(
+    std::vector<definition> definitions,
+    long_flag_abbreviations abbreviations =
+      long_flag_abbreviations::disallowed);
+
+  /**
+   * @brief
+   * Copies the definitions of another compiled parser and rebuilds the @ref
+   * parser_map so that it points into this object's definitions.
+   */
+  compiled_parser(const compiled_parser& other);
+
+  /**
+   * @brief
+   * Moving keeps the definitions in place so the @ref parser_map stays valid.
+   */
+  compiled_parser(compiled_parser&& other) = default;
+
+  /**
+   * @brief
+   * Copy and move assignment through copy-and-swap.
+   */
+  compiled_parser& operator = (compiled_parser other);
+
+  /**
+   * @brief
+   * The frozen option definitions.
+   */
+  const std::vector<definition>& definitions() const;
+
+  /**
+   * @brief
+   * The @ref parser_map built from the definitions on construction.
+   */
+  const parser_map& map() const;
+
+  /**
+   * @brief
+   * Gets a handle for the definition with the given name. If there is no
+   * definition with the given name then an argagg::unknown_option exception
+   * is thrown.
+   */
+  option_handle handle(const std::string& name) const;
+
+  /**
+   * @brief
+   * Gets a typed handle for the definition with the given name. If there is
+   * no definition with the given name then an argagg::unknown_option
+   * exception is thrown.
+   */
+  template <typename T>
+  typed_option_handle<T> handle(const std::string& name) const;
+
+  /**
+   * @brief
+   * Parses the provided command line arguments and returns the results as
+   * @ref parser_results. Unlike parser::parse() this does not validate the
+   * definitions again.
+   */
+  parser_results parse(int argc, const char** argv) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, char**), a const_cast convenience overload.
+   */
+  parser_results parse(int argc, char** argv) const;
+
+  /**
+   * @brief
+   * Same as parse() but writes the results into out. The containers in out
+   * are cleared but keep their capacity, so once out has seen a command line
+   * of a similar shape parsing into it makes no heap allocations. Entries in
+   * @ref parser_results::options from the previous parse are kept, emptied,
+   * for the same reason.
+   */
+  void parse_into(int argc, const char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as parser::parse_into(int, const char**, parser_results&), a
+   * const_cast convenience overload.
+   */
+  void parse_into(int argc, char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, const char**, stop_at).
+   */
+  parser_results parse(int argc, const char** argv, stop_at stop) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, char**, stop_at).
+   */
+  parser_results parse(int argc, char** argv, stop_at stop) const;
+
+  /**
+   * @brief
+   * Same as parse(int, const char**, stop_at) but writes the results into
+   * out. Besides option results nothing is allocated when stopping at the
+   * first positional argument.
+   */
+  void parse_into(
+    int argc,
+    const char** argv,
+    parser_results& out,
+    stop_at stop) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, const char**, std::vector<const char*>&,
+   * forward).
+   */
+  parser_results parse(
+    int argc,
+    const char** argv,
+    std::vector<const char*>& forwarded,
+    forward what = forward::unknown_options) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, char**, std::vector<const char*>&, forward).
+   */
+  parser_results parse(
+    int argc,
+    char** argv,
+    std::vector<const char*>& forwarded,
+    forward what = forward::unknown_options) const;
+
+  /**
+   * @brief
+   * Same as parse(int, const char**, std::vector<const char*>&, forward) but
+   * writes the results into out. When forwarded has the capacity for the
+   * forwarded arguments nothing but option results is allocated.
+   */
+  void parse_into(
+    int argc,
+    const char** argv,
+    parser_results& out,
+    std::vector<const char*>& forwarded,
+    forward what = forward::unknown_options) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(ForwardIt, ForwardIt).
+   */
+  template <typename ForwardIt>
+  parser_results parse(ForwardIt first, ForwardIt last) const;
+
+  /**
+   * @brief
+   * Same as parser::parse_into(ForwardIt, ForwardIt, parser_results&).
+   */
+  template <typename ForwardIt>
+  void parse_into(ForwardIt first, ForwardIt last, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as parse_into() but returns errors in the command line as a @ref
+   * parse_error instead of throwing them. On error out holds what was parsed
+   * before the offending argument.
+   */
+  parse_error try_parse(int argc, const char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as try_parse(int, const char**, parser_results&), a const_cast
+   * convenience overload.
+   */
+  parse_error try_parse(int argc, char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as try_parse(int, const char**, parser_results&) over a range of
+   * arguments, see parse(ForwardIt, ForwardIt).
+   */
+  template <typename ForwardIt>
+  parse_error try_parse(
+    ForwardIt first, ForwardIt last, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as try_parse() but doesn't stop at the first error. Every error in
+   * the command line is appended to errors (cleared first) in argv order
+   * while the arguments in error are skipped, so out holds everything else.
+   * Returns the first error.
+   */
+  parse_error try_parse_all(
+    int argc, const char** argv, parser_results& out,
+    std::vector<parse_error>& errors) const;
+
+  /**
+   * @brief
+   * Same as try_parse_all(int, const char**, parser_results&,
+   * std::vector<parse_error>&), a const_cast convenience overload.
+   */
+  parse_error try_parse_all(
+    int argc, char** argv, parser_results& out,
+    std::vector<parse_error>& errors) const;
+
+  /**
+   * @brief
+   * Same as try_parse_all(int, const char**, parser_results&,
+   * std::vector<parse_error>&) over a range of arguments.
+   */
+  template <typename ForwardIt>
+  parse_error try_parse_all(
+    ForwardIt first, ForwardIt last, parser_results& out,
+    std::vector<parse_error>& errors) const;
+
+  /**
+   * @brief
+   * The flag lookup used by the parsing state machine.
+   */
+  parser_map_lookup lookup() const;
+
+  /**
+   * @brief
+   * Returns an @ref incremental_parser that is fed one argument at a time.
+   * This compiled parser must outlive it.
+   */
+  incremental_parser<compiled_parser> incremental() const;
+
+  /**
+   * @brief
+   * Returns a @ref parse_event_range that parses the command line lazily as
+   * it is iterated. This compiled parser and argv must outlive it.
+   */
+  parse_event_range<compiled_parser> parse_events(
+    int argc, const char** argv) const;
+
+  /**
+   * @brief
+   * Same as parse_events(int, const char**), a const_cast convenience
+   * overload.
+   */
+  parse_event_range<compiled_parser> parse_events(
+    int argc, char** argv) const;
+
+private:
+
+  std::vector<definition> definitions_;
+
+  parser_map map_;
+
+};
+
+
+/**
+ * @brief
+ * Maximum number of flags a @ref static_definition can have.
+ */
+constexpr std::size_t static_definition_max_flags = 4;
+
+
+/**
+ * @brief
+ * A compile-time counterpart of @ref definition built from string literals.
+ * Since it is a literal type an array of these can be constexpr, which means
+ * it is validated and turned into a @ref static_parser at compile time with
+ * no heap allocation or dynamic initialization.
+ *
+ * Flags are listed like for @ref definition (e.g. <tt>{"-v",
+ * "--verbose"}</tt>); unused entries of @ref flags are left as nullptr.
+ */
+struct static_definition {
+
+  /**
+   * @brief
+   * Name of the option.
+   */
+  const char* name;
+
+  /**
+   * @brief
+   * Flags that correspond to this option, terminated by the first nullptr.
+   */
+  const char* flags[static_definition_max_flags];
+
+  /**
+   * @brief
+   * Help string for this option.
+   */
+  const char* help;
+
+  /**
+   * @brief
+   * Number of arguments this option requires. See definition::num_args.
+   */
+  unsigned int num_args;
+
+};
+
+
+/**
+ * @brief
+ * A compile-time sequence of indices, equivalent to C++14's
+ * std::index_sequence. Used to build the static_parser tables.
+ */
+template <std::size_t... Is>
+struct index_sequence {};
+
+
+/**
+ * @brief
+ * Number of slots in a @ref static_hash_index with n keys, two per key.
+ */
+constexpr std::size_t static_hash_slot_count(std::size_t n);
+
+
+/**
+ * @brief
+ * Number of displacement buckets of a @ref static_hash_index with n keys,
+ * about one for every four keys.
+ */
+constexpr std::size_t static_hash_bucket_count(std::size_t n);
+
+
+/**
+ * @brief
+ * A perfect hash table over up to K strings that is computed at compile time
+ * and maps the static_flag_hash() of each string to its index. It is the long
+ * flag table of a @ref static_parser and the program table of a
+ * @ref multicall_registry. Only hashes are stored, so the caller compares the
+ * string at the returned index.
+ *
+ * The table is built by sorting the keys into buckets and placing each
+ * bucket on its own, so the compile-time work grows a little faster than the
+ * number of keys. Within GCC's default constexpr limits tables of up to four
+ * thousand keys can be built, and a @ref static_parser of up to a thousand
+ * definitions.
+ */
+template <std::size_t K>
+struct static_hash_index {
+
+  /**
+   * @brief
+   * Hash displacement of each bucket, chosen so no two keys of the bucket
+   * share a slot.
+   */
+  std::uint32_t displacements[static_hash_bucket_count(K)];
+
+  /**
+   * @brief
+   * First slot of each bucket. Bucket b owns the slots from offsets[b] up to
+   * offsets[b + 1], two for each of its keys.
+   */
+  std::uint32_t offsets[static_hash_bucket_count(K) + 1];
+
+  /**
+   * @brief
+   * Maps from a slot to the index of the key in it plus one, or zero if the
+   * slot is empty.
+   */
+  std::uint16_t slots[static_hash_slot_count(K)];
+
+  /**
+   * @brief
+   * Returns the index of the only key that can have the given hash, or
+   * no_option.
+   */
+  std::size_t find(std::uint64_t hash) const;
+
+};
+
+
+/**
+ * @brief
+ * A long flag entry in the dispatch table of a @ref static_parser.
+ */
+struct static_long_flag {
+
+  /**
+   * @brief
+   * The long flag including its leading hyphens.
+   */
+  const char* flag;
+
+  /**
+   * @brief
+   * Length of @ref flag.
+   */
+  std::size_t len;
+
+  /**
+   * @brief
+   * static_flag_hash() of @ref flag, the key of static_parser::long_index.
+   */
+  std::uint64_t hash;
+
+  /**
+   * @brief
+   * Ordinal of the definition the flag belongs to.
+   */
+  std::size_t ordinal;
+
+};
+
+
+/**
+ * @brief
+ * P values sorted at compile time by a sorting network. Each value packs a
+ * sort key in its high half and the index of what it was made from in its
+ * low half. A @ref static_parser sorts its flags with it to find duplicates
+ * and short flags.
+ */
+template <std::size_t P>
+struct static_sort {
+
+  /**
+   * @brief
+   * The sorted values.
+   */
+  std::uint64_t values[P];
+
+};
+
+
+/**
+ * @brief
+ * Number of long flags of the static definitions before each definition, and
+ * of all of them at index N, so a @ref static_parser finds the definition of
+ * its k-th long flag with a binary search.
+ */
+template <std::size_t N>
+struct static_long_flag_ranks {
+
+  /**
+   * @brief
+   * Number of long flags of the definitions before the i-th.
+   */
+  std::size_t before[N + 1];
+
+};
+
+
+/**
+ * @brief
+ * A parser over a constexpr array of @ref static_definition objects whose
+ * validation and dispatch tables are computed at compile time. Construct one
+ * with make_static_parser():
+ *
+ * @code
+   constexpr argagg::static_definition definitions[] = {
+       {"help", {"-h", "--help"}, "shows this help message", 0},
+       {"output", {"-o", "--output"}, "output file", 1},
+     };
+   constexpr auto argparser = argagg::make_static_parser(definitions);
+   constexpr auto output = argparser.handle("output");
+
+   int main(int argc, char** argv)
+   {
+     auto args = argparser.parse(argc, argv);
+     if (args[output]) {
+       // ...
+     }
+   }
+   @endcode
+ *
+ * The definitions array must have static storage duration since the parser
+ * keeps a pointer to it. There is no name index for static parsers so the
+ * resulting @ref parser_results are read with handles; indexing them by name
+ * throws argagg::unknown_option.
+ */
+template <std::size_t N>
+struct static_parser {
+
+  /**
+   * @brief
+   * Pointer to the definitions the parser was built from.
+   */
+  const static_definition* definitions;
+
+  /**
+   * @brief
+   * Maps from a short flag character to the ordinal of its definition plus
+   * one, or zero if the character isn't a short flag.
+   */
+  std::uint16_t short_map[256];
+
+  /**
+   * @brief
+   * All long flags in definition order. Only the first @ref num_long_flags
+   * entries are used.
+   */
+  static_long_flag long_map[N * static_definition_max_flags];
+
+  /**
+   * @brief
+   * Number of used entries in @ref long_map.
+   */
+  std::size_t num_long_flags;
+
+  /**
+   * @brief
+   * Perfect hash of the used entries in @ref long_map, so finding a long flag
+   * costs a hash and a single comparison however many flags there are.
+   */
+  static_hash_index<N * static_definition_max_flags> long_index;
+
+  /**
+   * @brief
+   * Builds the tables. Use make_static_parser() instead, it validates the
+   * definitions first.
+   */
+  template <std::size_t... S, std::size_t... L>
+  constexpr static_parser(
+    const static_definition (&defs)[N],
+    index_sequence<S...>,
+    index_sequence<L...>);
+
+  /**
+   * @brief
+   * Builds the tables from the long flag counts of the definitions and their
+   * flags sorted by make_static_flag_sort().
+   */
+  template <std::size_t P, std::size_t... S, std::size_t... L>
+  constexpr static_parser(
+    const static_definition (&defs)[N],
+    const static_long_flag_ranks<N>& ranks,
+    const static_sort<P>& flags,
+    index_sequence<S...>,
+    index_sequence<L...>);
+
+  /**
+   * @brief
+   * Gets a handle for the definition with the given name. Throws
+   * argagg::unknown_option if there is no such definition, which makes it a
+   * compile error when evaluated in a constant expression.
+   */
+  constexpr option_handle handle(
+    const char* name,
+    std::size_t i = 0) const;
+
+  /**
+   * @brief
+   * Gets a typed handle for the definition with the given name. See
+   * handle(const char*).
+   */
+  template <typename T>
+  constexpr typed_option_handle<T> handle(const char* name) const;
+
+  /**
+   * @brief
+   * Returns the ordinal of the short flag's definition or no_option.
+   */
+  std::size_t find_short_flag(char flag) const;
+
+  /**
+   * @brief
+   * Returns the ordinal of the long flag's definition or no_option.
+   */
+  std::size_t find_long_flag(const char* flag, std::size_t len) const;
+
+  /**
+   * @brief
+   * Always no_option since static definitions can't have prefix flags.
+   */
+  std::size_t find_prefix_flag(
+    const char* arg,
+    std::size_t len,
+    std::size_t& prefix_len) const;
+
+  /**
+   * @brief
+   * Always no_option since static parsers don't allow abbreviated long
+   * flags.
+   */
+  std::size_t find_abbreviated_flag(const char* flag, std::size_t len) const;
+
+  /**
+   * @brief
+   * Number of arguments expected by the definition with the given ordinal.
+   */
+  unsigned int num_args(std::size_t ordinal) const;
+
+  /**
+   * @brief
+   * Always nullptr since static parsers don't have @ref definition objects.
+   */
+  const definition* definition_for(std::size_t ordinal) const;
+
+  /**
+   * @brief
+   * The flag lookup used by the parsing state machine, which is the static
+   * parser itself.
+   */
+  const static_parser& lookup() const;
+
+  /**
+   * @brief
+   * Returns an @ref incremental_parser that is fed one argument at a time.
+   * This static parser must outlive it.
+   */
+  incremental_parser<static_parser> incremental() const;
+
+  /**
+   * @brief
+   * Same as compiled_parser::parse_events().
+   */
+  parse_event_range<static_parser> parse_events(
+    int argc, const char** argv) const;
+
+  /**
+   * @brief
+   * Same as parse_events(int, const char**), a const_cast convenience
+   * overload.
+   */
+  parse_event_range<static_parser> parse_events(
+    int argc, char** argv) const;
+
+  /**
+   * @brief
+   * Parses the provided command line arguments and returns the results as
+   * @ref parser_results. This is safe to call concurrently.
+   */
+  parser_results parse(int argc, const char** argv) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, char**), a const_cast convenience overload.
+   */
+  parser_results parse(int argc, char** argv) const;
+
+  /**
+   * @brief
+   * Same as compiled_parser::parse_into().
+   */
+  void parse_into(int argc, const char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as parser::parse_into(int, const char**, parser_results&), a
+   * const_cast convenience overload.
+   */
+  void parse_into(int argc, char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, const char**, stop_at).
+   */
+  parser_results parse(int argc, const char** argv, stop_at stop) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, char**, stop_at).
+   */
+  parser_results parse(int argc, char** argv, stop_at stop) const;
+
+  /**
+   * @brief
+   * Same as compiled_parser::parse_into(int, const char**, parser_results&,
+   * stop_at).
+   */
+  void parse_into(
+    int argc,
+    const char** argv,
+    parser_results& out,
+    stop_at stop) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, const char**, std::vector<const char*>&,
+   * forward).
+   */
+  parser_results parse(
+    int argc,
+    const char** argv,
+    std::vector<const char*>& forwarded,
+    forward what = forward::unknown_options) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(int, char**, std::vector<const char*>&, forward).
+   */
+  parser_results parse(
+    int argc,
+    char** argv,
+    std::vector<const char*>& forwarded,
+    forward what = forward::unknown_options) const;
+
+  /**
+   * @brief
+   * Same as parse(int, const char**, std::vector<const char*>&, forward) but
+   * writes the results into out. When forwarded has the capacity for the
+   * forwarded arguments nothing but option results is allocated.
+   */
+  void parse_into(
+    int argc,
+    const char** argv,
+    parser_results& out,
+    std::vector<const char*>& forwarded,
+    forward what = forward::unknown_options) const;
+
+  /**
+   * @brief
+   * Same as parser::parse(ForwardIt, ForwardIt).
+   */
+  template <typename ForwardIt>
+  parser_results parse(ForwardIt first, ForwardIt last) const;
+
+  /**
+   * @brief
+   * Same as parser::parse_into(ForwardIt, ForwardIt, parser_results&).
+   */
+  template <typename ForwardIt>
+  void parse_into(ForwardIt first, ForwardIt last, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as parse_into() but returns errors in the command line as a @ref
+   * parse_error instead of throwing them. On error out holds what was parsed
+   * before the offending argument.
+   */
+  parse_error try_parse(int argc, const char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as try_parse(int, const char**, parser_results&), a const_cast
+   * convenience overload.
+   */
+  parse_error try_parse(int argc, char** argv, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as try_parse(int, const char**, parser_results&) over a range of
+   * arguments, see parse(ForwardIt, ForwardIt).
+   */
+  template <typename ForwardIt>
+  parse_error try_parse(
+    ForwardIt first, ForwardIt last, parser_results& out) const;
+
+  /**
+   * @brief
+   * Same as try_parse() but doesn't stop at the first error. Every error in
+   * the command line is appended to errors (cleared first) in argv order
+   * while the arguments in error are skipped, so out holds everything else.
+   * Returns the first error.
+   */
+  parse_error try_parse_all(
+    int argc, const char** argv, parser_results& out,
+    std::vector<parse_error>& errors) const;
+
+  /**
+   * @brief
+   * Same as try_parse_all(int, const char**, parser_results&,
+   * std::vector<parse_error>&), a const_cast convenience overload.
+   */
+  parse_error try_parse_all(
+    int argc, char** argv, parser_results& out,
+    std::vector<parse_error>& errors) const;
+
+  /**
+   * @brief
+   * Same as try_parse_all(int, const char**, parser_results&,
+   * std::vector<parse_error>&) over a range of arguments.
+   */
+  template <typename ForwardIt>
+  parse_error try_parse_all(
+    ForwardIt first, ForwardIt last, parser_results& out,
+    std::vector<parse_error>& errors) const;
+
+};
+
+
+/**
+ * @brief
+ * Validates an array of @ref static_definition objects using the same rules
+ * as validate_definitions() and builds a @ref static_parser from them. If the
+ * definitions are invalid an argagg::invalid_flag is thrown, which is a
+ * compile error when the result is assigned to a constexpr variable.
+ */
+template <std::size_t N>
+constexpr static_parser<N> make_static_parser(
+  const static_definition (&definitions)[N]);
+
+
+/**
+ * @brief
+ * Parses arguments as they arrive instead of from a complete argv array,
+ * using the same state machine as parse(). Each argument is handed to feed()
+ * which immediately passes any options and positional arguments it completes
+ * to a handler as @ref parse_event objects. An option that takes an argument
+ * is completed by the argument after it. Only a fixed amount of state is
+ * kept, however many arguments are fed.
+ *
+ * Get one from compiled_parser::incremental() or
+ * static_parser::incremental().
+ *
+ * @code
+ * auto incremental = compiled.incremental();
+ * while (const char* arg = next_argument()) {
+ *   incremental.feed(arg, [](const argagg::parse_event& event) { ... });
+ * }
+ * incremental.finish();
+ * @endcode
+ */
+template <typename Parser>
+struct incremental_parser {
+
+  /**
+   * @brief
+   * Creates an incremental parser over the given parser, which must outlive
+   * it. The first argument fed is argument one; the program name isn't fed.
+   */
+  explicit incremental_parser(const Parser& parser);
+
+  /**
+   * @brief
+   * Parses the next command line argument, calling handler with a
+   * <tt>const parse_event&</tt> for each option or positional argument it
+   * completes. Throws the same exceptions as parse(). The argument must stay
+   * valid until the next call to feed() or finish(), and event values only
+   * until the handler returns.
+   */
+  template <typename Handler>
+  void feed(const char* arg, Handler&& handler);
+
+  /**
+   * @brief
+   * Ends the command line. Throws argagg::option_lacks_argument_error if an
+   * option is still waiting for its argument. Either way the parser is reset
+   * and can be fed a new command line.
+   */
+  void finish();
+
+  /**
+   * @brief
+   * Number of arguments fed since construction or the last finish().
+   */
+  std::size_t count() const;
+
+private:
+
+  const Parser* parser_;
+
+  parse_state state_;
+
+  std::size_t argv_index_;
+
+};
+
+
+/**
+ * @brief
+ * An input iterator over the @ref parse_event objects of a command line,
+ * produced lazily by the parsing state machine as the iterator advances.
+ * Advancing throws the same exceptions as parse(). A default constructed
+ * iterator is the end iterator.
+ */
+template <typename Parser>
+struct parse_event_iterator {
+
+  using iterator_category = std::input_iterator_tag;
+  using value_type = parse_event;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const parse_event*;
+  using reference = const parse_event&;
+
+  /**
+   * @brief
+   * Creates the end iterator.
+   */
+  parse_event_iterator();
+
+  /**
+   * @brief
+   * Creates an iterator at the first event of the command line.
+   */
+  parse_event_iterator(const Parser& parser, int argc, const char** argv);
+
+  reference operator * () const;
+
+  pointer operator -> () const;
+
+  parse_event_iterator& operator ++ ();
+
+  parse_event_iterator operator ++ (int);
+
+  /**
+   * @brief
+   * Iterators only compare equal when both are at the end.
+   */
+  bool operator == (const parse_event_iterator& other) const;
+
+  bool operator != (const parse_event_iterator& other) const;
+
+private:
+
+  void advance();
+
+  const Parser* parser_;
+
+  const char** argv_;
+
+  std::size_t argc_;
+
+  std::size_t argv_index_;
+
+  bool in_token_;
+
+  arg_token token_;
+
+  parse_state state_;
+
+  parse_event event_;
+
+};
+
+
+/**
+ * @brief
+ * The range returned by compiled_parser::parse_events() and
+ * static_parser::parse_events(). Iterating it parses the command line in a
+ * single forward pass without allocating or storing any results:
+ *
+ * @code
+ * for (const argagg::parse_event& event : compiled.parse_events(argc, argv)) {
+ *   ...
+ * }
+ * @endcode
+ */
+template <typename Parser>
+struct parse_event_range {
+
+  const Parser* parser;
+
+  int argc;
+
+  const char** argv;
+
+  parse_event_iterator<Parser> begin() const;
+
+  parse_event_iterator<Parser> end() const;
+
+};
+
+
+/**
+ * @brief
+ * A subcommand of a @ref subcommand_parser. Its parser is only built, by
+ * calling make_parser, when the subcommand is selected.
+ */
+struct subcommand {
+
+  /**
+   * @brief
+   * The name that selects this subcommand on the command line.
+   */
+  const char* name;
+
+  /**
+   * @brief
+   * Help message for this subcommand.
+   */
+  const char* help;
+
+  /**
+   * @brief
+   * Builds the parser for this subcommand's arguments.
+   */
+  compiled_parser (*make_parser)();
+
+};
+
+
+/**
+ * @brief
+ * The results of subcommand_parser::parse().
+ */
+struct subcommand_results {
+
+  /**
+   * @brief
+   * The options that came before the subcommand.
+   */
+  parser_results global;
+
+  /**
+   * @brief
+   * The selected subcommand or nullptr if the command line has none.
+   */
+  const subcommand* command;
+
+  /**
+   * @brief
+   * The subcommand's arguments parsed with its parser. The program name of
+   * these results is the subcommand name.
+   */
+  parser_results results;
+
+  /**
+   * @brief
+   * The part of argv handed to the subcommand, starting with the subcommand
+   * name. This points into the original argv.
+   */
+  int argc;
+
+  const char** argv;
+
+};
+
+
+/**
+ * @brief
+ * Parses git-style command lines, "program [global options] subcommand
+ * [subcommand arguments]". The global options are parsed up to the first
+ * positional argument, which selects the subcommand, and the rest of argv is
+ * parsed in place by that subcommand's parser. Only the selected
+ * subcommand's parser is ever built:
+ *
+ * @code
+ * argagg::subcommand_parser cli {
+ *   argagg::compiled_parser {{
+ *     {"help", {"-h", "--help"}, "shows this help message", 0},
+ *   }},
+ *   {
+ *     {"clone", "clone a repository", make_clone_parser},
+ *     {"commit", "record changes", make_commit_parser},
+ *   }};
+ * argagg::subcommand_results args = cli.parse(argc, argv);
+ * @endcode
+ */
+struct subcommand_parser {
+
+  /**
+   * @brief
+   * Parser for the options before the subcommand.
+   */
+  compiled_parser global;
+
+  /**
+   * @brief
+   * The available subcommands.
+   */
+  std::vector<subcommand> commands;
+
+  /**
+   * @brief
+   * Returns the subcommand with the given name or nullptr.
+   */
+  const subcommand* find(const char* name) const;
+
+  /**
+   * @brief
+   * Parses the global options, selects the subcommand and parses the rest
+   * of the command line with its parser. Throws an
+   * unexpected_subcommand_error for unknown subcommands and otherwise the
+   * same exceptions as parse().
+   */
+  subcommand_results parse(int argc, const char** argv) const;
+
+  /**
+   * @brief
+   * Same as parse(int, const char**), a const_cast convenience overload.
+   */
+  subcommand_results parse(int argc, char** argv) const;
+
+};
+
+
+/**
+ * @brief
+ * Writes the global option help followed by the list of subcommands.
+ */
+std::ostream& operator << (std::ostream& os, const subcommand_parser& x);
+
+
+/**
+ * @brief
+ * Returns the part of path after its last '/', which is the name a
+ * multi-call binary was invoked as when path is argv[0]. The result points
+ * into path.
+ */
+const char* program_basename(const char* path);
+
+
+/**
+ * @brief
+ * The results of multicall_registry::parse().
+ */
+struct multicall_results {
+
+  /**
+   * @brief
+   * The program argv[0] named.
+   */
+  const subcommand* program;
+
+  /**
+   * @brief
+   * The arguments parsed with the program's parser.
+   */
+  parser_results results;
+
+};
+
+
+/**
+ * @brief
+ * Dispatches busybox-style multi-call binaries on the name they were invoked
+ * as, program_basename(argv[0]). The programs are looked up in a perfect
+ * hash table that is computed at compile time, so finding one costs a hash of
+ * the name and a single string comparison, and only the selected program's
+ * parser is ever built. Construct one with make_multicall_registry():
+ *
+ * @code
+   constexpr argagg::subcommand programs[] = {
+       {"cat", "concatenate files", make_cat_parser},
+       {"ls", "list directory contents", make_ls_parser},
+     };
+   constexpr auto registry = argagg::make_multicall_registry(programs);
+
+   int main(int argc, char** argv)
+   {
+     argagg::multicall_results args = registry.parse(argc, argv);
+     // ...
+   }
+   @endcode
+ *
+ * The programs array must have static storage duration since the registry
+ * keeps a pointer to it.
+ */
+template <std::size_t N>
+struct multicall_registry {
+
+  /**
+   * @brief
+   * Pointer to the programs the registry was built from.
+   */
+  const subcommand* programs;
+
+  /**
+   * @brief
+   * Perfect hash of the program names.
+   */
+  static_hash_index<N> index;
+
+  /**
+   * @brief
+   * Returns the program with the given name or nullptr. The name doesn't
+   * need to be null-terminated.
+   */
+  const subcommand* find(const char* name, std::size_t len) const;
+
+  /**
+   * @brief
+   * Returns the program with the given name or nullptr.
+   */
+  const subcommand* find(const char* name) const;
+
+  /**
+   * @brief
+   * Selects the program named by argv[0] and parses the whole command line
+   * with its parser. Throws an unexpected_program_error if there is no such
+   * program and otherwise the same exceptions as parse().
+   */
+  multicall_results parse(int argc, const char** argv) const;
+
+  /**
+   * @brief
+   * Same as parse(int, const char**), a const_cast convenience overload.
+   */
+  multicall_results parse(int argc, char** argv) const;
+
+};
+
+
+/**
+ * @brief
+ * Validates the program names, which must be unique, non-empty and free of
+ * '/', and builds a @ref multicall_registry for them. If they are invalid a
+ * std::invalid_argument is thrown, which is a compile error when the result
+ * is assigned to a constexpr variable.
+ */
+template <std::size_t N>
+constexpr multicall_registry<N> make_multicall_registry(
+  const subcommand (&programs)[N]);
+
+
+/**
+ * @brief
+ * Writes the list of programs in a multicall_registry.
+ */
+template <std::size_t N>
+std::ostream& operator << (
+  std::ostream& os,
+  const multicall_registry<N>& x);
+
+
+/**
+ * @brief
+ * A convenience output stream that will accumulate what is streamed to it and
+ * then, on destruction, format the accumulated string (via the
+ * argagg::fmt_string() function) to the provided std::ostream.
+ *
+ * Example use:
+ *
+ * @code
+ * {
+ *   argagg::fmt_ostream f(std::cerr);
+ *   f << "Usage: " << really_long_string << '\n';
+ * } // on destruction here the formatted string will be streamed to std::cerr
+ * @endcode
+ */
+struct fmt_ostream : public std::ostringstream {
+
+  /**
+   * @brief
+   * Reference to the final output stream that the formatted string will be
+   * streamed to.
+   */
+  std::ostream& output;
+
+  /**
+   * @brief
+   * Construct to output to the provided output stream when this object is
+   * destroyed.
+   */
+  fmt_ostream(std::ostream& output);
+
+  /**
+   * @brief
+   * Special destructor that will format the accumulated string using fmt (via
+   * the argagg::fmt_string() function) and stream it to the std::ostream
+   * stored.
+   */
+  ~fmt_ostream();
+
+};
+
+
+/**
+ * @brief
+ * Processes the provided string using the fmt utility and returns the
+ * resulting output as a string. Not the most efficient (in time or space) but
+ * gets the job done.
+ */
+std::string fmt_string(const std::string& s);
+
+
+/**
+ * @brief
+ * Writes the option help to the given stream.
+ */
+std::ostream& operator << (std::ostream& os, const argagg::parser& x);
+
+
+} // namespace argagg
+
+
+// ---- end of declarations, header-only implementations follow ----
+
+
+namespace argagg {
+
+
+template <typename A, typename B>
+struct concat_index_sequence;
+
+
+template <std::size_t... A, std::size_t... B>
+struct concat_index_sequence<index_sequence<A...>, index_sequence<B...>> {
+  using type = index_sequence<A..., (sizeof...(A) + B)...>;
+};
+
+
+// Builds the sequence by halves so the template recursion depth is
+// logarithmic in N.
+template <std::size_t N>
+struct make_index_sequence_impl {
+  using type = typename concat_index_sequence<
+    typename make_index_sequence_impl<N / 2>::type,
+    typename make_index_sequence_impl<N - N / 2>::type>::type;
+};
+
+
+template <>
+struct make_index_sequence_impl<0> {
+  using type = index_sequence<>;
+};
+
+
+template <>
+struct make_index_sequence_impl<1> {
+  using type = index_sequence<0>;
+};
+
+
+/**
+ * @brief
+ * Equivalent to C++14's std::make_index_sequence.
+ */
+template <std::size_t N>
+using make_index_sequence = typename make_index_sequence_impl<N>::type;
+
+
+// Each character's class is computed once, at compile time, into
+// char_class_table below.
+constexpr
+unsigned char compute_char_class(std::size_t c)
+{
+  return static_cast<unsigned char>(
+    (((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+      (c >= 'A' && c <= 'Z')) ? char_class_alnum : 0) |
+    (c == '-' ? char_class_hyphen : 0) |
+    (c == '=' ? char_class_equal_sign : 0));
+}
+
+
+template <typename Indices>
+struct char_class_table;
+
+
+template <std::size_t... I>
+struct char_class_table<index_sequence<I...>> {
+  static constexpr unsigned char values[sizeof...(I)] = {
+    compute_char_class(I)...};
+};
+
+
+template <std::size_t... I>
+constexpr unsigned char
+char_class_table<index_sequence<I...>>::values[sizeof...(I)];
+
+
+constexpr
+unsigned char char_class(
+  char c)
+{
+  return char_class_table<make_index_sequence<256>>::values[
+    static_cast<unsigned char>(c)];
+}
+
+
+constexpr
+bool char_is_alnum(
+  char c)
+{
+  return (char_class(c) & char_class_alnum) != 0;
+}
+
+
+template <typename T>
+T option_result::as() const
+{
+  if (this->arg) {
+    return convert::arg<T>(this->arg);
+  } else {
+    throw option_lacks_argument_error("option has no argument");
+  }
+}
+
+
+template <typename T>
+T option_result::as(const T& t) const
+{
+  if (this->arg) {
+    try {
+      return convert::arg<T>(this->arg);
+    } catch (...) {
+      return t;
+    }
+  } else {
+    // I actually think this will never happen. To call this method you have
+    // to access a specific option_result for an option. If there's a
+    // specific option_result then the option was found. If the option
+    // requires an argument then it will definitely have an argument
+    // otherwise the parser would have complained.
+    return t;
+  }
+}
+
+
+template <typename T>
+option_result::operator T () const
+{
+  return this->as<T>();
+}
+
+
+template <> inline
+option_result::operator bool () const
+{
+  return this->arg != nullptr;
+}
+
+
+inline
+bool option_result::operator ! () const
+{
+  return !static_cast<bool>(*this);
+}
+
+
+inline
+option_result* option_result_span::begin() const
+{
+  return this->first;
+}
+
+
+inline
+option_result* option_result_span::end() const
+{
+  return this->first + this->len;
+}
+
+
+inline
+option_result* option_result_span::data() const
+{
+  return this->first;
+}
+
+
+inline
+std::size_t option_result_span::size() const
+{
+  return this->len;
+}
+
+
+inline
+bool option_result_span::empty() const
+{
+  return this->len == 0;
+}
+
+
+inline
+option_result& option_result_span::operator [] (std::size_t index) const
+{
+  return this->first[index];
+}
+
+
+inline
+option_result& option_result_span::front() const
+{
+  return this->first[0];
+}
+
+
+inline
+option_result& option_result_span::back() const
+{
+  return this->first[this->len - 1];
+}
+
+
+inline
+std::size_t option_results::count() const
+{
+  return this->all.size();
+}
+
+
+inline
+option_result& option_results::operator [] (std::size_t index)
+{
+  return this->all[index];
+}
+
+
+inline
+const option_result& option_results::operator [] (std::size_t index) const
+{
+  return this->all[index];
+}
+
+
+template <typename T>
+T option_results::as() const
+{
+  if (this->all.size() == 0) {
+    throw std::out_of_range("no option arguments to convert");
+  }
+  return this->all.back().as<T>();
+}
+
+
+template <typename T>
+T option_results::as(const T& t) const
+{
+  if (this->all.size() == 0) {
+    return t;
+  }
+  return this->all.back().as<T>(t);
+}
+
+
+template <typename T>
+option_results::operator T () const
+{
+  return this->as<T>();
+}
+
+
+template <> inline
+option_results::operator bool () const
+{
+  return this->all.size() > 0;
+}
+
+
+inline
+bool option_results::operator ! () const
+{
+  return !static_cast<bool>(*this);
+}
+
+
+template <typename T>
+typed_option_handle<T>::operator option_handle () const
+{
+  return option_handle {this->index};
+}
+
+
+inline
+monotonic_arena::monotonic_arena(std::size_t block_size)
+: blocks_(nullptr), cursor_(nullptr), end_(nullptr),
+  next_block_size_(std::max(block_size, sizeof(block_header) + 1))
+{
+}
+
+
+inline
+monotonic_arena::~monotonic_arena()
+{
+  this->release();
+}
+
+
+inline
+void* monotonic_arena::allocate(std::size_t bytes, std::size_t alignment)
+{
+  auto aligned = [&]() {
+      const auto address = reinterpret_cast<std::uintptr_t>(this->cursor_);
+      return reinterpret_cast<char*>(
+        (address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1));
+    };
+  // Aligning can move p past the end of the block, so compare before taking
+  // the (then negative) distance to the end.
+  char* p = aligned();
+  if (this->cursor_ == nullptr || p > this->end_ ||
+      static_cast<std::size_t>(this->end_ - p) < bytes) {
+    // Start a new block big enough for this allocation. Blocks start with a
+    // header linking them together so release() can free them.
+    std::size_t size = this->next_block_size_;
+    while (size < sizeof(block_header) + alignment + bytes) {
+      size *= 2;
+    }
+    auto* block = static_cast<block_header*>(::operator new(size));
+    block->next = this->blocks_;
+    this->blocks_ = block;
+    this->cursor_ = reinterpret_cast<char*>(block + 1);
+    this->end_ = reinterpret_cast<char*>(block) + size;
+    this->next_block_size_ = size * 2;
+    p = aligned();
+  }
+  this->cursor_ = p + bytes;
+  return p;
+}
+
+
+inline
+void monotonic_arena::deallocate(void*, std::size_t, std::size_t)
+{
+}
+
+
+inline
+void monotonic_arena::release()
+{
+  while (this->blocks_ != nullptr) {
+    block_header* next = this->blocks_->next;
+    ::operator delete(this->blocks_);
+    this->blocks_ = next;
+  }
+  this->cursor_ = nullptr;
+  this->end_ = nullptr;
+}
+
+
+template <typename T>
+results_allocator<T>::results_allocator(results_memory* memory) noexcept
+: memory(memory)
+{
+}
+
+
+template <typename T>
+template <typename U>
+results_allocator<T>::results_allocator(
+  const results_allocator<U>& other) noexcept
+: memory(other.memory)
+{
+}
+
+
+template <typename T>
+T* results_allocator<T>::allocate(std::size_t n)
+{
+  if (this->memory == nullptr) {
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+  return static_cast<T*>(this->memory->allocate(n * sizeof(T), alignof(T)));
+}
+
+
+template <typename T>
+void results_allocator<T>::deallocate(T* p, std::size_t n) noexcept
+{
+  if (this->memory == nullptr) {
+    ::operator delete(p);
+  } else {
+    this->memory->deallocate(p, n * sizeof(T), alignof(T));
+  }
+}
+
+
+template <typename T, typename U>
+bool operator == (const results_allocator<T>& a, const results_allocator<U>& b)
+{
+  return a.memory == b.memory;
+}
+
+
+template <typename T, typename U>
+bool operator != (const results_allocator<T>& a, const results_allocator<U>& b)
+{
+  return a.memory != b.memory;
+}
+
+
+inline
+const char** argv_span::begin() const
+{
+  return this->data;
+}
+
+
+inline
+const char** argv_span::end() const
+{
+  return this->data + this->size;
+}
+
+
+inline
+bool argv_span::empty() const
+{
+  return this->size == 0;
+}
+
+
+inline
+parser_results::parser_results()
+: parser_results(nullptr)
+{
+}
+
+
+inline
+parser_results::parser_results(results_memory* memory)
+: program(nullptr), options(memory), ordinals(memory), values(memory),
+  value_ordinals(memory), pos(), pos_lengths(), remainder {nullptr, 0},
+  names()
+{
+}
+
+
+inline
+parser_results::parser_results(const parser_results& other)
+: program(other.program), options(other.options), ordinals(other.ordinals),
+  values(other.values), value_ordinals(other.value_ordinals),
+  pos(other.pos), pos_lengths(other.pos_lengths),
+  remainder(other.remainder), names(other.names)
+{
+  // The copied spans still point into other's buffer.
+  for (auto& opt_results : this->options) {
+    if (opt_results.all.first != nullptr) {
+      opt_results.all.first =
+        this->values.data() + (opt_results.all.first - other.values.data());
+    }
+  }
+}
+
+
+inline
+parser_results& parser_results::operator = (const parser_results& other)
+{
+  if (this != &other) {
+    parser_results copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+
+/**
+ * @brief
+ * Looks up a definition's ordinal in a name index. Returns false if the index
+ * is nullptr or doesn't contain the name.
+ */
+inline
+bool find_option_index(
+  const option_name_index* names,
+  const std::string& name,
+  std::size_t& index)
+{
+  if (names == nullptr) {
+    return false;
+  }
+  const auto it = names->find(name);
+  if (it == names->end()) {
+    return false;
+  }
+  index = it->second;
+  return true;
+}
+
+
+inline
+bool parser_results::has_option(const std::string& name) const
+{
+  std::size_t index = 0;
+  return find_option_index(this->names.get(), name, index) &&
+         this->has_option(option_handle {index});
+}
+
+
+inline
+bool parser_results::has_option(option_handle handle) const
+{
+  const option_results* results = this->find(handle);
+  return results != nullptr && results->all.size() > 0;
+}
+
+
+inline
+option_handle parser_results::handle(const std::string& name) const
+{
+  std::size_t index = 0;
+  if (!find_option_index(this->names.get(), name, index)) {
+    std::ostringstream msg;
+    msg << "no option named \"" << name << "\" in parser_results";
+    throw unknown_option(msg.str());
+  }
+  return option_handle {index};
+}
+
+
+inline
+const option_results* parser_results::find(option_handle handle) const
+{
+  const auto it = std::lower_bound(
+    this->ordinals.begin(), this->ordinals.end(), handle.index);
+  if (it == this->ordinals.end() || *it != handle.index) {
+    return nullptr;
+  }
+  return &this->options[static_cast<std::size_t>(it - this->ordinals.begin())];
+}
+
+
+inline
+option_results& parser_results::emplace(option_handle handle)
+{
+  const auto it = std::lower_bound(
+    this->ordinals.begin(), this->ordinals.end(), handle.index);
+  const auto i = it - this->ordinals.begin();
+  if (it == this->ordinals.end() || *it != handle.index) {
+    this->ordinals.insert(it, handle.index);
+    this->options.insert(this->options.begin() + i, option_results {});
+  }
+  return this->options[static_cast<std::size_t>(i)];
+}
+
+
+inline
+option_results& parser_results::operator [] (const std::string& name)
+{
+  return (*this)[this->handle(name)];
+}
+
+
+inline
+const option_results&
+parser_results::operator [] (const std::string& name) const
+{
+  return (*this)[this->handle(name)];
+}
+
+
+inline
+option_results& parser_results::operator [] (option_handle handle)
+{
+  return this->emplace(handle);
+}
+
+
+inline
+const option_results&
+parser_results::operator [] (option_handle handle) const
+{
+  static const option_results absent {};
+  const option_results* results = this->find(handle);
+  return results != nullptr ? *results : absent;
+}
+
+
+template <typename T>
+T parser_results::get(typed_option_handle<T> handle) const
+{
+  return (*this)[option_handle(handle)].template as<T>();
+}
+
+
+template <typename T>
+T parser_results::get(typed_option_handle<T> handle, const T& t) const
+{
+  return (*this)[option_handle(handle)].as(t);
+}
+
+
+inline
+std::size_t parser_results::count() const
+{
+  return this->pos.size();
+}
+
+
+inline
+const char* parser_results::operator [] (std::size_t index) const
+{
+  return this->pos[index];
+}
+
+
+template <typename T>
+T parser_results::as(std::size_t i) const
+{
+  return convert::arg<T>(this->pos[i]);
+}
+
+
+template <typename T>
+std::vector<T> parser_results::all_as() const
+{
+  std::vector<T> v(this->pos.size());
+  std::transform(
+    this->pos.begin(), this->pos.end(), v.begin(),
+    [](const char* arg) {
+      return convert::arg<T>(arg);
+    });
+  return v;
+}
+
+
+inline
+bool definition::wants_no_arguments() const
+{
+  return this->num_args == 0;
+}
+
+
+inline
+bool definition::requires_arguments() const
+{
+  return this->num_args > 0;
+}
+
+
+inline
+bool arg_token::is_flag() const
+{
+  return this->kind == arg_kind::short_group ||
+         this->kind == arg_kind::long_flag;
+}
+
+
+/**
+ * @brief
+ * Scans a long flag name starting at its second character (the first must be
+ * checked by the caller) and returns a pointer to the terminating equal sign
+ * or null character. Clears valid if any character before that isn't
+ * alpha-numeric or a hyphen.
+ */
+inline
+const char* scan_long_flag_name_scalar(
+  const char* c,
+  bool& valid)
+{
+  const unsigned char name_class = char_class_alnum | char_class_hyphen;
+  for (; *c != '\0' && *c != '='; ++c) {
+    valid = valid && (char_class(*c) & name_class) != 0;
+  }
+  return c;
+}
+
+
+/**
+ * @brief
+ * Same as scan_long_flag_name_scalar() for a name that ends at end instead
+ * of at a null character. Returns a pointer to the equal sign or end, and
+ * never reads at or past end. A null character is an invalid name character.
+ */
+inline
+const char* scan_sized_long_flag_name_scalar(
+  const char* c,
+  const char* end,
+  bool& valid)
+{
+  const unsigned char name_class = char_class_alnum | char_class_hyphen;
+  for (; c != end && *c != '='; ++c) {
+    valid = valid && (char_class(*c) & name_class) != 0;
+  }
+  return c;
+}
+
+
+#ifdef ARGAGG_HAS_X86_SIMD
+
+// The vectorized scanners use aligned loads which may read past the null
+// terminator but never across a page boundary. That is safe in practice but
+// confuses AddressSanitizer, so opt those functions out of it.
+#if defined(__clang__) || defined(__SANITIZE_ADDRESS__)
+#define ARGAGG_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define ARGAGG_NO_SANITIZE_ADDRESS
+#endif
+
+
+/**
+ * @brief
+ * Returns a mask with a bit set for each of the 16 bytes of v that is an
+ * ASCII letter, digit or hyphen. Bytes >= 0x80 are negative in the signed
+ * comparisons and so are never considered alpha-numeric, as in the "C"
+ * locale.
+ */
+inline
+unsigned int long_flag_name_chars_sse2(__m128i v)
+{
+  const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+  return static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(
+    _mm_or_si128(
+      _mm_and_si128(
+        _mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+        _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1))),
+      _mm_and_si128(
+        _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+        _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)))),
+    _mm_cmpeq_epi8(v, _mm_set1_epi8('-')))));
+}
+
+
+/**
+ * @brief
+ * SSE2 version of scan_long_flag_name_scalar().
+ */
+ARGAGG_NO_SANITIZE_ADDRESS inline
+const char* scan_long_flag_name_sse2(
+  const char* c,
+  bool& valid)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i equal_sign = _mm_set1_epi8('=');
+
+  // Start from the aligned block containing c and mask off the bytes in front
+  // of it.
+  const auto offset = reinterpret_cast<std::uintptr_t>(c) & 15u;
+  const char* block = c - offset;
+  unsigned int mask = (0xffffu << offset) & 0xffffu;
+  for (;;) {
+    const __m128i v =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+    const auto stop = static_cast<unsigned int>(_mm_movemask_epi8(
+      _mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, equal_sign))))
+      & mask;
+    const unsigned int bad = ~long_flag_name_chars_sse2(v) & mask;
+    if (stop != 0) {
+      const auto i = static_cast<unsigned int>(__builtin_ctz(stop));
+      valid = valid && (bad & ((1u << i) - 1u)) == 0;
+      return block + i;
+    }
+    valid = valid && bad == 0;
+    block += 16;
+    mask = 0xffffu;
+  }
+}
+
+
+/**
+ * @brief
+ * SSE2 version of scan_sized_long_flag_name_scalar(). Whole 16 byte blocks
+ * are loaded unaligned so nothing at or past end is read, and the last
+ * partial block is left to the scalar scanner.
+ */
+inline
+const char* scan_sized_long_flag_name_sse2(
+  const char* c,
+  const char* end,
+  bool& valid)
+{
+  const __m128i equal_sign = _mm_set1_epi8('=');
+  for (; end - c >= 16; c += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c));
+    const auto stop = static_cast<unsigned int>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(v, equal_sign)));
+    const unsigned int bad = ~long_flag_name_chars_sse2(v) & 0xffffu;
+    if (stop != 0) {
+      const auto i = static_cast<unsigned int>(__builtin_ctz(stop));
+      valid = valid && (bad & ((1u << i) - 1u)) == 0;
+      return c + i;
+    }
+    valid = valid && bad == 0;
+  }
+  return scan_sized_long_flag_name_scalar(c, end, valid);
+}
+
+
+/**
+ * @brief
+ * AVX2 version of long_flag_name_chars_sse2() for 32 bytes.
+ */
+__attribute__((target("avx2"))) inline
+unsigned int long_flag_name_chars_avx2(__m256i v)
+{
+  const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+  return static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_or_si256(
+    _mm256_or_si256(
+      _mm256_and_si256(
+        _mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v)),
+      _mm256_and_si256(
+        _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower))),
+    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')))));
+}
+
+
+/**
+ * @brief
+ * AVX2 version of scan_long_flag_name_scalar(). Only called after
+ * best_simd_level() has confirmed the CPU supports AVX2.
+ */
+ARGAGG_NO_SANITIZE_ADDRESS __attribute__((target("avx2"))) inline
+const char* scan_long_flag_name_avx2(
+  const char* c,
+  bool& valid)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i equal_sign = _mm256_set1_epi8('=');
+
+  const auto offset = reinterpret_cast<std::uintptr_t>(c) & 31u;
+  const char* block = c - offset;
+  unsigned int mask = 0xffffffffu << offset;
+  for (;;) {
+    const __m256i v =
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(block));
+    const auto stop = static_cast<unsigned int>(_mm256_movemask_epi8(
+      _mm256_or_si256(
+        _mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, equal_sign))))
+      & mask;
+    const unsigned int bad = ~long_flag_name_chars_avx2(v) & mask;
+    if (stop != 0) {
+      const auto i = static_cast<unsigned int>(__builtin_ctz(stop));
+      valid = valid && (bad & ((1u << i) - 1u)) == 0;
+      return block + i;
+    }
+    valid = valid && bad == 0;
+    block += 32;
+    mask = 0xffffffffu;
+  }
+}
+
+
+/**
+ * @brief
+ * AVX2 version of scan_sized_long_flag_name_sse2(), which handles what is
+ * left after the last whole 32 byte block.
+ */
+__attribute__((target("avx2"))) inline
+const char* scan_sized_long_flag_name_avx2(
+  const char* c,
+  const char* end,
+  bool& valid)
+{
+  const __m256i equal_sign = _mm256_set1_epi8('=');
+  for (; end - c >= 32; c += 32) {
+    const __m256i v =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+    const auto stop = static_cast<unsigned int>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, equal_sign)));
+    const unsigned int bad = ~long_flag_name_chars_avx2(v);
+    if (stop != 0) {
+      const auto i = static_cast<unsigned int>(__builtin_ctz(stop));
+      valid = valid && (bad & ((1u << i) - 1u)) == 0;
+      return c + i;
+    }
+    valid = valid && bad == 0;
+  }
+  return scan_sized_long_flag_name_sse2(c, end, valid);
+}
+
+#endif // ARGAGG_HAS_X86_SIMD
+
+
+/**
+ * @brief
+ * Implementation of lex_arg() parameterized on the long flag name scanner.
+ */
+template <const char* (*ScanLongFlagName)(const char*, bool&)>
+arg_token lex_arg_with(
+  const char* s)
+{
+  arg_token token {arg_kind::positional, s, 0, nullptr, 0, nullptr, 0};
+
+  // All flags must start with a hyphen and the shortest possible flag has two
+  // characters: a hyphen and an alpha-numeric character.
+  if (s[0] != '-' || s[1] == '\0') {
+    token.len = std::strlen(s);
+    return token;
+  }
+
+  // Short flags and short flag groups. The first character after the hyphen
+  // must be alpha-numeric. We can't say anything about the rest of the group
+  // since it might be an argument for one of the flags (e.g.
+  // "-I/usr/local/include"). We leave that kind of processing to the parser.
+  if (s[1] != '-') {
+    token.len = std::strlen(s);
+    if (char_is_alnum(s[1])) {
+      token.kind = arg_kind::short_group;
+      token.name = s + 1;
+      token.name_len = token.len - 1;
+    }
+    return token;
+  }
+
+  // Just -- is not a valid flag, it stops flag processing.
+  if (s[2] == '\0') {
+    token.kind = arg_kind::terminator;
+    token.len = 2;
+    return token;
+  }
+
+  // Long flags. The first character of the flag name must be alpha-numeric
+  // to prevent things like "---a" from being valid flags. All characters *up
+  // to* an equal sign must be alpha-numeric or a hyphen. After the equal sign
+  // is the argument which can be basically anything.
+  bool valid = char_is_alnum(s[2]);
+  const char* c = ScanLongFlagName(s + 3, valid);
+  const auto name_len = static_cast<std::size_t>(c - s);
+  const char* value = nullptr;
+  std::size_t value_len = 0;
+  if (*c == '=') {
+    value = c + 1;
+    value_len = std::strlen(value);
+  }
+  token.len = name_len + (value != nullptr ? value_len + 1 : 0);
+  if (valid) {
+    token.kind = arg_kind::long_flag;
+    token.name = s;
+    token.name_len = name_len;
+    token.value = value;
+    token.value_len = value_len;
+  }
+  return token;
+}
+
+
+inline
+simd_level best_simd_level()
+{
+#ifdef ARGAGG_HAS_X86_SIMD
+  static const simd_level level = []() {
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") ? simd_level::avx2
+                                            : simd_level::sse2;
+    }();
+  return level;
+#else
+  return simd_level::scalar;
+#endif
+}
+
+
+inline
+arg_token lex_arg(
+  const char* s)
+{
+#ifdef ARGAGG_HAS_X86_SIMD
+  switch (best_simd_level()) {
+    case simd_level::avx2:
+      return lex_arg_with<scan_long_flag_name_avx2>(s);
+    case simd_level::sse2:
+      return lex_arg_with<scan_long_flag_name_sse2>(s);
+    case simd_level::scalar:
+      break;
+  }
+#endif
+  return lex_arg_with<scan_long_flag_name_scalar>(s);
+}
+
+
+/**
+ * @brief
+ * Implementation of lex_arg(const char*, std::size_t) parameterized on the
+ * sized long flag name scanner. Follows lex_arg_with() above but takes every
+ * length from len and never reads at or past s + len.
+ */
+template <const char* (*ScanLongFlagName)(const char*, const char*, bool&)>
+arg_token lex_sized_arg_with(
+  const char* s,
+  std::size_t len)
+{
+  arg_token token {arg_kind::positional, s, len, nullptr, 0, nullptr, 0};
+
+  if (len < 2 || s[0] != '-') {
+    return token;
+  }
+
+  if (s[1] != '-') {
+    if (char_is_alnum(s[1])) {
+      token.kind = arg_kind::short_group;
+      token.name = s + 1;
+      token.name_len = len - 1;
+    }
+    return token;
+  }
+
+  if (len == 2) {
+    token.kind = arg_kind::terminator;
+    return token;
+  }
+
+  // An embedded null character is not a valid name character, so such
+  // arguments are never flags.
+  const char* end = s + len;
+  bool valid = char_is_alnum(s[2]);
+  const char* c = ScanLongFlagName(s + 3, end, valid);
+  const auto name_len = static_cast<std::size_t>(c - s);
+  const char* value = nullptr;
+  std::size_t value_len = 0;
+  if (c != end) {
+    value = c + 1;
+    value_len = len - name_len - 1;
+  }
+  if (valid) {
+    token.kind = arg_kind::long_flag;
+    token.name = s;
+    token.name_len = name_len;
+    token.value = value;
+    token.value_len = value_len;
+  }
+  return token;
+}
+
+
+inline
+arg_token lex_arg(
+  const char* s,
+  std::size_t len)
+{
+#ifdef ARGAGG_HAS_X86_SIMD
+  switch (best_simd_level()) {
+    case simd_level::avx2:
+      return lex_sized_arg_with<scan_sized_long_flag_name_avx2>(s, len);
+    case simd_level::sse2:
+      return lex_sized_arg_with<scan_sized_long_flag_name_sse2>(s, len);
+    case simd_level::scalar:
+      break;
+  }
+#endif
+  return lex_sized_arg_with<scan_sized_long_flag_name_scalar>(s, len);
+}
+
+
+inline
+arg_view to_arg_view(const char* s)
+{
+  return arg_view {s, std::strlen(s)};
+}
+
+
+inline
+arg_view to_arg_view(const arg_view& s)
+{
+  return s;
+}
+
+
+inline
+arg_view to_arg_view(const std::string& s)
+{
+  return arg_view {s.c_str(), s.size()};
+}
+
+
+inline
+arg_view to_arg_view(const std::pair<const char*, std::size_t>& s)
+{
+  return arg_view {s.first, s.second};
+}
+
+
+#ifdef ARGAGG_HAS_STRING_VIEW
+inline
+arg_view to_arg_view(std::string_view s)
+{
+  return arg_view {s.data(), s.size()};
+}
+#endif
+
+
+inline
+response_files::response_files(int argc, const char** argv)
+{
+  if (argc > 0) {
+    this->args_.push_back(to_arg_view(argv[0]));
+  }
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    this->expand(arg, std::strlen(arg), 0);
+  }
+}
+
+
+inline
+response_files::response_files(int argc, char** argv)
+: response_files(argc, const_cast<const char**>(argv))
+{
+}
+
+
+inline
+response_files::response_files(response_files&& other) noexcept
+: args_(std::move(other.args_)), mappings_(std::move(other.mappings_)),
+  buffers_(std::move(other.buffers_))
+{
+  other.mappings_.clear();
+}
+
+
+inline
+response_files& response_files::operator = (response_files&& other) noexcept
+{
+  if (this != &other) {
+    this->unmap();
+    this->args_ = std::move(other.args_);
+    this->mappings_ = std::move(other.mappings_);
+    this->buffers_ = std::move(other.buffers_);
+    other.mappings_.clear();
+  }
+  return *this;
+}
+
+
+inline
+response_files::~response_files()
+{
+  this->unmap();
+}
+
+
+inline
+const arg_view* response_files::begin() const
+{
+  return this->args_.data();
+}
+
+
+inline
+const arg_view* response_files::end() const
+{
+  return this->args_.data() + this->args_.size();
+}
+
+
+inline
+std::size_t response_files::size() const
+{
+  return this->args_.size();
+}
+
+
+inline
+void response_files::expand(const char* arg, std::size_t len, unsigned depth)
+{
+  if (len > 1 && arg[0] == '@' && this->load(arg + 1, depth)) {
+    return;
+  }
+  this->args_.push_back(arg_view {arg, len});
+}
+
+
+inline
+bool response_files::load(const char* path, unsigned depth)
+{
+  if (depth >= max_depth) {
+    std::ostringstream msg;
+    msg << "response files nested more than " << max_depth
+        << " levels deep at \"" << path << "\"";
+    throw response_file_error(msg.str());
+  }
+
+  const auto fail = [&](const char* what, int error) {
+      std::ostringstream msg;
+      msg << "failed to " << what << " response file \"" << path << "\": "
+          << std::strerror(error);
+      throw response_file_error(msg.str());
+    };
+
+#ifdef ARGAGG_HAS_MMAP
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    const int error = errno;
+    ::close(fd);
+    fail("stat", error);
+  }
+  if (S_ISDIR(info.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+  if (!S_ISREG(info.st_mode)) {
+    // Pipes and other special files (e.g. "@<(find . -print0)") can't be
+    // mapped so read them instead.
+    std::vector<char> contents;
+    char chunk[4096];
+    ::ssize_t num_read;
+    while ((num_read = ::read(fd, chunk, sizeof(chunk))) != 0) {
+      if (num_read < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        const int error = errno;
+        ::close(fd);
+        fail("read", error);
+      }
+      contents.insert(contents.end(), chunk, chunk + num_read);
+    }
+    ::close(fd);
+    this->tokenize_copy(contents, depth + 1);
+    return true;
+  }
+  const auto size = static_cast<std::size_t>(info.st_size);
+  if (size == 0) {
+    ::close(fd);
+    return true;
+  }
+  // A private writable mapping lets the tokenizer write null terminators and
+  // unquote arguments in place without modifying the file. Only the pages
+  // that are written to get copied, which is nearly every page of a
+  // whitespace delimited file and none of a null delimited one.
+  void* data = ::mmap(
+    nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  const int error = errno;
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    fail("map", error);
+  }
+  this->mappings_.push_back(mapping {static_cast<char*>(data), size});
+#ifdef MADV_SEQUENTIAL
+  ::madvise(data, size, MADV_SEQUENTIAL);
+#endif
+  // The rest of the last page reads as zeros and may be written to, so there
+  // is room for a terminator after the last argument unless the file ends on
+  // a page boundary.
+  const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  char* first = static_cast<char*>(data);
+  this->tokenize(first, first + size, size % page_size != 0, depth + 1);
+#else
+  std::FILE* file = std::fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  std::vector<char> contents;
+  char chunk[4096];
+  std::size_t num_read;
+  while ((num_read = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    contents.insert(contents.end(), chunk, chunk + num_read);
+  }
+  const int error = std::ferror(file) == 0 ? 0 : errno != 0 ? errno : EIO;
+  std::fclose(file);
+  if (error != 0) {
+    fail("read", error);
+  }
+  this->tokenize_copy(contents, depth + 1);
+#endif
+  return true;
+}
+
+
+inline
+void response_files::tokenize_copy(
+  const std::vector<char>& contents,
+  unsigned depth)
+{
+  std::unique_ptr<char[]> buffer(new char[contents.size() + 1]);
+  std::copy(contents.begin(), contents.end(), buffer.get());
+  buffer[contents.size()] = '\0';
+  char* first = buffer.get();
+  this->buffers_.push_back(std::move(buffer));
+  this->tokenize(first, first + contents.size(), true, depth);
+}
+
+
+inline
+void response_files::tokenize(
+  char* first,
+  char* last,
+  bool writable_end,
+  unsigned depth)
+{
+  // Null delimited arguments are already terminated, except perhaps the last.
+  if (std::memchr(first, '\0', static_cast<std::size_t>(last - first)) !=
+      nullptr) {
+    while (first != last) {
+      char* end = static_cast<char*>(
+        std::memchr(first, '\0', static_cast<std::size_t>(last - first)));
+      const bool terminated = end != nullptr || writable_end;
+      if (end == nullptr) {
+        end = last;
+      }
+      this->add(
+        first, static_cast<std::size_t>(end - first), terminated, depth);
+      first = end == last ? last : end + 1;
+    }
+    return;
+  }
+
+  // Whitespace delimited arguments are unquoted in place. The unquoted
+  // argument is never longer than what was read so writing can't overtake
+  // reading, and whatever ended the argument is overwritten by its
+  // terminator.
+  const auto is_space = [](char c) {
+      return c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+             c == '\f' || c == '\v';
+    };
+  char* read = first;
+  while (true) {
+    while (read != last && is_space(*read)) {
+      ++read;
+    }
+    if (read == last) {
+      return;
+    }
+    char* arg = read;
+    char* write = read;
+    char quote = '\0';
+    for (; read != last && (quote != '\0' || !is_space(*read)); ++read) {
+      if (*read == '\\' && read + 1 != last) {
+        *write++ = *++read;
+      } else if (quote == '\0' && (*read == '\'' || *read == '"')) {
+        quote = *read;
+      } else if (*read == quote) {
+        quote = '\0';
+      } else {
+        *write++ = *read;
+      }
+    }
+    const bool terminated = write != last || writable_end;
+    this->add(arg, static_cast<std::size_t>(write - arg), terminated, depth);
+    if (read != last) {
+      ++read;
+    }
+  }
+}
+
+
+inline
+void response_files::add(
+  char* arg,
+  std::size_t len,
+  bool terminated,
+  unsigned depth)
+{
+  if (terminated) {
+    // Null delimited arguments already end in a terminator. Only writing one
+    // when it is missing keeps their pages from being copied.
+    if (arg[len] != '\0') {
+      arg[len] = '\0';
+    }
+  } else {
+    std::unique_ptr<char[]> copy(new char[len + 1]);
+    std::memcpy(copy.get(), arg, len);
+    copy[len] = '\0';
+    arg = copy.get();
+    this->buffers_.push_back(std::move(copy));
+  }
+  this->expand(arg, len, depth);
+}
+
+
+inline
+void response_files::unmap()
+{
+#ifdef ARGAGG_HAS_MMAP
+  for (const auto& m : this->mappings_) {
+    ::munmap(m.data, m.size);
+  }
+#endif
+  this->mappings_.clear();
+}
+
+
+template <typename OutputIt>
+OutputIt split_command_line(char* first, char* last, OutputIt out)
+{
+  const auto is_space = [](char c) {
+      return c == ' ' || c == '\t' || c == '\n';
+    };
+
+  // The unquoted argument is never longer than what was read so writing
+  // can't overtake reading, and whatever ended the argument is overwritten
+  // by its terminator.
+  char* read = first;
+  while (true) {
+    while (read != last && is_space(*read)) {
+      ++read;
+    }
+    if (read == last) {
+      return out;
+    }
+    char* arg = read;
+    char* write = read;
+    while (read != last && !is_space(*read)) {
+      const char c = *read++;
+      if (c == '\\') {
+        if (read == last) {
+          throw command_line_error("command line ends with a backslash");
+        }
+        if (*read != '\n') {
+          *write++ = *read;
+        }
+        ++read;
+      } else if (c == '\'') {
+        char* close = static_cast<char*>(
+          std::memchr(read, '\'', static_cast<std::size_t>(last - read)));
+        if (close == nullptr) {
+          throw command_line_error("unterminated single quote in command line");
+        }
+        std::memmove(write, read, static_cast<std::size_t>(close - read));
+        write += close - read;
+        read = close + 1;
+      } else if (c == '"') {
+        for (; read != last && *read != '"'; ++read) {
+          if (*read == '\\' && read + 1 != last &&
+              (read[1] == '$' || read[1] == '`' || read[1] == '"' ||
+               read[1] == '\\' || read[1] == '\n')) {
+            ++read;
+            if (*read == '\n') {
+              continue;
+            }
+          }
+          *write++ = *read;
+        }
+        if (read == last) {
+          throw command_line_error("unterminated double quote in command line");
+        }
+        ++read;
+      } else {
+        *write++ = c;
+      }
+    }
+    *write = '\0';
+    *out++ = arg_view {arg, static_cast<std::size_t>(write - arg)};
+    if (read != last) {
+      ++read;
+    }
+  }
+}
+
+
+inline
+void command_line::split(const char* command, std::size_t len)
+{
+  this->buffer_.assign(command, command + len);
+  this->buffer_.push_back('\0');
+  this->args_.clear();
+  char* first = this->buffer_.data();
+  split_command_line(first, first + len, std::back_inserter(this->args_));
+}
+
+
+inline
+void command_line::split(const char* command)
+{
+  this->split(command, std::strlen(command));
+}
+
+
+inline
+void command_line::split(const std::string& command)
+{
+  this->split(command.data(), command.size());
+}
+
+
+inline
+const arg_view* command_line::begin() const
+{
+  return this->args_.data();
+}
+
+
+inline
+const arg_view* command_line::end() const
+{
+  return this->args_.data() + this->args_.size();
+}
+
+
+inline
+std::size_t command_line::size() const
+{
+  return this->args_.size();
+}
+
+
+/**
+ * @brief
+ * Applies lex_arg_with() with the given scanner to a batch of arguments.
+ */
+template <const char* (*ScanLongFlagName)(const char*, bool&)>
+void lex_args_with(
+  const char* const* first,
+  const char* const* last,
+  arg_token* out)
+{
+  for (; first != last; ++first, ++out) {
+    *out = lex_arg_with<ScanLongFlagName>(*first);
+  }
+}
+
+
+inline
+void lex_args(
+  const char* const* first,
+  const char* const* last,
+  arg_token* out,
+  simd_level level)
+{
+#ifdef ARGAGG_HAS_X86_SIMD
+  switch (level) {
+    case simd_level::avx2:
+      lex_args_with<scan_long_flag_name_avx2>(first, last, out);
+      return;
+    case simd_level::sse2:
+      lex_args_with<scan_long_flag_name_sse2>(first, last, out);
+      return;
+    case simd_level::scalar:
+      break;
+  }
+#else
+  (void)level;
+#endif
+  lex_args_with<scan_long_flag_name_scalar>(first, last, out);
+}
+
+
+inline
+void lex_args(
+  const char* const* first,
+  const char* const* last,
+  arg_token* out)
+{
+  lex_args(first, last, out, best_simd_level());
+}
+
+
+inline
+bool cmd_line_arg_is_option_flag(
+  const char* s)
+{
+  return lex_arg(s).is_flag();
+}
+
+
+inline
+bool is_valid_flag_definition(
+  const char* s)
+{
+  auto len = std::strlen(s);
+
+  // The shortest possible flag has two characters: a hyphen and an
+  // alpha-numeric character.
+  if (len < 2) {
+    return false;
+  }
+
+  // All flags must start with a hyphen.
+  if (s[0] != '-') {
+    return false;
+  }
+
+  // Shift the name forward by a character to account for the initial hyphen.
+  // This means if s was originally "-v" then name will be "v".
+  const char* name = s + 1;
+
+  // Check if we're dealing with a long flag.
+  bool is_long = false;
+  if (s[1] == '-') {
+    is_long = true;
+
+    // Just -- is not a valid flag.
+    if (len == 2) {
+      return false;
+    }
+
+    // Shift the name forward to account for the extra hyphen. This means if s
+    // was originally "--output" then name will be "output".
+    name = s + 2;
+  }
+
+  // The first character of the flag name must be alpha-numeric. This is to
+  // prevent things like "---a" from being valid flags.
+  len = std::strlen(name);
+  if (!char_is_alnum(name[0])) {
+    return false;
+  }
+
+  // If this is a short flag then it must only have one character.
+  if (!is_long && len > 1) {
+    return false;
+  }
+
+  // The rest of the characters must be alpha-numeric, but long flags are
+  // allowed to have hyphens too.
+  const unsigned char name_class =
+    is_long ? (char_class_alnum | char_class_hyphen) : char_class_alnum;
+  return std::all_of(name + 1, name + len, [&](const char& c) {
+      return (char_class(c) & name_class) != 0;
+    });
+}
+
+
+inline
+bool flag_is_short(
+  const char* s)
+{
+  return s[0] == '-' && char_is_alnum(s[1]);
+}
+
+
+inline
+bool flag_is_prefix(
+  const char* s)
+{
+  const auto len = std::strlen(s);
+  return len > 0 && s[len - 1] == '*';
+}
+
+
+inline
+bool is_valid_prefix_flag_definition(
+  const char* s)
+{
+  const auto len = std::strlen(s);
+  if (len < 3 || s[0] != '-' || s[len - 1] != '*') {
+    return false;
+  }
+  const char* name = s[1] == '-' ? s + 2 : s + 1;
+  if (!char_is_alnum(name[0])) {
+    return false;
+  }
+  const char* star = s + len - 1;
+  if (s[1] == '-') {
+    // Otherwise lex_arg() would never classify a matching argument as a long
+    // flag. Short flag groups may contain anything after their first
+    // character.
+    for (const char* c = name + 1; c != star && *c != '='; ++c) {
+      if (!char_is_alnum(*c) && *c != '-') {
+        return false;
+      }
+    }
+  }
+  return std::find(name, star, '*') == star;
+}
+
+
+inline
+bool parser_map::known_short_flag(
+  const char flag) const
+{
+  return this->short_map[static_cast<std::size_t>(flag)] != nullptr;
+}
+
+
+inline
+const definition* parser_map::get_definition_for_short_flag(
+  const char flag) const
+{
+  return this->short_map[static_cast<std::size_t>(flag)];
+}
+
+
+/**
+ * @brief
+ * Finalizer from SplitMix64. Used to spread the bits of the flag hash before
+ * taking it modulo the bucket and slot counts.
+ */
+inline
+std::uint64_t mix_hash(std::uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+
+/**
+ * @brief
+ * Seeded FNV-1a hash of a flag used by @ref long_flag_map.
+ */
+inline
+std::uint64_t hash_flag(
+  const char* flag,
+  std::size_t len,
+  std::uint64_t seed)
+{
+  std::uint64_t h = 14695981039346656037ULL ^ seed;
+  for (std::size_t i = 0; i < len; ++i) {
+    h ^= static_cast<unsigned char>(flag[i]);
+    h *= 1099511628211ULL;
+  }
+  return mix_hash(h);
+}
+
+
+/**
+ * @brief
+ * Slot that a flag with hash h lands on given its bucket's displacement.
+ */
+inline
+std::size_t long_flag_slot(
+  std::uint64_t h,
+  std::uint32_t displacement,
+  std::size_t num_slots)
+{
+  return static_cast<std::size_t>(
+    mix_hash(h + displacement * 0x9e3779b97f4a7c15ULL) % num_slots);
+}
+
+
+/**
+ * @brief
+ * Number of buckets used by a @ref long_flag_map with the given number of
+ * flags. An average of two flags per bucket keeps the displacement table
+ * small while still making the displacement search cheap.
+ */
+inline
+std::size_t long_flag_bucket_count(std::size_t num_flags)
+{
+  return num_flags / 2 + 1;
+}
+
+
+inline
+void long_flag_map::build(std::vector<long_flag_entry> flags)
+{
+  const std::size_t n = flags.size();
+  this->seed = 0;
+  this->displacements.clear();
+  this->entries.clear();
+  if (n == 0) {
+    return;
+  }
+
+  const std::size_t num_buckets = long_flag_bucket_count(n);
+
+  // With a good hash the search below practically always succeeds with the
+  // first seed. A handful of retries covers unlucky seeds; running out means
+  // two flags hash identically under every seed, i.e. they're duplicates.
+  const std::uint64_t max_seeds = 64;
+  const std::uint32_t max_displacement = 1u << 20;
+
+  // Buckets are stored flat: the flags of bucket b are
+  // bucket_flags[bucket_start[b]] through bucket_flags[bucket_start[b + 1]].
+  std::vector<std::uint64_t> hashes(n);
+  std::vector<std::size_t> bucket_start(num_buckets + 1);
+  std::vector<std::size_t> bucket_flags(n);
+  std::vector<std::size_t> order(num_buckets);
+  std::vector<std::size_t> slot_owner(n);
+  std::vector<std::size_t> bucket_slots;
+
+  for (std::uint64_t seed = 0; seed < max_seeds; ++seed) {
+
+    std::fill(bucket_start.begin(), bucket_start.end(), 0);
+    for (std::size_t i = 0; i < n; ++i) {
+      hashes[i] = hash_flag(flags[i].flag.data(), flags[i].flag.size(), seed);
+      ++bucket_start[static_cast<std::size_t>(hashes[i] % num_buckets) + 1];
+    }
+    for (std::size_t b = 0; b < num_buckets; ++b) {
+      bucket_start[b + 1] += bucket_start[b];
+    }
+    {
+      std::vector<std::size_t> fill(bucket_start.begin(), bucket_start.end());
+      for (std::size_t i = 0; i < n; ++i) {
+        bucket_flags[fill[static_cast<std::size_t>(hashes[i] % num_buckets)]++]
+          = i;
+      }
+    }
+    const auto bucket_size = [&](std::size_t b) {
+      return bucket_start[b + 1] - bucket_start[b];
+    };
+
+    // Place the largest buckets first while the table is still mostly empty.
+    for (std::size_t b = 0; b < num_buckets; ++b) {
+      order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(),
+      [&](std::size_t a, std::size_t b) {
+        return bucket_size(a) > bucket_size(b);
+      });
+
+    std::vector<std::uint32_t> displacements(num_buckets, 0);
+    std::fill(slot_owner.begin(), slot_owner.end(), n);
+
+    bool placed_all = true;
+    for (const auto b : order) {
+      const auto first = bucket_flags.begin() +
+        static_cast<std::ptrdiff_t>(bucket_start[b]);
+      const auto last = first + static_cast<std::ptrdiff_t>(bucket_size(b));
+      if (first == last) {
+        break;
+      }
+
+      // Slots only depend on the hash and the displacement so flags with
+      // identical hashes can never be separated. Move on to the next seed
+      // instead of searching every displacement.
+      bool colliding = false;
+      for (auto it = first; it != last && !colliding; ++it) {
+        for (auto other = first; other != it && !colliding; ++other) {
+          colliding = hashes[*it] == hashes[*other];
+        }
+      }
+      if (colliding) {
+        placed_all = false;
+        break;
+      }
+
+      bool placed = false;
+      for (std::uint32_t d = 0; d < max_displacement && !placed; ++d) {
+        bucket_slots.clear();
+        placed = true;
+        for (auto it = first; it != last; ++it) {
+          const auto slot = long_flag_slot(hashes[*it], d, n);
+          const bool taken = slot_owner[slot] != n || std::find(
+            bucket_slots.begin(), bucket_slots.end(), slot) !=
+            bucket_slots.end();
+          if (taken) {
+            placed = false;
+            break;
+          }
+          bucket_slots.push_back(slot);
+        }
+        if (placed) {
+          displacements[b] = d;
+          auto slot = bucket_slots.begin();
+          for (auto it = first; it != last; ++it, ++slot) {
+            slot_owner[*slot] = *it;
+          }
+        }
+      }
+
+      if (!placed) {
+        placed_all = false;
+        break;
+      }
+    }
+
+    if (!placed_all) {
+      continue;
+    }
+
+    this->seed = seed;
+    this->displacements = std::move(displacements);
+    this->entries.resize(n);
+    for (std::size_t slot = 0; slot < n; ++slot) {
+      this->entries[slot] = std::move(flags[slot_owner[slot]]);
+    }
+    return;
+  }
+
+  throw std::logic_error("unable to build long flag map, duplicate flags?");
+}
+
+
+inline
+void long_flag_map::build_sorted(std::vector<long_flag_entry> flags)
+{
+  this->seed = 0;
+  this->displacements.clear();
+  this->entries = std::move(flags);
+}
+
+
+inline
+const definition* long_flag_map::find(
+  const char* flag,
+  std::size_t len) const
+{
+  const std::size_t n = this->entries.size();
+  if (n == 0) {
+    return nullptr;
+  }
+  if (this->displacements.empty()) {
+    const auto it = std::lower_bound(
+      this->entries.begin(), this->entries.end(), flag,
+      [len](const long_flag_entry& entry, const char* f) {
+        return entry.flag.compare(0, entry.flag.size(), f, len) < 0;
+      });
+    if (it == this->entries.end() || it->flag.size() != len ||
+        std::memcmp(it->flag.data(), flag, len) != 0) {
+      return nullptr;
+    }
+    return it->defn;
+  }
+  const auto h = hash_flag(flag, len, this->seed);
+  const auto d = this->displacements[
+    static_cast<std::size_t>(h % this->displacements.size())];
+  const auto& entry = this->entries[long_flag_slot(h, d, n)];
+  if (entry.flag.size() != len ||
+      std::memcmp(entry.flag.data(), flag, len) != 0) {
+    return nullptr;
+  }
+  return entry.defn;
+}
+
+
+inline
+std::size_t long_flag_map::size() const
+{
+  return this->entries.size();
+}
+
+
+inline
+void prefix_flag_trie::build(const std::vector<long_flag_entry>& prefixes)
+{
+  this->nodes.clear();
+  this->edge_chars.clear();
+  this->edge_targets.clear();
+  if (!prefixes.empty()) {
+    this->build_node(prefixes, 0, prefixes.size(), 0);
+  }
+}
+
+
+inline
+std::uint32_t prefix_flag_trie::build_node(
+  const std::vector<long_flag_entry>& prefixes,
+  std::size_t first,
+  std::size_t last,
+  std::size_t depth)
+{
+  // Every prefix in [first, last) shares the first depth characters. Since
+  // they're sorted one that ends here comes first and the rest are grouped by
+  // their next character.
+  const auto index = static_cast<std::uint32_t>(this->nodes.size());
+  const definition* unique_defn = prefixes[first].defn;
+  for (std::size_t i = first; i < last && unique_defn != nullptr; ++i) {
+    if (prefixes[i].defn != unique_defn) {
+      unique_defn = nullptr;
+    }
+  }
+  this->nodes.push_back(node {0, 0, nullptr, unique_defn});
+  if (prefixes[first].flag.size() == depth) {
+    this->nodes[index].defn = prefixes[first].defn;
+    ++first;
+  }
+
+  std::uint32_t num_edges = 0;
+  for (std::size_t i = first; i < last; ++num_edges) {
+    const char c = prefixes[i].flag[depth];
+    while (i < last && prefixes[i].flag[depth] == c) {
+      ++i;
+    }
+  }
+  const auto first_edge = static_cast<std::uint32_t>(this->edge_chars.size());
+  this->nodes[index].first_edge = first_edge;
+  this->nodes[index].num_edges = num_edges;
+  this->edge_chars.resize(first_edge + num_edges);
+  this->edge_targets.resize(first_edge + num_edges);
+
+  std::size_t edge = first_edge;
+  for (std::size_t i = first; i < last; ++edge) {
+    const char c = prefixes[i].flag[depth];
+    const std::size_t group_first = i;
+    while (i < last && prefixes[i].flag[depth] == c) {
+      ++i;
+    }
+    this->edge_chars[edge] = c;
+    const auto target = this->build_node(prefixes, group_first, i, depth + 1);
+    this->edge_targets[edge] = target;
+  }
+  return index;
+}
+
+
+inline
+const definition* prefix_flag_trie::find_longest(
+  const char* arg,
+  std::size_t len,
+  std::size_t& prefix_len) const
+{
+  if (this->nodes.empty()) {
+    return nullptr;
+  }
+  const definition* found = nullptr;
+  const node* current = &this->nodes.front();
+  for (std::size_t i = 0; ; ++i) {
+    if (current->defn != nullptr) {
+      found = current->defn;
+      prefix_len = i;
+    }
+    if (i == len) {
+      break;
+    }
+    const char* edges = this->edge_chars.data() + current->first_edge;
+    const char* edges_end = edges + current->num_edges;
+    const char* edge = std::find(edges, edges_end, arg[i]);
+    if (edge == edges_end) {
+      break;
+    }
+    current = &this->nodes[this->edge_targets[
+      static_cast<std::size_t>(edge - this->edge_chars.data())]];
+  }
+  return found;
+}
+
+
+inline
+const definition* prefix_flag_trie::find_unique(
+  const char* s,
+  std::size_t len,
+  bool& ambiguous) const
+{
+  if (this->nodes.empty()) {
+    return nullptr;
+  }
+  const node* current = &this->nodes.front();
+  for (std::size_t i = 0; i < len; ++i) {
+    const char* edges = this->edge_chars.data() + current->first_edge;
+    const char* edges_end = edges + current->num_edges;
+    const char* edge = std::find(edges, edges_end, s[i]);
+    if (edge == edges_end) {
+      return nullptr;
+    }
+    current = &this->nodes[this->edge_targets[
+      static_cast<std::size_t>(edge - this->edge_chars.data())]];
+  }
+  ambiguous = current->unique_defn == nullptr;
+  return current->unique_defn;
+}
+
+
+inline
+bool prefix_flag_trie::empty() const
+{
+  return this->nodes.empty();
+}
+
+
+inline
+bool parser_map::known_long_flag(
+  const std::string& flag) const
+{
+  return this->long_map.find(flag.data(), flag.size()) != nullptr;
+}
+
+
+inline
+const definition* parser_map::get_definition_for_long_flag(
+  const std::string& flag) const
+{
+  return this->long_map.find(flag.data(), flag.size());
+}
+
+
+inline
+const definition* parser_map::get_definition_for_long_flag(
+  const char* flag,
+  std::size_t len) const
+{
+  return this->long_map.find(flag, len);
+}
+
+
+inline
+const definition* parser_map::get_definition_for_prefix_flag(
+  const char* arg,
+  std::size_t len,
+  std::size_t& prefix_len) const
+{
+  return this->prefix_map.find_longest(arg, len, prefix_len);
+}
+
+
+inline
+const definition* parser_map::get_definition_for_abbreviated_flag(
+  const char* flag,
+  std::size_t len,
+  bool& ambiguous) const
+{
+  return this->abbreviation_map.find_unique(flag, len, ambiguous);
+}
+
+
+inline
+parser_map validate_definitions(
+  const std::vector<definition>& definitions,
+  long_flag_abbreviations abbreviations,
+  long_flag_index index)
+{
+  parser_map map {{{nullptr}}, {}, {}, {}, nullptr};
+
+  // Long flags are collected first and checked for duplicates by sorting
+  // since the index has to be built over the complete set. The same goes for
+  // the prefix flags and their trie.
+  std::vector<long_flag_entry> long_flags;
+  std::vector<long_flag_entry> prefix_flags;
+
+  std::shared_ptr<option_name_index> names =
+    std::make_shared<option_name_index>();
+  names->reserve(definitions.size());
+
+  for (auto& defn : definitions) {
+
+    // Results are stored by ordinal and looked up by name so every name has
+    // to refer to a single definition.
+    const auto ordinal = static_cast<std::size_t>(&defn - definitions.data());
+    if (!names->insert(std::make_pair(defn.name, ordinal)).second) {
+      std::ostringstream msg;
+      msg << "duplicate option name \"" << defn.name << "\" found";
+      throw invalid_flag(msg.str());
+    }
+
+    if (defn.flags.size() == 0) {
+      std::ostringstream msg;
+      msg << "option \"" << defn.name << "\" has no flag definitions";
+      throw invalid_flag(msg.str());
+    }
+
+    for (auto& flag : defn.flags) {
+
+      if (flag_is_prefix(flag.data())) {
+        if (!is_valid_prefix_flag_definition(flag.data())) {
+          std::ostringstream msg;
+          msg << "flag \"" << flag << "\" specified for option \""
+              << defn.name << "\" is invalid";
+          throw invalid_flag(msg.str());
+        }
+        if (defn.num_args != 1) {
+          std::ostringstream msg;
+          msg << "prefix flag \"" << flag << "\" specified for option \""
+              << defn.name << "\" requires the option to take one argument";
+          throw invalid_flag(msg.str());
+        }
+        prefix_flags.push_back(
+          long_flag_entry {flag.substr(0, flag.size() - 1), &defn});
+        continue;
+      }
+
+      if (!is_valid_flag_definition(flag.data())) {
+        std::ostringstream msg;
+        msg << "flag \"" << flag << "\" specified for option \"" << defn.name
+            << "\" is invalid";
+        throw invalid_flag(msg.str());
+      }
+
+      if (flag_is_short(flag.data())) {
+        const std::size_t short_flag_letter = static_cast<std::size_t>(flag[1]);
+        const auto existing_short_flag =
+          map.short_map[short_flag_letter];
+        bool short_flag_already_exists = (existing_short_flag != nullptr);
+        if (short_flag_already_exists) {
+          std::ostringstream msg;
+          msg << "duplicate short flag \"" << flag
+              << "\" found, specified by both option  \"" << defn.name
+              << "\" and option \"" << existing_short_flag->name;
+          throw invalid_flag(msg.str());
+        }
+        map.short_map[static_cast<std::size_t>(short_flag_letter)] = &defn;
+        continue;
+      }
+
+      // If we're here then this is a valid, long-style flag.
+      long_flags.push_back(long_flag_entry {flag, &defn});
+    }
+  }
+
+  std::stable_sort(long_flags.begin(), long_flags.end(),
+    [](const long_flag_entry& a, const long_flag_entry& b) {
+      return a.flag < b.flag;
+    });
+  const auto duplicate = std::adjacent_find(
+    long_flags.begin(), long_flags.end(),
+    [](const long_flag_entry& a, const long_flag_entry& b) {
+      return a.flag == b.flag;
+    });
+  if (duplicate != long_flags.end()) {
+    const auto& existing = *duplicate;
+    const auto& flag = *(duplicate + 1);
+    std::ostringstream msg;
+    msg << "duplicate long flag \"" << flag.flag
+        << "\" found, specified by both option  \"" << flag.defn->name
+        << "\" and option \"" << existing.defn->name;
+    throw invalid_flag(msg.str());
+  }
+  if (abbreviations == long_flag_abbreviations::allowed) {
+    map.abbreviation_map.build(long_flags);
+  }
+  if (index == long_flag_index::sorted) {
+    map.long_map.build_sorted(std::move(long_flags));
+  } else {
+    map.long_map.build(std::move(long_flags));
+  }
+
+  std::sort(prefix_flags.begin(), prefix_flags.end(),
+    [](const long_flag_entry& a, const long_flag_entry& b) {
+      return a.flag < b.flag;
+    });
+  const auto duplicate_prefix = std::adjacent_find(
+    prefix_flags.begin(), prefix_flags.end(),
+    [](const long_flag_entry& a, const long_flag_entry& b) {
+      return a.flag == b.flag;
+    });
+  if (duplicate_prefix != prefix_flags.end()) {
+    std::ostringstream msg;
+    msg << "duplicate prefix flag \"" << duplicate_prefix->flag
+        << "*\" found, specified by both option  \""
+        << (duplicate_prefix + 1)->defn->name << "\" and option \""
+        << duplicate_prefix->defn->name;
+    throw invalid_flag(msg.str());
+  }
+  map.prefix_map.build(prefix_flags);
+
+  map.names = std::move(names);
+  return map;
+}
+
+
+inline
+std::size_t parser_map_lookup::find_short_flag(char flag) const
+{
+  return this->ordinal(this->map.get_definition_for_short_flag(flag));
+}
+
+
+inline
+std::size_t parser_map_lookup::find_long_flag(
+  const char* flag,
+  std::size_t len) const
+{
+  return this->ordinal(this->map.get_definition_for_long_flag(flag, len));
+}
+
+
+inline
+std::size_t parser_map_lookup::find_abbreviated_flag(
+  const char* flag,
+  std::size_t len) const
+{
+  bool ambiguous = false;
+  const auto defn =
+    this->map.get_definition_for_abbreviated_flag(flag, len, ambiguous);
+  return ambiguous ? ambiguous_option : this->ordinal(defn);
+}
+
+
+inline
+std::size_t parser_map_lookup::find_prefix_flag(
+  const char* arg,
+  std::size_t len,
+  std::size_t& prefix_len) const
+{
+  return this->ordinal(
+    this->map.get_definition_for_prefix_flag(arg, len, prefix_len));
+}
+
+
+inline
+unsigned int parser_map_lookup::num_args(std::size_t ordinal) const
+{
+  return this->definitions[ordinal].num_args;
+}
+
+
+inline
+const definition* parser_map_lookup::definition_for(std::size_t ordinal) const
+{
+  return &this->definitions[ordinal];
+}
+
+
+inline
+std::size_t parser_map_lookup::ordinal(const definition* defn) const
+{
+  if (defn == nullptr) {
+    return no_option;
+  }
+  return static_cast<std::size_t>(defn - this->definitions.data());
+}
+
+
+/**
+ * @brief
+ * Prepares results to be parsed into: every container is cleared but keeps
+ * its capacity. Option entries are only dropped when the results came from a
+ * parser with a different name index, otherwise they are emptied and kept
+ * so their storage can be reused.
+ */
+inline
+void reset_results(
+  parser_results& results,
+  const char* program,
+  const std::shared_ptr<const option_name_index>& names)
+{
+  results.program = program;
+  if (results.names != names) {
+    results.options.clear();
+    results.ordinals.clear();
+    results.names = names;
+  }
+  for (auto& opt_results : results.options) {
+    opt_results.all = option_result_span {nullptr, 0};
+  }
+  results.values.clear();
+  results.value_ordinals.clear();
+  results.pos.clear();
+  results.pos_lengths.clear();
+  results.remainder = argv_span {nullptr, 0};
+}
+
+
+/**
+ * @brief
+ * Records an occurrence of the given definition while parsing. Occurrences
+ * are appended to @ref parser_results::values in command line order and
+ * grouped by group_option_results() once parsing is done. Returns the index
+ * of the new option result.
+ */
+inline
+std::size_t add_option_result(
+  parser_results& results,
+  std::size_t ordinal)
+{
+  results.emplace(option_handle {ordinal});
+  results.values.push_back(option_result {nullptr});
+  results.value_ordinals.push_back(ordinal);
+  return results.values.size() - 1;
+}
+
+
+/**
+ * @brief
+ * Stably reorders @ref parser_results::values so the occurrences of each
+ * definition are contiguous and points each option's span at its run. The
+ * reordering is done in place so it doesn't allocate.
+ */
+inline
+void group_option_results(
+  parser_results& results)
+{
+  auto& values = results.values;
+  auto& value_ordinals = results.value_ordinals;
+  const auto slot_of = [&](std::size_t ordinal) {
+      return static_cast<std::size_t>(std::lower_bound(
+        results.ordinals.begin(), results.ordinals.end(), ordinal) -
+        results.ordinals.begin());
+    };
+
+  // Count the occurrences of each option, then lay the runs out one after
+  // another. The span lengths are reset so they can count again below.
+  for (const auto ordinal : value_ordinals) {
+    ++results.options[slot_of(ordinal)].all.len;
+  }
+  std::size_t offset = 0;
+  for (auto& opt_results : results.options) {
+    opt_results.all.first =
+      opt_results.all.len > 0 ? values.data() + offset : nullptr;
+    offset += opt_results.all.len;
+    opt_results.all.len = 0;
+  }
+
+  // Replace each occurrence's ordinal with its destination and then apply
+  // that permutation by following its cycles.
+  for (auto& destination : value_ordinals) {
+    auto& all = results.options[slot_of(destination)].all;
+    destination = static_cast<std::size_t>(all.first - values.data()) +
+                  all.len++;
+  }
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    while (value_ordinals[i] != i) {
+      const std::size_t j = value_ordinals[i];
+      std::swap(values[i], values[j]);
+      std::swap(value_ordinals[i], value_ordinals[j]);
+    }
+  }
+
+  // Put the ordinals back, now in grouped order.
+  for (std::size_t slot = 0; slot < results.options.size(); ++slot) {
+    const auto& all = results.options[slot].all;
+    if (all.len > 0) {
+      const auto run = value_ordinals.begin() + (all.first - values.data());
+      std::fill(
+        run, run + static_cast<std::ptrdiff_t>(all.len),
+        results.ordinals[slot]);
+    }
+  }
+}
+
+
+inline
+parse_state initial_parse_state()
+{
+  return parse_state {false, nullptr, no_option, 0, 0, 0};
+}
+
+
+inline
+parse_error::operator bool () const
+{
+  return this->kind != parse_error_kind::none;
+}
+
+
+inline
+std::string parse_error::message() const
+{
+  std::ostringstream msg;
+  switch (this->kind) {
+    case parse_error_kind::none:
+      break;
+    case parse_error_kind::unexpected_option:
+      if (this->arg[1] == '-') {
+        msg << "found unexpected flag: "
+            << std::string(this->arg, std::strcspn(this->arg, "="));
+      } else {
+        msg << "found unexpected flag '" << this->arg[this->offset]
+            << "' in flag group '" << this->arg << "'";
+      }
+      break;
+    case parse_error_kind::unexpected_argument:
+      msg << "found argument for option not expecting an argument: "
+          << this->arg;
+      break;
+    case parse_error_kind::option_lacks_argument:
+      msg << "last option \"" << this->arg
+          << "\" expects an argument but the parser ran out of command line "
+          << "arguments to parse";
+      break;
+    case parse_error_kind::non_alphanumeric_flag:
+      msg << "found non-alphanumeric character '" << this->arg[this->offset]
+          << "' in flag group '" << this->arg << "'";
+      break;
+    case parse_error_kind::ambiguous_option:
+      msg << "found ambiguous abbreviation of long flags: "
+          << std::string(this->arg, std::strcspn(this->arg, "="));
+      break;
+  }
+  return msg.str();
+}
+
+
+inline
+void parse_error::raise() const
+{
+  switch (this->kind) {
+    case parse_error_kind::none:
+      return;
+    case parse_error_kind::unexpected_option:
+      throw unexpected_option_error(this->message());
+    case parse_error_kind::unexpected_argument:
+      throw unexpected_argument_error(this->message());
+    case parse_error_kind::option_lacks_argument:
+      throw option_lacks_argument_error(this->message());
+    case parse_error_kind::non_alphanumeric_flag:
+      throw std::domain_error(this->message());
+    case parse_error_kind::ambiguous_option:
+      throw ambiguous_option_error(this->message());
+  }
+}
+
+
+inline
+void write_parse_errors(
+  std::ostream& os,
+  const std::vector<parse_error>& errors)
+{
+  for (const auto& error : errors) {
+    os << "argument " << error.argv_index << ": " << error.message() << '\n';
+  }
+}
+
+
+/**
+ * @brief
+ * Completes the option with the longest prefix flag that the argument starts
+ * with, giving it the rest of the argument as its argument, and returns true.
+ * Returns false if no prefix flag matches.
+ */
+template <typename Lookup, typename Sink>
+bool parse_prefix_flag(
+  const Lookup& lookup,
+  const arg_token& token,
+  std::size_t argv_index,
+  Sink&& sink)
+{
+  std::size_t prefix_len = 0;
+  const auto ordinal =
+    lookup.find_prefix_flag(token.arg, token.len, prefix_len);
+  if (ordinal == no_option) {
+    return false;
+  }
+  sink(parse_event {
+      parse_event_kind::option, ordinal, lookup.definition_for(ordinal),
+      token.arg + prefix_len, token.len - prefix_len, argv_index});
+  return true;
+}
+
+
+/**
+ * @brief
+ * The parsing state machine shared by every parser type. Advances state over
+ * the classified argument in token, which was found at argv_index, passing
+ * at most one completed @ref parse_event to sink. Returns true once the
+ * argument has been fully processed; otherwise call again with the same
+ * token to continue (this only happens within short flag groups, which can
+ * complete several options). The Lookup type resolves flags to definition
+ * ordinals, see @ref parser_map_lookup for the interface.
+ *
+ * Errors are recorded in error, in which case the argument counts as
+ * processed.
+ */
+template <typename Lookup, typename Sink>
+bool try_parse_step(
+  const Lookup& lookup,
+  parse_state& state,
+  const arg_token& token,
+  std::size_t argv_index,
+  Sink&& sink,
+  parse_error& error)
+{
+  const auto arg_i_cstr = token.arg;
+  const auto arg_i_len = token.len;
+
+  if (state.group_pos == 0) {
+
+    // Some behavior to note: if the previous option is expecting an argument
+    // then the next entry will be treated as a positional argument even if
+    // it looks like a flag.
+    bool treat_as_positional_argument = (
+        state.ignore_flags
+        || state.num_option_args_to_consume > 0
+        || !token.is_flag()
+      );
+    if (treat_as_positional_argument) {
+
+      // If last option is expecting some specific positive number of
+      // arguments then give this argument to that option, *regardless of
+      // whether or not the argument looks like a flag or is the special "--"
+      // argument*. The option is complete once it has all of its arguments.
+      if (state.num_option_args_to_consume > 0) {
+        --state.num_option_args_to_consume;
+        if (state.num_option_args_to_consume == 0) {
+          sink(parse_event {
+              parse_event_kind::option, state.last_option_expecting_args,
+              lookup.definition_for(state.last_option_expecting_args),
+              arg_i_cstr, arg_i_len, state.last_option_argv_index});
+          state.last_flag_expecting_args = nullptr;
+          state.last_option_expecting_args = no_option;
+        }
+        return true;
+      }
+
+      // Now we check if this is just "--" which is a special argument that
+      // causes all following arguments to be treated as non-options and is
+      // itselve discarded.
+      if (token.kind == arg_kind::terminator) {
+        state.ignore_flags = true;
+        return true;
+      }
+
+      // If there are no expectations for option arguments then simply use
+      // this argument as a positional argument.
+      sink(parse_event {
+          parse_event_kind::positional, no_option, nullptr, arg_i_cstr,
+          arg_i_len, argv_index});
+      return true;
+    }
+
+    // If we're at this point then we're definitely dealing with something
+    // that is flag-like and has hyphen as the first character and has a
+    // length of at least two characters. How we handle this potential flag
+    // depends on whether or not it is a long-option so we check that first.
+    if (token.kind == arg_kind::long_flag) {
+
+      // Long flags have a complication: their arguments can be specified
+      // using an '=' character right inside the argument. That means an
+      // argument like "--output=foobar.txt" is actually an option with flag
+      // "--output" and argument "foobar.txt". The lexer already split the
+      // flag from the argument: token.name is "--output" and token.value is
+      // "foobar.txt" (or nullptr if there was no '=').
+      const auto long_flag_arg = token.value;
+
+      // Exact long flags take precedence over prefix flags, which take
+      // precedence over abbreviations of long flags.
+      auto ordinal = lookup.find_long_flag(token.name, token.name_len);
+      if (ordinal == no_option) {
+        if (parse_prefix_flag(lookup, token, argv_index, sink)) {
+          return true;
+        }
+        ordinal = lookup.find_abbreviated_flag(token.name, token.name_len);
+      }
+      if (ordinal == no_option || ordinal == ambiguous_option) {
+        error = parse_error {
+          ordinal == no_option
+            ? parse_error_kind::unexpected_option
+            : parse_error_kind::ambiguous_option,
+          argv_index, 0, arg_i_cstr};
+        return true;
+      }
+
+      const auto num_args = lookup.num_args(ordinal);
+      if (long_flag_arg != nullptr && num_args == 0) {
+        error = parse_error {
+          parse_error_kind::unexpected_argument, argv_index,
+          token.name_len + 1, arg_i_cstr};
+        return true;
+      }
+
+      // We've got a legitimate, known long flag option. Unless it still needs
+      // arguments from the following command line arguments it is complete.
+      bool there_is_an_equal_delimited_arg = (long_flag_arg != nullptr);
+      if (num_args > 0 && !there_is_an_equal_delimited_arg) {
+        state.last_flag_expecting_args = arg_i_cstr;
+        state.last_option_expecting_args = ordinal;
+        state.last_option_argv_index = argv_index;
+        state.num_option_args_to_consume = num_args;
+        return true;
+      }
+      sink(parse_event {
+          parse_event_kind::option, ordinal, lookup.definition_for(ordinal),
+          long_flag_arg, token.value_len, argv_index});
+      return true;
+    }
+
+    // If we've made it here then we're looking at either a short flag or a
+    // group of short flags. Short flags can be grouped together so long as
+    // they don't require any arguments unless the option that does is the
+    // last in the group ("-o x -v" is okay, "-vo x" is okay, "-ov x" is
+    // not). So starting after the dash we're going to process each character
+    // as if it were a separate flag. That is unless the argument starts with
+    // a prefix flag like "-Wl," which takes precedence.
+    if (parse_prefix_flag(lookup, token, argv_index, sink)) {
+      return true;
+    }
+    state.group_pos = 1;
+  }
+
+  // Note "sf_idx" stands for "short flag index". We pick up where the last
+  // call left off since each call completes at most one option.
+  const std::size_t sf_idx = state.group_pos;
+  const auto short_flag = arg_i_cstr[sf_idx];
+
+  if (!char_is_alnum(short_flag)) {
+    state.group_pos = 0;
+    error = parse_error {
+      parse_error_kind::non_alphanumeric_flag, argv_index, sf_idx,
+      arg_i_cstr};
+    return true;
+  }
+
+  const auto ordinal = lookup.find_short_flag(short_flag);
+  if (ordinal == no_option) {
+    state.group_pos = 0;
+    error = parse_error {
+      parse_error_kind::unexpected_option, argv_index, sf_idx, arg_i_cstr};
+    return true;
+  }
+
+  const auto num_args = lookup.num_args(ordinal);
+  bool is_last_short_flag_in_group = (sf_idx == arg_i_len - 1);
+
+  if (num_args == 0) {
+    sink(parse_event {
+        parse_event_kind::option, ordinal, lookup.definition_for(ordinal),
+        nullptr, 0, argv_index});
+    state.group_pos = is_last_short_flag_in_group ? 0 : sf_idx + 1;
+    return is_last_short_flag_in_group;
+  }
+
+  // If this short flag's option requires an argument and we're the last flag
+  // in the short flag group then just put the parser into "expecting
+  // argument for last option" state and move onto the next command line
+  // argument.
+  state.group_pos = 0;
+  if (is_last_short_flag_in_group) {
+    state.last_flag_expecting_args = arg_i_cstr;
+    state.last_option_expecting_args = ordinal;
+    state.last_option_argv_index = argv_index;
+    state.num_option_args_to_consume = num_args;
+    return true;
+  }
+
+  // If this short flag's option requires an argument and we're NOT the last
+  // flag in the short flag group then we automatically consume the rest of
+  // the short flag group as the argument for this flag. This is how we get
+  // the POSIX behavior of being able to specify a flag's arguments without a
+  // white space delimiter (e.g. "-I/usr/local/include").
+  sink(parse_event {
+      parse_event_kind::option, ordinal, lookup.definition_for(ordinal),
+      arg_i_cstr + sf_idx + 1, arg_i_len - sf_idx - 1, argv_index});
+  return true;
+}
+
+
+/**
+ * @brief
+ * Runs try_parse_step() until token has been processed. When errors is
+ * nullptr this stops at the first error and returns it. Otherwise every
+ * error is appended to errors and parsing goes on, continuing after unknown
+ * flags in short flag groups so that all of them are reported.
+ */
+template <typename Lookup, typename Sink>
+parse_error parse_token(
+  const Lookup& lookup,
+  parse_state& state,
+  const arg_token& token,
+  std::size_t argv_index,
+  Sink&& sink,
+  std::vector<parse_error>* errors)
+{
+  while (true) {
+    parse_error error {parse_error_kind::none, 0, 0, nullptr};
+    const bool done =
+      try_parse_step(lookup, state, token, argv_index, sink, error);
+    if (error) {
+      if (errors == nullptr) {
+        return error;
+      }
+      errors->push_back(error);
+      if (error.kind == parse_error_kind::unexpected_option &&
+          token.kind == arg_kind::short_group &&
+          error.offset + 1 < token.len) {
+        state.group_pos = error.offset + 1;
+        continue;
+      }
+    }
+    if (done) {
+      return parse_error {parse_error_kind::none, 0, 0, nullptr};
+    }
+  }
+}
+
+
+/**
+ * @brief
+ * Same as try_parse_step() but throws errors.
+ */
+template <typename Lookup, typename Sink>
+bool parse_step(
+  const Lookup& lookup,
+  parse_state& state,
+  const arg_token& token,
+  std::size_t argv_index,
+  Sink&& sink)
+{
+  parse_error error {parse_error_kind::none, 0, 0, nullptr};
+  const bool done = try_parse_step(
+    lookup, state, token, argv_index, std::forward<Sink>(sink), error);
+  error.raise();
+  return done;
+}
+
+
+/**
+ * @brief
+ * Checks the state machine once all arguments have been processed and
+ * returns the error if an option is still waiting for arguments.
+ */
+inline
+parse_error try_finish_parse(
+  const parse_state& state)
+{
+  // If we're done with all of the arguments but are still expecting
+  // arguments for a previous option then we haven't satisfied that option.
+  // This is an error. For short flag groups the option is the last flag.
+  if (state.num_option_args_to_consume > 0) {
+    const char* flag = state.last_flag_expecting_args;
+    const std::size_t offset =
+      flag[1] == '-' ? 0 : std::strlen(flag) - 1;
+    return parse_error {
+      parse_error_kind::option_lacks_argument, state.last_option_argv_index,
+      offset, flag};
+  }
+  return parse_error {parse_error_kind::none, 0, 0, nullptr};
+}
+
+
+/**
+ * @brief
+ * Ends a parse: groups the option results and checks the state machine.
+ * Returns the first error, see parse_token() for errors.
+ */
+inline
+parse_error end_parse(
+  const parse_state& state,
+  parser_results& results,
+  std::vector<parse_error>* errors)
+{
+  group_option_results(results);
+  const parse_error error = try_finish_parse(state);
+  if (errors == nullptr) {
+    return error;
+  }
+  if (error) {
+    errors->push_back(error);
+  }
+  return errors->empty() ? error : errors->front();
+}
+
+
+/**
+ * @brief
+ * Same as try_finish_parse() but throws the error.
+ */
+inline
+void finish_parse(
+  const parse_state& state)
+{
+  try_finish_parse(state).raise();
+}
+
+
+/**
+ * @brief
+ * Resets results for a new parse of num_args arguments (not counting the
+ * program name).
+ */
+inline
+void begin_results(
+  parser_results& results,
+  const char* program,
+  const std::shared_ptr<const option_name_index>& names,
+  std::size_t num_args)
+{
+  reset_results(results, program, names);
+
+  // Typical command lines use a handful of distinct options so reserve room
+  // for those up front instead of growing one entry at a time.
+  const auto option_reserve = std::min<std::size_t>(num_args, 8);
+  results.options.reserve(option_reserve);
+  results.ordinals.reserve(option_reserve);
+  results.values.reserve(option_reserve);
+  results.value_ordinals.reserve(option_reserve);
+}
+
+
+/**
+ * @brief
+ * The parse_step() event sink that records events in @ref parser_results.
+ */
+struct results_sink {
+
+  parser_results& results;
+
+  void operator () (const parse_event& event) const
+  {
+    if (event.kind == parse_event_kind::option) {
+      const auto value = add_option_result(this->results, event.ordinal);
+      this->results.values[value].arg = event.value;
+    } else {
+      this->results.pos.push_back(event.value);
+      this->results.pos_lengths.push_back(event.value_len);
+    }
+  }
+
+};
+
+
+/**
+ * @brief
+ * Runs the parsing state machine over argv and collects the events into
+ * results, see reset_results(). Option results are keyed by definition
+ * ordinal and only created for definitions that occur, so the cost doesn't
+ * depend on how many there are. Stops at the first error and returns it
+ * unless errors are collected, see parse_token().
+ */
+template <typename Lookup>
+parse_error try_parse_arguments_into(
+  const Lookup& lookup,
+  const std::shared_ptr<const option_name_index>& names,
+  int argc,
+  const char** argv,
+  parser_results& results,
+  std::vector<parse_error>* errors = nullptr)
+{
+  // Store the program name (assumed to be the first command line argument)
+  // and share the name index so the results can be indexed by option name.
+  begin_results(results, argv[0], names,
+                static_cast<std::size_t>(std::max(0, argc - 1)));
+  const results_sink sink {results};
+
+  parse_state state = initial_parse_state();
+
+  // Get pointers to pointers so we can treat the raw pointer array as an
+  // iterator for standard library algorithms.
+  const char** arg_i = argv + 1;
+  const char** arg_end = argv + argc;
+
+  // Arguments are classified in blocks so the instruction set is only
+  // selected once per parse and the lexer runs over many arguments at a time.
+  const simd_level level = best_simd_level();
+  constexpr std::ptrdiff_t lex_block_size = 64;
+  arg_token tokens[lex_block_size];
+
+  while (arg_i != arg_end) {
+    const char** lexed_begin = arg_i;
+    const char** lexed_end =
+      arg_i + std::min(lex_block_size, arg_end - arg_i);
+    lex_args(lexed_begin, lexed_end, tokens, level);
+    for (; arg_i != lexed_end; ++arg_i) {
+      const auto argv_index = static_cast<std::size_t>(arg_i - argv);
+      const arg_token& token = tokens[arg_i - lexed_begin];
+      const parse_error error =
+        parse_token(lookup, state, token, argv_index, sink, errors);
+      if (error) {
+        group_option_results(results);
+        return error;
+      }
+    }
+  }
+
+  return end_parse(state, results, errors);
+}
+
+
+/**
+ * @brief
+ * Same as try_parse_arguments_into() but throws errors.
+ */
+template <typename Lookup>
+void parse_arguments_into(
+  const Lookup& lookup,
+  const std::shared_ptr<const option_name_index>& names,
+  int argc,
+  const char** argv,
+  parser_results& results)
+{
+  try_parse_arguments_into(lookup, names, argc, argv, results).raise();
+}
+
+
+/**
+ * @brief
+ * Same as try_parse_arguments_into() but stops where stop says, which is
+ * found by watching the events and the state machine, and leaves the rest of
+ * argv in parser_results::remainder. Arguments after the stopping point are
+ * not lexed.
+ */
+template <typename Lookup>
+parse_error try_parse_arguments_until(
+  const Lookup& lookup,
+  const std::shared_ptr<const option_name_index>& names,
+  int argc,
+  const char** argv,
+  stop_at stop,
+  parser_results& results)
+{
+  begin_results(results, argv[0], names,
+                static_cast<std::size_t>(std::max(0, argc - 1)));
+  const results_sink sink {results};
+  bool found_positional = false;
+  const auto until_sink = [&](const parse_event& event) {
+      if (event.kind == parse_event_kind::positional &&
+          stop == stop_at::first_positional) {
+        found_positional = true;
+      } else {
+        sink(event);
+      }
+    };
+
+  parse_state state = initial_parse_state();
+  int i = 1;
+  while (i < argc) {
+    const arg_token token = lex_arg(argv[i]);
+    const bool ignored_flags = state.ignore_flags;
+    const parse_error error = parse_token(
+      lookup, state, token, static_cast<std::size_t>(i), until_sink,
+      nullptr);
+    if (error) {
+      group_option_results(results);
+      return error;
+    }
+    if (found_positional) {
+      break;
+    }
+    ++i;
+    if (state.ignore_flags && !ignored_flags) {
+      break;
+    }
+  }
+  results.remainder = argv_span {
+    argv + i, static_cast<std::size_t>(std::max(0, argc - i))};
+  return end_parse(state, results, nullptr);
+}
+
+
+/**
+ * @brief
+ * Same as try_parse_arguments_until() but throws errors.
+ */
+template <typename Lookup>
+void parse_arguments_until(
+  const Lookup& lookup,
+  const std::shared_ptr<const option_name_index>& names,
+  int argc,
+  const char** argv,
+  stop_at stop,
+  parser_results& results)
+{
+  try_parse_arguments_until(
+    lookup, names, argc, argv, stop, results).raise();
+}
+
+
+/**
+ * @brief
+ * Whether a parse error is for an argument that is an unknown option as a
+ * whole, see @ref forward.
+ */
+inline
+bool is_unknown_option_argument(const parse_error& error)
+{
+  return error.offset <= 1 && (
+    error.kind == parse_error_kind::unexpected_option ||
+    error.kind == parse_error_kind::non_alphanumeric_flag);
+}
+
+
+/**
+ * @brief
+ * Same as try_parse_arguments_into() but appends the arguments selected by
+ * what to forwarded, followed by a null pointer, instead of handling them.
+ */
+template <typename Lookup>
+parse_error try_parse_arguments_forwarding(
+  const Lookup& lookup,
+  const std::shared_ptr<const option_name_index>& names,
+  int argc,
+  const char** argv,
+  forward what,
+  parser_results& results,
+  std::vector<const char*>& forwarded)
+{
+  begin_results(results, argv[0], names,
+                static_cast<std::size_t>(std::max(0, argc - 1)));
+  const results_sink sink {results};
+  const bool forward_positionals =
+    what == forward::unknown_options_and_positionals;
+  const auto forwarding_sink = [&](const parse_event& event) {
+      if (event.kind == parse_event_kind::positional && forward_positionals) {
+        forwarded.push_back(event.value);
+      } else {
+        sink(event);
+      }
+    };
+
+  parse_state state = initial_parse_state();
+  const char** arg_i = argv + 1;
+  const char** arg_end = argv + argc;
+  const simd_level level = best_simd_level();
+  constexpr std::ptrdiff_t lex_block_size = 64;
+  arg_token tokens[lex_block_size];
+
+  while (arg_i != arg_end) {
+    const char** lexed_begin = arg_i;
+    const char** lexed_end =
+      arg_i + std::min(lex_block_size, arg_end - arg_i);
+    lex_args(lexed_begin, lexed_end, tokens, level);
+    for (; arg_i != lexed_end; ++arg_i) {
+      const auto argv_index = static_cast<std::size_t>(arg_i - argv);
+      const arg_token& token = tokens[arg_i - lexed_begin];
+      const bool ignored_flags = state.ignore_flags;
+      const parse_error error = parse_token(
+        lookup, state, token, argv_index, forwarding_sink, nullptr);
+      if (is_unknown_option_argument(error)) {
+        forwarded.push_back(*arg_i);
+      } else if (error) {
+        group_option_results(results);
+        forwarded.push_back(nullptr);
+        return error;
+      } else if (forward_positionals && state.ignore_flags &&
+                 !ignored_flags) {
+        forwarded.push_back(*arg_i);
+      }
+    }
+  }
+
+  forwarded.push_back(nullptr);
+  return end_parse(state, results, nullptr);
+}
+
+
+/**
+ * @brief
+ * Same as try_parse_arguments_forwarding() but throws errors.
+ */
+template <typename Lookup>
+void parse_arguments_forwarding(
+  const Lookup& lookup,
+  const std::shared_ptr<const option_name_index>& names,
+  int argc,
+  const char** argv,
+  forward what,
+  parser_results& results,
+  std::vector<const char*>& forwarded)
+{
+  try_parse_arguments_forwarding(
+    lookup, names, argc, argv, what, results, forwarded).raise();
+}
+
+
+/**
+ * @brief
+ * Same as try_parse_arguments_into() but over a forward range of arguments
+ * that are converted with to_arg_view(). The first element is the program
+ * name.
+ */
+template <typename Lookup, typename ForwardIt>
+parse_error try_parse_range_into(
+  const Lookup& lookup,
+  const std::shared_ptr<const option_name_index>& names,
+  ForwardIt first,
+  ForwardIt last,
+  parser_results& results,
+  std::vector<parse_error>* errors = nullptr)
+{
+  const char* program = nullptr;
+  if (first != last) {
+    program = to_arg_view(*first).data;
+    ++first;
+  }
+
+  // Only look ahead as far as the reservation in begin_results() cares about
+  // so that ranges without random access aren't walked twice.
+  std::size_t num_args = 0;
+  for (ForwardIt it = first; it != last && num_args < 8; ++it) {
+    ++num_args;
+  }
+  begin_results(results, program, names, num_args);
+  const results_sink sink {results};
+
+  parse_state state = initial_parse_state();
+  for (std::size_t argv_index = 1; first != last; ++first, ++argv_index) {
+    const arg_view arg = to_arg_view(*first);
+    const arg_token token = lex_arg(arg.data, arg.size);
+    const parse_error error =
+      parse_token(lookup, state, token, argv_index, sink, errors);
+    if (error) {
+      group_option_results(results);
+      return error;
+    }
+  }
+
+  return end_parse(state, results, errors);
+}
+
+
+/**
+ * @brief
+ * Same as try_parse_range_into() but throws errors.
+ */
+template <typename Lookup, typename ForwardIt>
+void parse_range_into(
+  const Lookup& lookup,
+  const std::shared_ptr<const option_name_index>& names,
+  ForwardIt first,
+  ForwardIt last,
+  parser_results& results)
+{
+  try_parse_range_into(lookup, names, first, last, results).raise();
+}
+
+
+/**
+ * @brief
+ * Same as parse_arguments_into() but returns fresh results.
+ */
+template <typename Lookup>
+parser_results parse_arguments(
+  const Lookup& lookup,
+  const std::shared_ptr<const option_name_index>& names,
+  int argc,
+  const char** argv)
+{
+  parser_results results;
+  parse_arguments_into(lookup, names, argc, argv, results);
+  return results;
+}
+
+
+inline
+parser_results parser::parse(int argc, const char** argv) const
+{
+  // Inspect each definition to see if its valid. You may wonder "why don't
+  // you do this validation on construction?" I had thought about it but
+  // realized that since I've made the parser an aggregate type (granted it
+  // just "aggregates" a single vector) I would need to track any changes to
+  // the definitions vector and re-run the validity check in order to
+  // maintain this expected "validity invariant" on the object. That would
+  // then require hiding the definitions vector as a private entry and then
+  // turning the parser into a thin interface (by re-exposing setters and
+  // getters) to the vector methods just so that I can catch when the
+  // definition has been modified. It seems much simpler to just enforce the
+  // validity when you actually want to parse because it's at the moment of
+  // parsing that you know the definitions are complete. If you do know the
+  // definitions are complete ahead of time then use compile() and
+  // compiled_parser instead.
+  //
+  // The map only lives for this one parse so the long flags are binary
+  // searched instead of paying for the perfect hash compiled_parser builds.
+  parser_map map = validate_definitions(
+    this->definitions, long_flag_abbreviations::disallowed,
+    long_flag_index::sorted);
+  return parse_arguments(
+    parser_map_lookup {this->definitions, map}, map.names, argc, argv);
+}
+
+
+inline
+parser_results parser::parse(int argc, char** argv) const
+{
+  return parse(argc, const_cast<const char**>(argv));
+}
+
+
+inline
+void parser::parse_into(
+  int argc, const char** argv, parser_results& out) const
+{
+  parser_map map = validate_definitions(
+    this->definitions, long_flag_abbreviations::disallowed,
+    long_flag_index::sorted);
+  parse_arguments_into(
+    parser_map_lookup {this->definitions, map}, map.names, argc, argv, out);
+}
+
+
+inline
+void parser::parse_into(int argc, char** argv, parser_results& out) const
+{
+  parse_into(argc, const_cast<const char**>(argv), out);
+}
+
+
+inline
+parser_results parser::parse(
+  int argc, const char** argv, stop_at stop) const
+{
+  parser_map map = validate_definitions(
+    this->definitions, long_flag_abbreviations::disallowed,
+    long_flag_index::sorted);
+  parser_results results;
+  parse_arguments_until(
+    parser_map_lookup {this->definitions, map}, map.names, argc, argv, stop,
+    results);
+  return results;
+}
+
+
+inline
+parser_results parser::parse(int argc, char** argv, stop_at stop) const
+{
+  return parse(argc, const_cast<const char**>(argv), stop);
+}
+
+
+inline
+parser_results parser::parse(
+  int argc,
+  const char** argv,
+  std::vector<const char*>& forwarded,
+  forward what) const
+{
+  parser_map map = validate_definitions(
+    this->definitions, long_flag_abbreviations::disallowed,
+    long_flag_index::sorted);
+  parser_results results;
+  parse_arguments_forwarding(
+    parser_map_lookup {this->definitions, map}, map.names, argc, argv, what,
+    results, forwarded);
+  return results;
+}
+
+
+inline
+parser_results parser::parse(
+  int argc,
+  char** argv,
+  std::vector<const char*>& forwarded,
+  forward what) const
+{
+  return parse(argc, const_cast<const char**>(argv), forwarded, what);
+}
+
+
+template <typename ForwardIt>
+parser_results parser::parse(ForwardIt first, ForwardIt last) const
+{
+  parser_results results;
+  parse_into(first, last, results);
+  return results;
+}
+
+
+template <typename ForwardIt>
+void parser::parse_into(
+  ForwardIt first, ForwardIt last, parser_results& out) const
+{
+  parser_map map = validate_definitions(
+    this->definitions, long_flag_abbreviations::disallowed,
+    long_flag_index::sorted);
+  parse_range_into(
+    parser_map_lookup {this->definitions, map}, map.names, first, last, out);
+}
+
+
+inline
+option_handle parser::add(definition defn)
+{
+  this->definitions.push_back(std::move(defn));
+  return option_handle {this->definitions.size() - 1};
+}
+
+
+template <typename T>
+typed_option_handle<T> parser::add(definition defn)
+{
+  this->definitions.push_back(std::move(defn));
+  return typed_option_handle<T> {this->definitions.size() - 1};
+}
+
+
+inline
+compiled_parser parser::compile(
+  long_flag_abbreviations abbreviations) const
+{
+  return compiled_parser(this->definitions, abbreviations);
+}
+
+
+inline
+compiled_parser::compiled_parser(
+  std::vector<definition> definitions,
+  long_flag_abbreviations abbreviations)
+: definitions_(std::move(definitions)),
+  map_(validate_definitions(this->definitions_, abbreviations))
+{
+}
+
+
+inline
+compiled_parser::compiled_parser(const compiled_parser& other)
+: compiled_parser(
+    other.definitions_,
+    other.map_.abbreviation_map.empty()
+      ? long_flag_abbreviations::disallowed
+      : long_flag_abbreviations::allowed)
+{
+}
+
+
+inline
+compiled_parser& compiled_parser::operator = (compiled_parser other)
+{
+  // Swapping the vectors swaps their buffers so the maps keep pointing at the
+  // definitions they were built from.
+  this->definitions_.swap(other.definitions_);
+  std::swap(this->map_, other.map_);
+  return *this;
+}
+
+
+inline
+const std::vector<definition>& compiled_parser::definitions() const
+{
+  return this->definitions_;
+}
+
+
+inline
+const parser_map& compiled_parser::map() const
+{
+  return this->map_;
+}
+
+
+inline
+option_handle compiled_parser::handle(const std::string& name) const
+{
+  std::size_t index = 0;
+  if (!find_option_index(this->map_.names.get(), name, index)) {
+    std::ostringstream msg;
+    msg << "no option named \"" << name << "\" in compiled_parser";
+    throw unknown_option(msg.str());
+  }
+  return option_handle {index};
+}
+
+
+template <typename T>
+typed_option_handle<T> compiled_parser::handle(const std::string& name) const
+{
+  return typed_option_handle<T> {this->handle(name).index};
+}
+
+
+inline
+parser_results compiled_parser::parse(int argc, const char** argv) const
+{
+  return parse_arguments(
+    parser_map_lookup {this->definitions_, this->map_}, this->map_.names,
+    argc, argv);
+}
+
+
+inline
+parser_results compiled_parser::parse(int argc, char** argv) const
+{
+  return parse(argc, const_cast<const char**>(argv));
+}
+
+
+inline
+void compiled_parser::parse_into(
+  int argc, const char** argv, parser_results& out) const
+{
+  parse_arguments_into(
+    parser_map_lookup {this->definitions_, this->map_}, this->map_.names,
+    argc, argv, out);
+}
+
+
+inline
+void compiled_parser::parse_into(
+  int argc, char** argv, parser_results& out) const
+{
+  parse_into(argc, const_cast<const char**>(argv), out);
+}
+
+
+inline
+parser_results compiled_parser::parse(
+  int argc, const char** argv, stop_at stop) const
+{
+  parser_results results;
+  parse_into(argc, argv, results, stop);
+  return results;
+}
+
+
+inline
+parser_results compiled_parser::parse(
+  int argc, char** argv, stop_at stop) const
+{
+  return parse(argc, const_cast<const char**>(argv), stop);
+}
+
+
+inline
+void compiled_parser::parse_into(
+  int argc, const char** argv, parser_results& out, stop_at stop) const
+{
+  parse_arguments_until(
+    parser_map_lookup {this->definitions_, this->map_}, this->map_.names,
+    argc, argv, stop, out);
+}
+
+
+inline
+parser_results compiled_parser::parse(
+  int argc,
+  const char** argv,
+  std::vector<const char*>& forwarded,
+  forward what) const
+{
+  parser_results results;
+  parse_into(argc, argv, results, forwarded, what);
+  return results;
+}
+
+
+inline
+parser_results compiled_parser::parse(
+  int argc,
+  char** argv,
+  std::vector<const char*>& forwarded,
+  forward what) const
+{
+  return parse(argc, const_cast<const char**>(argv), forwarded, what);
+}
+
+
+inline
+void compiled_parser::parse_into(
+  int argc,
+  const char** argv,
+  parser_results& out,
+  std::vector<const char*>& forwarded,
+  forward what) const
+{
+  parse_arguments_forwarding(
+    parser_map_lookup {this->definitions_, this->map_}, this->map_.names,
+    argc, argv, what, out, forwarded);
+}
+
+
+template <typename ForwardIt>
+parser_results compiled_parser::parse(ForwardIt first, ForwardIt last) const
+{
+  parser_results results;
+  parse_into(first, last, results);
+  return results;
+}
+
+
+template <typename ForwardIt>
+void compiled_parser::parse_into(
+  ForwardIt first, ForwardIt last, parser_results& out) const
+{
+  parse_range_into(
+    parser_map_lookup {this->definitions_, this->map_}, this->map_.names,
+    first, last, out);
+}
+
+
+inline
+parse_error compiled_parser::try_parse(
+  int argc, const char** argv, parser_results& out) const
+{
+  return try_parse_arguments_into(
+    parser_map_lookup {this->definitions_, this->map_}, this->map_.names,
+    argc, argv, out);
+}
+
+
+inline
+parse_error compiled_parser::try_parse(
+  int argc, char** argv, parser_results& out) const
+{
+  return try_parse(argc, const_cast<const char**>(argv), out);
+}
+
+
+template <typename ForwardIt>
+parse_error compiled_parser::try_parse(
+  ForwardIt first, ForwardIt last, parser_results& out) const
+{
+  return try_parse_range_into(
+    parser_map_lookup {this->definitions_, this->map_}, this->map_.names,
+    first, last, out);
+}
+
+
+inline
+parse_error compiled_parser::try_parse_all(
+  int argc, const char** argv, parser_results& out,
+  std::vector<parse_error>& errors) const
+{
+  errors.clear();
+  return try_parse_arguments_into(
+    parser_map_lookup {this->definitions_, this->map_}, this->map_.names,
+    argc, argv, out, &errors);
+}
+
+
+inline
+parse_error compiled_parser::try_parse_all(
+  int argc, char** argv, parser_results& out,
+  std::vector<parse_error>& errors) const
+{
+  return try_parse_all(argc, const_cast<const char**>(argv), out, errors);
+}
+
+
+template <typename ForwardIt>
+parse_error compiled_parser::try_parse_all(
+  ForwardIt first, ForwardIt last, parser_results& out,
+  std::vector<parse_error>& errors) const
+{
+  errors.clear();
+  return try_parse_range_into(
+    parser_map_lookup {this->definitions_, this->map_}, this->map_.names,
+    first, last, out, &errors);
+}
+
+
+inline
+parser_map_lookup compiled_parser::lookup() const
+{
+  return parser_map_lookup {this->definitions_, this->map_};
+}
+
+
+inline
+incremental_parser<compiled_parser> compiled_parser::incremental() const
+{
+  return incremental_parser<compiled_parser>(*this);
+}
+
+
+inline
+parse_event_range<compiled_parser> compiled_parser::parse_events(
+  int argc, const char** argv) const
+{
+  return parse_event_range<compiled_parser> {this, argc, argv};
+}
+
+
+inline
+parse_event_range<compiled_parser> compiled_parser::parse_events(
+  int argc, char** argv) const
+{
+  return parse_events(argc, const_cast<const char**>(argv));
+}
+
+
+// The following are C++11 constexpr (single return statement) versions of the
+// checks done by is_valid_flag_definition() and validate_definitions().
+
+
+constexpr
+std::size_t static_strlen(const char* s, std::size_t i = 0)
+{
+  return s[i] == '\0' ? i : static_strlen(s, i + 1);
+}
+
+
+constexpr
+bool static_cstr_equal(const char* a, const char* b)
+{
+  return *a == *b && (*a == '\0' || static_cstr_equal(a + 1, b + 1));
+}
+
+
+constexpr
+std::uint64_t static_flag_hash(
+  const char* s,
+  std::size_t len,
+  std::size_t i = 0,
+  std::uint64_t h = 14695981039346656037ULL)
+{
+  return i == len ? h : static_flag_hash(
+    s, len, i + 1, (h ^ static_cast<unsigned char>(s[i])) * 1099511628211ULL);
+}
+
+
+constexpr
+bool static_flag_tail_is_valid(const char* s, bool is_long)
+{
+  return *s == '\0' || (
+    (char_is_alnum(*s) || (is_long && *s == '-')) &&
+    static_flag_tail_is_valid(s + 1, is_long));
+}
+
+
+constexpr
+bool static_is_valid_flag_definition(const char* s)
+{
+  return s[0] == '-' && (
+    s[1] == '-'
+    ? char_is_alnum(s[2]) && static_flag_tail_is_valid(s + 3, true)
+    : char_is_alnum(s[1]) && s[2] == '\0');
+}
+
+
+constexpr
+bool static_flag_is_short(const char* s)
+{
+  return s[0] == '-' && s[1] != '-';
+}
+
+
+constexpr
+bool static_flag_is_set(const static_definition& defn, std::size_t j)
+{
+  return j < static_definition_max_flags && defn.flags[j] != nullptr;
+}
+
+
+constexpr
+bool static_flags_are_valid(const static_definition& defn, std::size_t j = 0)
+{
+  return !static_flag_is_set(defn, j) || (
+    static_is_valid_flag_definition(defn.flags[j]) &&
+    static_flags_are_valid(defn, j + 1));
+}
+
+
+// Whether flag j of the given definition is used: it and every flag before it
+// are set.
+constexpr
+bool static_flag_is_used(const static_definition& defn, std::size_t j)
+{
+  return static_flag_is_set(defn, j) &&
+    (j == 0 || static_flag_is_used(defn, j - 1));
+}
+
+
+// The checks below scan definitions by splitting the range in halves, so the
+// recursion depth grows with the logarithm of the number of definitions, and
+// find duplicates by sorting instead of comparing every pair. Flags are
+// numbered flat, flag j of definition i is i * static_definition_max_flags + j.
+
+
+template <std::size_t N>
+constexpr
+const char* static_flat_flag(
+  const static_definition (&defs)[N],
+  std::size_t k)
+{
+  return defs[k / static_definition_max_flags].flags[
+    k % static_definition_max_flags];
+}
+
+
+template <std::size_t N>
+constexpr
+bool static_flat_flag_is_used(
+  const static_definition (&defs)[N],
+  std::size_t k)
+{
+  return static_flag_is_used(
+    defs[k / static_definition_max_flags], k % static_definition_max_flags);
+}
+
+
+constexpr
+std::size_t static_next_pow2(std::size_t n, std::size_t p = 1)
+{
+  return p >= n ? p : static_next_pow2(n, p * 2);
+}
+
+
+// One compare-and-swap pass of a bitonic sorting network. Element i is
+// paired with element i ^ j and the pairs within blocks of k elements are
+// put in ascending or descending order depending on the block.
+template <std::size_t P, std::size_t... I>
+constexpr
+static_sort<P> static_sort_pass(
+  const static_sort<P>& sort,
+  std::size_t k,
+  std::size_t j,
+  index_sequence<I...>)
+{
+  return static_sort<P> {{
+    ((((I & k) == 0) == ((I & j) == 0)) ==
+       (sort.values[I] < sort.values[I ^ j])
+     ? sort.values[I] : sort.values[I ^ j])...}};
+}
+
+
+// Runs the passes of the network from (k, j) on. There are about
+// log2(P)^2 / 2 of them, each a single pack expansion over all P values.
+template <std::size_t P>
+constexpr
+static_sort<P> static_sort_passes(
+  const static_sort<P>& sort,
+  std::size_t k = 2,
+  std::size_t j = 1)
+{
+  return k > P ? sort
+    : static_sort_passes(
+        static_sort_pass(sort, k, j, make_index_sequence<P>()),
+        j == 1 ? 2 * k : k,
+        j == 1 ? k : j / 2);
+}
+
+
+constexpr
+std::uint64_t static_sort_value(std::uint64_t key, std::size_t index)
+{
+  return (key << 32) | index;
+}
+
+
+constexpr
+std::size_t static_sort_index(std::uint64_t value)
+{
+  return static_cast<std::size_t>(value & 0xffffffffu);
+}
+
+
+constexpr
+std::uint64_t static_sort_key(std::uint64_t value)
+{
+  return value >> 32;
+}
+
+
+// Names and long flags are sorted by the top bits of their hash and short
+// flags by their character with a bit set above those. Entries that are only
+// there to fill the sort up to a power of two get a key of their own.
+constexpr std::uint64_t static_sort_short = 0x40000000u;
+
+
+constexpr std::uint64_t static_sort_unused = 0x80000000u;
+
+
+constexpr
+std::uint64_t static_string_sort_key(const char* s)
+{
+  return static_flag_hash(s, static_strlen(s)) >> 34;
+}
+
+
+constexpr
+std::uint64_t static_flag_sort_key(const char* flag)
+{
+  return static_flag_is_short(flag)
+    ? static_sort_short | static_cast<unsigned char>(flag[1])
+    : static_string_sort_key(flag);
+}
+
+
+template <std::size_t N, std::size_t... I>
+constexpr
+static_sort<sizeof...(I)> make_static_name_sort(
+  const static_definition (&defs)[N],
+  index_sequence<I...>)
+{
+  return static_sort_passes(static_sort<sizeof...(I)> {{
+    static_sort_value(
+      I < N ? static_string_sort_key(defs[I < N ? I : 0].name)
+      : static_sort_unused,
+      I)...}});
+}
+
+
+template <std::size_t N, std::size_t... K>
+constexpr
+static_sort<sizeof...(K)> make_static_flag_sort(
+  const static_definition (&defs)[N],
+  index_sequence<K...>)
+{
+  return static_sort_passes(static_sort<sizeof...(K)> {{
+    static_sort_value(
+      K < N * static_definition_max_flags &&
+      static_flat_flag_is_used(defs, K < N * static_definition_max_flags ? K : 0)
+      ? static_flag_sort_key(static_flat_flag(defs, K))
+      : static_sort_unused,
+      K)...}});
+}
+
+
+// Whether the name at sorted position p equals a name at positions [q, P)
+// with the same key. Equal names have equal keys and so sort next to each
+// other.
+template <std::size_t N, std::size_t P>
+constexpr
+bool static_name_repeats(
+  const static_definition (&defs)[N],
+  const static_sort<P>& sort,
+  std::size_t p,
+  std::size_t q)
+{
+  return q < P && static_sort_key(sort.values[p]) != static_sort_unused &&
+    static_sort_key(sort.values[q]) == static_sort_key(sort.values[p]) && (
+      static_cstr_equal(
+        defs[static_sort_index(sort.values[p])].name,
+        defs[static_sort_index(sort.values[q])].name) ||
+      static_name_repeats(defs, sort, p, q + 1));
+}
+
+
+template <std::size_t N, std::size_t P>
+constexpr
+bool static_names_repeat(
+  const static_definition (&defs)[N],
+  const static_sort<P>& sort,
+  std::size_t lo = 0,
+  std::size_t hi = P)
+{
+  return hi - lo == 1
+    ? static_name_repeats(defs, sort, lo, lo + 1)
+    : static_names_repeat(defs, sort, lo, lo + (hi - lo) / 2) ||
+      static_names_repeat(defs, sort, lo + (hi - lo) / 2, hi);
+}
+
+
+template <std::size_t N, std::size_t P>
+constexpr
+bool static_flag_repeats(
+  const static_definition (&defs)[N],
+  const static_sort<P>& sort,
+  std::size_t p,
+  std::size_t q)
+{
+  return q < P && static_sort_key(sort.values[p]) != static_sort_unused &&
+    static_sort_key(sort.values[q]) == static_sort_key(sort.values[p]) && (
+      static_cstr_equal(
+        static_flat_flag(defs, static_sort_index(sort.values[p])),
+        static_flat_flag(defs, static_sort_index(sort.values[q]))) ||
+      static_flag_repeats(defs, sort, p, q + 1));
+}
+
+
+template <std::size_t N, std::size_t P>
+constexpr
+bool static_flags_repeat(
+  const static_definition (&defs)[N],
+  const static_sort<P>& sort,
+  std::size_t lo = 0,
+  std::size_t hi = P)
+{
+  return hi - lo == 1
+    ? static_flag_repeats(defs, sort, lo, lo + 1)
+    : static_flags_repeat(defs, sort, lo, lo + (hi - lo) / 2) ||
+      static_flags_repeat(defs, sort, lo + (hi - lo) / 2, hi);
+}
+
+
+// Returns true or throws at the first definition in [lo, hi) without flags
+// or with an invalid flag.
+template <std::size_t N>
+constexpr
+bool static_definitions_are_valid(
+  const static_definition (&defs)[N],
+  std::size_t lo = 0,
+  std::size_t hi = N)
+{
+  return hi - lo == 1
+    ? (!static_flag_is_set(defs[lo], 0)
+       ? throw invalid_flag("static definition has no flag definitions")
+       : !static_flags_are_valid(defs[lo])
+       ? throw invalid_flag("static definition has an invalid flag")
+       : true)
+    : static_definitions_are_valid(defs, lo, lo + (hi - lo) / 2) &&
+      static_definitions_are_valid(defs, lo + (hi - lo) / 2, hi);
+}
+
+
+// Returns true or throws if the definitions, whose flags are sorted by
+// make_static_flag_sort(), are invalid.
+template <std::size_t N, std::size_t P>
+constexpr
+bool check_static_definitions(
+  const static_definition (&defs)[N],
+  const static_sort<P>& flags)
+{
+  return !static_definitions_are_valid(defs) ? false
+    : static_names_repeat(
+        defs,
+        make_static_name_sort(
+          defs, make_index_sequence<static_next_pow2(N)>()))
+    ? throw invalid_flag("duplicate option name in static definitions")
+    : static_flags_repeat(defs, flags)
+    ? throw invalid_flag("duplicate flag in static definitions")
+    : true;
+}
+
+
+// The static_parser long flag table and the multicall_registry program table
+// are static_hash_index objects. The keys are split into buckets by hash and
+// each bucket owns a range of twice as many slots as it has keys, in which
+// its displacement spreads the keys apart. Buckets don't share slots so
+// every displacement is searched for on its own and each array of the table
+// is filled by a single pack expansion, rather than copying the table once
+// per key placed. Keys are grouped by a sorting network whose passes are
+// pack expansions too, and the scans that remain are split in halves, so the
+// recursion depth stays logarithmic in the number of keys.
+
+
+constexpr
+std::size_t static_hash_slot_count(std::size_t n)
+{
+  return 2 * n;
+}
+
+
+constexpr
+std::size_t static_hash_bucket_count(std::size_t n)
+{
+  return static_next_pow2((n + 3) / 4);
+}
+
+
+// The splitmix64 finalizer, which derives bucket and slot numbers from the
+// static_flag_hash() of a key.
+constexpr
+std::uint64_t static_hash_mix_final(std::uint64_t x)
+{
+  return x ^ (x >> 31);
+}
+
+
+constexpr
+std::uint64_t static_hash_mix_second(std::uint64_t x)
+{
+  return static_hash_mix_final((x ^ (x >> 27)) * 0x94d049bb133111ebULL);
+}
+
+
+constexpr
+std::uint64_t static_hash_mix(std::uint64_t x)
+{
+  return static_hash_mix_second((x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL);
+}
+
+
+constexpr
+std::size_t static_hash_bucket(std::uint64_t hash, std::size_t num_buckets)
+{
+  return static_cast<std::size_t>(static_hash_mix(hash)) & (num_buckets - 1);
+}
+
+
+// Slot of a key within a bucket's range of size slots. The top bits of the
+// mixed hash are scaled to the range so size needn't be a power of two.
+constexpr
+std::size_t static_hash_slot(
+  std::uint64_t hash,
+  std::uint32_t displacement,
+  std::size_t size)
+{
+  return static_cast<std::size_t>(
+    ((static_hash_mix(hash + (displacement + 1ULL) * 0x9e3779b97f4a7c15ULL) >>
+      32) * size) >> 32);
+}
+
+
+constexpr std::uint32_t static_hash_no_displacement = 0xffffffff;
+
+
+constexpr std::uint32_t static_hash_max_displacement = 1024;
+
+
+template <std::size_t K>
+struct static_hash_values {
+  std::uint64_t values[K];
+};
+
+
+// Sorts the keys by bucket. Unused keys get the bucket count as their bucket
+// so they sort last.
+template <std::size_t K, std::size_t... I>
+constexpr
+static_sort<sizeof...(I)> make_static_hash_sort(
+  const static_hash_values<K>& hashes,
+  std::size_t count,
+  index_sequence<I...>)
+{
+  return static_sort_passes(static_sort<sizeof...(I)> {{
+    static_sort_value(
+      I < count
+      ? static_hash_bucket(
+          hashes.values[I < K ? I : 0], static_hash_bucket_count(K))
+      : static_hash_bucket_count(K),
+      I)...}});
+}
+
+
+// The key hashes grouped by bucket. Only the first count keys are used. The
+// keys of bucket b are order[starts[b]] through order[starts[b + 1]].
+template <std::size_t K>
+struct static_hash_keys {
+  std::uint64_t hashes[K];
+  std::size_t count;
+  std::size_t starts[static_hash_bucket_count(K) + 1];
+  std::size_t order[K];
+};
+
+
+// Position of the first key in [lo, hi) of the sorted keys whose bucket
+// isn't before b.
+template <std::size_t P>
+constexpr
+std::size_t static_hash_lower_bound(
+  const static_sort<P>& sort,
+  std::size_t b,
+  std::size_t lo = 0,
+  std::size_t hi = P)
+{
+  return lo >= hi ? lo
+    : static_sort_key(sort.values[lo + (hi - lo) / 2]) < b
+    ? static_hash_lower_bound(sort, b, lo + (hi - lo) / 2 + 1, hi)
+    : static_hash_lower_bound(sort, b, lo, lo + (hi - lo) / 2);
+}
+
+
+template <std::size_t K, std::size_t P, std::size_t... I, std::size_t... B>
+constexpr
+static_hash_keys<K> make_static_hash_keys(
+  const static_hash_values<K>& hashes,
+  std::size_t count,
+  const static_sort<P>& sort,
+  index_sequence<I...>,
+  index_sequence<B...>)
+{
+  return static_hash_keys<K> {
+    {hashes.values[I]...},
+    count,
+    {static_hash_lower_bound(sort, B)...},
+    {static_sort_index(sort.values[I])...}};
+}
+
+
+// The bucket whose keys include order position p, found by binary search of
+// the bucket starts in [lo, hi).
+template <std::size_t K>
+constexpr
+std::size_t static_hash_bucket_at(
+  const static_hash_keys<K>& keys,
+  std::size_t p,
+  std::size_t lo = 0,
+  std::size_t hi = static_hash_bucket_count(K))
+{
+  return hi - lo == 1 ? lo
+    : keys.starts[lo + (hi - lo) / 2] <= p
+    ? static_hash_bucket_at(keys, p, lo + (hi - lo) / 2, hi)
+    : static_hash_bucket_at(keys, p, lo, lo + (hi - lo) / 2);
+}
+
+
+// Whether the key at order position i has the same hash as any key at
+// positions [j, last).
+template <std::size_t K>
+constexpr
+bool static_hash_is_repeated(
+  const static_hash_keys<K>& keys,
+  std::size_t i,
+  std::size_t j,
+  std::size_t last)
+{
+  return j < last && (
+    keys.hashes[keys.order[i]] == keys.hashes[keys.order[j]] ||
+    static_hash_is_repeated(keys, i, j + 1, last));
+}
+
+
+template <std::size_t K>
+constexpr
+bool static_hash_has_repeats(
+  const static_hash_keys<K>& keys,
+  std::size_t first,
+  std::size_t last)
+{
+  return first < last && (
+    static_hash_is_repeated(keys, first, first + 1, last) ||
+    static_hash_has_repeats(keys, first + 1, last));
+}
+
+
+// Whether the key at order position i lands on the same slot as any key at
+// positions [j, last).
+template <std::size_t K>
+constexpr
+bool static_hash_slot_is_shared(
+  const static_hash_keys<K>& keys,
+  std::size_t i,
+  std::size_t j,
+  std::size_t last,
+  std::uint32_t displacement,
+  std::size_t size)
+{
+  return j < last && (
+    static_hash_slot(keys.hashes[keys.order[i]], displacement, size) ==
+      static_hash_slot(keys.hashes[keys.order[j]], displacement, size) ||
+    static_hash_slot_is_shared(keys, i, j + 1, last, displacement, size));
+}
+
+
+// Whether the keys at order positions [first, last) land on distinct slots of
+// a range of size slots with the given displacement.
+template <std::size_t K>
+constexpr
+bool static_hash_displacement_fits(
+  const static_hash_keys<K>& keys,
+  std::size_t first,
+  std::size_t last,
+  std::uint32_t displacement,
+  std::size_t size)
+{
+  return first == last || (
+    !static_hash_slot_is_shared(
+      keys, first, first + 1, last, displacement, size) &&
+    static_hash_displacement_fits(keys, first + 1, last, displacement, size));
+}
+
+
+// The first displacement in [d, end) that fits bucket b or
+// static_hash_no_displacement.
+template <std::size_t K>
+constexpr
+std::uint32_t static_hash_find_displacement_in(
+  const static_hash_keys<K>& keys,
+  std::size_t b,
+  std::uint32_t d,
+  std::uint32_t end)
+{
+  return d == end ? static_hash_no_displacement
+    : static_hash_displacement_fits(
+        keys, keys.starts[b], keys.starts[b + 1], d,
+        static_hash_slot_count(keys.starts[b + 1] - keys.starts[b]))
+    ? d
+    : static_hash_find_displacement_in(keys, b, d + 1, end);
+}
+
+
+template <std::size_t K>
+constexpr
+std::uint32_t static_hash_search_displacement(
+  const static_hash_keys<K>& keys,
+  std::size_t b,
+  std::uint32_t first);
+
+
+template <std::size_t K>
+constexpr
+std::uint32_t static_hash_found_or_next(
+  const static_hash_keys<K>& keys,
+  std::size_t b,
+  std::uint32_t first,
+  std::uint32_t found)
+{
+  return found != static_hash_no_displacement ? found
+    : static_hash_search_displacement(keys, b, first + 32);
+}
+
+
+// Searches in blocks of 32 displacements so the recursion depth grows with
+// the number of blocks rather than the number of displacements tried.
+template <std::size_t K>
+constexpr
+std::uint32_t static_hash_search_displacement(
+  const static_hash_keys<K>& keys,
+  std::size_t b,
+  std::uint32_t first)
+{
+  return first >= static_hash_max_displacement
+    ? throw std::invalid_argument("too many keys in a static hash bucket")
+    : static_hash_found_or_next(
+        keys, b, first,
+        static_hash_find_displacement_in(keys, b, first, first + 32));
+}
+
+
+// Keys with equal hashes can never be told apart, which is what a duplicate
+// key looks like, so those are rejected before searching.
+template <std::size_t K>
+constexpr
+std::uint32_t static_hash_find_displacement(
+  const static_hash_keys<K>& keys,
+  std::size_t b)
+{
+  return keys.starts[b] == keys.starts[b + 1] ? 0u
+    : static_hash_has_repeats(keys, keys.starts[b], keys.starts[b + 1])
+    ? throw std::invalid_argument("duplicate key in static hash index")
+    : static_hash_search_displacement(keys, b, 0);
+}
+
+
+// Index plus one of the key of bucket b at order positions [i, last) that
+// lands on the given slot, or zero.
+template <std::size_t K>
+constexpr
+std::uint16_t static_hash_slot_owner(
+  const static_hash_keys<K>& keys,
+  const static_hash_index<K>& index,
+  std::size_t b,
+  std::size_t slot,
+  std::size_t i,
+  std::size_t last)
+{
+  return i == last ? 0
+    : index.offsets[b] + static_hash_slot(
+        keys.hashes[keys.order[i]], index.displacements[b],
+        index.offsets[b + 1] - index.offsets[b]) == slot
+    ? static_cast<std::uint16_t>(keys.order[i] + 1)
+    : static_hash_slot_owner(keys, index, b, slot, i + 1, last);
+}
+
+
+// Bucket b owns slots [2 * starts[b], 2 * starts[b + 1]) so slot / 2 is one
+// of its order positions.
+template <std::size_t K>
+constexpr
+std::uint16_t static_hash_slot_entry(
+  const static_hash_keys<K>& keys,
+  const static_hash_index<K>& index,
+  std::size_t slot)
+{
+  return slot >= static_hash_slot_count(keys.count) ? 0
+    : static_hash_slot_owner(
+        keys, index, static_hash_bucket_at(keys, slot / 2), slot,
+        keys.starts[static_hash_bucket_at(keys, slot / 2)],
+        keys.starts[static_hash_bucket_at(keys, slot / 2) + 1]);
+}
 
-};
 
+template <std::size_t K, std::size_t... B, std::size_t... S>
+constexpr
+static_hash_index<K> static_hash_index_with_slots(
+  const static_hash_keys<K>& keys,
+  const static_hash_index<K>& index,
+  index_sequence<B...>,
+  index_sequence<S...>)
+{
+  return static_hash_index<K> {
+    {index.displacements[B]...},
+    {index.offsets[B]..., index.offsets[static_hash_bucket_count(K)]},
+    {static_hash_slot_entry(keys, index, S)...}};
+}
 
-/**
- * @brief
- * A convenience output stream that will accumulate what is streamed to it and
- * then, on destruction, format the accumulated string (via the
- * argagg::fmt_string() function) to the provided std::ostream.
- *
- * Example use:
- *
- * @code
- * {
- *   argagg::fmt_ostream f(std::cerr);
- *   f << "Usage: " << really_long_string << '\n';
- * } // on destruction here the formatted string will be streamed to std::cerr
- * @endcode
- */
-struct fmt_ostream : public std::ostringstream {
 
-  /**
-   * @brief
-   * Reference to the final output stream that the formatted string will be
-   * streamed to.
-   */
-  std::ostream& output;
+template <std::size_t K, std::size_t... B>
+constexpr
+static_hash_index<K> make_static_hash_index(
+  const static_hash_keys<K>& keys,
+  index_sequence<B...>)
+{
+  return static_hash_index_with_slots(
+    keys,
+    static_hash_index<K> {
+      {static_hash_find_displacement(keys, B)...},
+      {static_cast<std::uint32_t>(static_hash_slot_count(keys.starts[B]))...,
+       static_cast<std::uint32_t>(static_hash_slot_count(keys.count))},
+      {}},
+    index_sequence<B...>(),
+    make_index_sequence<static_hash_slot_count(K)>());
+}
 
-  /**
-   * @brief
-   * Construct to output to the provided output stream when this object is
-   * destroyed.
-   */
-  fmt_ostream(std::ostream& output);
 
-  /**
-   * @brief
-   * Special destructor that will format the accumulated string using fmt (via
-   * the argagg::fmt_string() function) and stream it to the std::ostream
-   * stored.
-   */
-  ~fmt_ostream();
+template <std::size_t K>
+constexpr
+static_hash_index<K> make_static_hash_index(
+  const static_hash_values<K>& hashes,
+  std::size_t count)
+{
+  return make_static_hash_index(
+    make_static_hash_keys(
+      hashes, count,
+      make_static_hash_sort(
+        hashes, count, make_index_sequence<static_next_pow2(K)>()),
+      make_index_sequence<K>(),
+      make_index_sequence<static_hash_bucket_count(K) + 1>()),
+    make_index_sequence<static_hash_bucket_count(K)>());
+}
 
-};
 
+template <std::size_t K>
+std::size_t static_hash_index<K>::find(std::uint64_t hash) const
+{
+  const auto b = static_hash_bucket(hash, static_hash_bucket_count(K));
+  const std::size_t first = this->offsets[b];
+  const std::size_t size = this->offsets[b + 1] - first;
+  if (size == 0) {
+    return no_option;
+  }
+  const auto entry = this->slots[
+    first + static_hash_slot(hash, this->displacements[b], size)];
+  return entry == 0 ? no_option : static_cast<std::size_t>(entry - 1);
+}
 
-/**
- * @brief
- * Processes the provided string using the fmt utility and returns the
- * resulting output as a string. Not the most efficient (in time or space) but
- * gets the job done.
- */
-std::string fmt_string(const std::string& s);
 
+// Position of the first value in [lo, hi) of a sort that isn't below value.
+template <std::size_t P>
+constexpr
+std::size_t static_sort_lower_bound(
+  const static_sort<P>& sort,
+  std::uint64_t value,
+  std::size_t lo = 0,
+  std::size_t hi = P)
+{
+  return lo >= hi ? lo
+    : sort.values[lo + (hi - lo) / 2] < value
+    ? static_sort_lower_bound(sort, value, lo + (hi - lo) / 2 + 1, hi)
+    : static_sort_lower_bound(sort, value, lo, lo + (hi - lo) / 2);
+}
 
-/**
- * @brief
- * Writes the option help to the given stream.
- */
-std::ostream& operator << (std::ostream& os, const argagg::parser& x);
+
+// Ordinal plus one of the definition with the short flag at sorted position
+// p if its character is c, or zero.
+template <std::size_t P>
+constexpr
+std::uint16_t static_short_flag_entry_at(
+  const static_sort<P>& flags,
+  std::size_t c,
+  std::size_t p)
+{
+  return p < P && static_sort_key(flags.values[p]) == (static_sort_short | c)
+    ? static_cast<std::uint16_t>(
+        static_sort_index(flags.values[p]) / static_definition_max_flags + 1)
+    : 0;
+}
 
 
-} // namespace argagg
+// Ordinal plus one of the definition with the given short flag character, or
+// zero if there is none, from the flags sorted by make_static_flag_sort().
+template <std::size_t P>
+constexpr
+std::uint16_t static_short_flag_entry(
+  const static_sort<P>& flags,
+  std::size_t c)
+{
+  return static_short_flag_entry_at(
+    flags, c,
+    static_sort_lower_bound(flags, static_sort_value(static_sort_short | c, 0)));
+}
 
 
-// ---- end of declarations, header-only implementations follow ----
+// Number of used long flags of defn from the j-th on.
+constexpr
+std::size_t static_definition_long_flags(
+  const static_definition& defn,
+  std::size_t j = 0)
+{
+  return !static_flag_is_set(defn, j) ? 0
+    : (static_flag_is_short(defn.flags[j]) ? 0u : 1u) +
+      static_definition_long_flags(defn, j + 1);
+}
 
 
-namespace argagg {
+// One pass of a parallel prefix sum: every count gets the count d positions
+// before it added. After the passes for d = 1, 2, 4, ... each count is the
+// sum of all counts up to it.
+template <std::size_t N, std::size_t... I>
+constexpr
+static_long_flag_ranks<N> static_long_flag_ranks_pass(
+  const static_long_flag_ranks<N>& ranks,
+  std::size_t d,
+  index_sequence<I...>)
+{
+  return static_long_flag_ranks<N> {{
+    (I >= d ? ranks.before[I] + ranks.before[I - d] : ranks.before[I])...}};
+}
 
 
-template <typename T>
-T option_result::as() const
+template <std::size_t N>
+constexpr
+static_long_flag_ranks<N> static_long_flag_ranks_passes(
+  const static_long_flag_ranks<N>& ranks,
+  std::size_t d = 1)
 {
-  if (this->arg) {
-    return convert::arg<T>(this->arg);
-  } else {
-    throw option_lacks_argument_error("option has no argument");
-  }
+  return d > N ? ranks
+    : static_long_flag_ranks_passes(
+        static_long_flag_ranks_pass(ranks, d, make_index_sequence<N + 1>()),
+        2 * d);
 }
 
 
-template <typename T>
-T option_result::as(const T& t) const
+template <std::size_t N, std::size_t... I>
+constexpr
+static_long_flag_ranks<N> make_static_long_flag_ranks(
+  const static_definition (&defs)[N],
+  index_sequence<I...>)
 {
-  if (this->arg) {
-    try {
-      return convert::arg<T>(this->arg);
-    } catch (...) {
-      return t;
-    }
-  } else {
-    // I actually think this will never happen. To call this method you have
-    // to access a specific option_result for an option. If there's a
-    // specific option_result then the option was found. If the option
-    // requires an argument then it will definitely have an argument
-    // otherwise the parser would have complained.
-    return t;
-  }
+  return static_long_flag_ranks_passes(static_long_flag_ranks<N> {{
+    (I == 0 ? 0u : static_definition_long_flags(defs[I == 0 ? 0 : I - 1]))...}});
 }
 
 
-template <typename T>
-option_result::operator T () const
+// The definition in [lo, hi) that has the k-th long flag.
+template <std::size_t N>
+constexpr
+std::size_t static_long_flag_definition(
+  const static_long_flag_ranks<N>& ranks,
+  std::size_t k,
+  std::size_t lo = 0,
+  std::size_t hi = N)
 {
-  return this->as<T>();
+  return hi - lo == 1 ? lo
+    : ranks.before[lo + (hi - lo) / 2] <= k
+    ? static_long_flag_definition(ranks, k, lo + (hi - lo) / 2, hi)
+    : static_long_flag_definition(ranks, k, lo, lo + (hi - lo) / 2);
 }
 
 
-template <> inline
-option_result::operator bool () const
+// The k-th long flag of defn from the j-th flag on.
+constexpr
+const char* static_definition_long_flag(
+  const static_definition& defn,
+  std::size_t k,
+  std::size_t j = 0)
 {
-  return this->arg != nullptr;
+  return static_flag_is_short(defn.flags[j])
+    ? static_definition_long_flag(defn, k, j + 1)
+    : k == 0 ? defn.flags[j]
+    : static_definition_long_flag(defn, k - 1, j + 1);
 }
 
 
-inline
-bool option_result::operator ! () const
+constexpr
+static_long_flag make_static_long_flag(
+  const char* flag,
+  std::size_t len,
+  std::size_t ordinal)
 {
-  return !static_cast<bool>(*this);
+  return static_long_flag {flag, len, static_flag_hash(flag, len), ordinal};
 }
 
 
-inline
-std::size_t option_results::count() const
+template <std::size_t N>
+constexpr
+static_long_flag make_static_long_flag(
+  const static_definition (&defs)[N],
+  const static_long_flag_ranks<N>& ranks,
+  std::size_t k,
+  std::size_t i)
 {
-  return this->all.size();
+  return make_static_long_flag(
+    static_definition_long_flag(defs[i], k - ranks.before[i]),
+    static_strlen(static_definition_long_flag(defs[i], k - ranks.before[i])),
+    i);
 }
 
 
-inline
-option_result& option_results::operator [] (std::size_t index)
+// The k-th long flag in definition order or an empty entry if there are
+// fewer than k + 1 long flags.
+template <std::size_t N>
+constexpr
+static_long_flag static_long_flag_entry(
+  const static_definition (&defs)[N],
+  const static_long_flag_ranks<N>& ranks,
+  std::size_t k)
 {
-  return this->all[index];
+  return k >= ranks.before[N] ? static_long_flag {nullptr, 0, 0, no_option}
+    : make_static_long_flag(
+        defs, ranks, k, static_long_flag_definition(ranks, k));
 }
 
 
-inline
-const option_result& option_results::operator [] (std::size_t index) const
+template <std::size_t N>
+template <std::size_t... S, std::size_t... L>
+constexpr static_parser<N>::static_parser(
+  const static_definition (&defs)[N],
+  index_sequence<S...> short_flags,
+  index_sequence<L...> long_flags)
+: static_parser(
+    defs,
+    make_static_long_flag_ranks(defs, make_index_sequence<N + 1>()),
+    make_static_flag_sort(
+      defs,
+      make_index_sequence<
+        static_next_pow2(N * static_definition_max_flags)>()),
+    short_flags,
+    long_flags)
 {
-  return this->all[index];
 }
 
 
-template <typename T>
-T option_results::as() const
+template <std::size_t N>
+template <std::size_t P, std::size_t... S, std::size_t... L>
+constexpr static_parser<N>::static_parser(
+  const static_definition (&defs)[N],
+  const static_long_flag_ranks<N>& ranks,
+  const static_sort<P>& flags,
+  index_sequence<S...>,
+  index_sequence<L...>)
+: definitions(defs),
+  short_map {static_short_flag_entry(flags, S)...},
+  long_map {static_long_flag_entry(defs, ranks, L)...},
+  num_long_flags(ranks.before[N]),
+  long_index(make_static_hash_index(
+    static_hash_values<sizeof...(L)> {{
+      static_long_flag_entry(defs, ranks, L).hash...}},
+    ranks.before[N]))
 {
-  if (this->all.size() == 0) {
-    throw std::out_of_range("no option arguments to convert");
-  }
-  return this->all.back().as<T>();
 }
 
 
-template <typename T>
-T option_results::as(const T& t) const
+template <std::size_t N>
+constexpr option_handle static_parser<N>::handle(
+  const char* name,
+  std::size_t i) const
 {
-  if (this->all.size() == 0) {
-    return t;
-  }
-  return this->all.back().as<T>(t);
+  return i == N
+    ? throw unknown_option("no option with that name in static_parser")
+    : static_cstr_equal(this->definitions[i].name, name)
+    ? option_handle {i}
+    : this->handle(name, i + 1);
 }
 
 
+template <std::size_t N>
 template <typename T>
-option_results::operator T () const
+constexpr typed_option_handle<T> static_parser<N>::handle(
+  const char* name) const
 {
-  return this->as<T>();
+  return typed_option_handle<T> {this->handle(name).index};
 }
 
 
-template <> inline
-option_results::operator bool () const
+template <std::size_t N>
+std::size_t static_parser<N>::find_short_flag(char flag) const
 {
-  return this->all.size() > 0;
+  const auto entry = this->short_map[static_cast<unsigned char>(flag)];
+  return entry == 0 ? no_option : static_cast<std::size_t>(entry - 1);
 }
 
 
-inline
-bool option_results::operator ! () const
+template <std::size_t N>
+std::size_t static_parser<N>::find_long_flag(
+  const char* flag,
+  std::size_t len) const
 {
-  return !static_cast<bool>(*this);
+  const auto i = this->long_index.find(static_flag_hash(flag, len));
+  if (i == no_option) {
+    return no_option;
+  }
+  const auto& entry = this->long_map[i];
+  return entry.len == len && std::memcmp(entry.flag, flag, len) == 0
+    ? entry.ordinal : no_option;
 }
 
 
-inline
-bool parser_results::has_option(const std::string& name) const
+template <std::size_t N>
+std::size_t static_parser<N>::find_prefix_flag(
+  const char*,
+  std::size_t,
+  std::size_t&) const
 {
-  const auto it = this->options.find(name);
-  return ( it != this->options.end()) && it->second.all.size() > 0;
+  return no_option;
 }
 
 
-inline
-option_results& parser_results::operator [] (const std::string& name)
-try {
-  return this->options.at(name);
-} catch (const std::out_of_range&) {
-  std::ostringstream msg;
-  msg << "no option named \"" << name << "\" in parser_results";
-  throw unknown_option(msg.str());
+template <std::size_t N>
+std::size_t static_parser<N>::find_abbreviated_flag(
+  const char*,
+  std::size_t) const
+{
+  return no_option;
 }
 
 
-inline
-const option_results&
-parser_results::operator [] (const std::string& name) const
-try {
-  return this->options.at(name);
-} catch (const std::out_of_range&) {
-  std::ostringstream msg;
-  msg << "no option named \"" << name << "\" in parser_results";
-  throw unknown_option(msg.str());
+template <std::size_t N>
+unsigned int static_parser<N>::num_args(std::size_t ordinal) const
+{
+  return this->definitions[ordinal].num_args;
 }
 
 
-inline
-std::size_t parser_results::count() const
+template <std::size_t N>
+parser_results static_parser<N>::parse(int argc, const char** argv) const
 {
-  return this->pos.size();
+  return parse_arguments(*this, nullptr, argc, argv);
 }
 
 
-inline
-const char* parser_results::operator [] (std::size_t index) const
+template <std::size_t N>
+parser_results static_parser<N>::parse(int argc, char** argv) const
 {
-  return this->pos[index];
+  return parse(argc, const_cast<const char**>(argv));
 }
 
 
-template <typename T>
-T parser_results::as(std::size_t i) const
+template <std::size_t N>
+void static_parser<N>::parse_into(
+  int argc, const char** argv, parser_results& out) const
 {
-  return convert::arg<T>(this->pos[i]);
+  parse_arguments_into(*this, nullptr, argc, argv, out);
 }
 
 
-template <typename T>
-std::vector<T> parser_results::all_as() const
+template <std::size_t N>
+void static_parser<N>::parse_into(
+  int argc, char** argv, parser_results& out) const
 {
-  std::vector<T> v(this->pos.size());
-  std::transform(
-    this->pos.begin(), this->pos.end(), v.begin(),
-    [](const char* arg) {
-      return convert::arg<T>(arg);
-    });
-  return v;
+  parse_into(argc, const_cast<const char**>(argv), out);
 }
 
 
-inline
-bool definition::wants_no_arguments() const
+template <std::size_t N>
+parser_results static_parser<N>::parse(
+  int argc, const char** argv, stop_at stop) const
 {
-  return this->num_args == 0;
+  parser_results results;
+  parse_into(argc, argv, results, stop);
+  return results;
 }
 
 
-inline
-bool definition::requires_arguments() const
+template <std::size_t N>
+parser_results static_parser<N>::parse(
+  int argc, char** argv, stop_at stop) const
 {
-  return this->num_args > 0;
+  return parse(argc, const_cast<const char**>(argv), stop);
 }
 
 
-inline
-bool cmd_line_arg_is_option_flag(
-  const char* s)
+template <std::size_t N>
+void static_parser<N>::parse_into(
+  int argc, const char** argv, parser_results& out, stop_at stop) const
 {
-  auto len = std::strlen(s);
+  parse_arguments_until(*this, nullptr, argc, argv, stop, out);
+}
 
-  // The shortest possible flag has two characters: a hyphen and an
-  // alpha-numeric character.
-  if (len < 2) {
-    return false;
-  }
 
-  // All flags must start with a hyphen.
-  if (s[0] != '-') {
-    return false;
-  }
+template <std::size_t N>
+parser_results static_parser<N>::parse(
+  int argc,
+  const char** argv,
+  std::vector<const char*>& forwarded,
+  forward what) const
+{
+  parser_results results;
+  parse_into(argc, argv, results, forwarded, what);
+  return results;
+}
 
-  // Shift the name forward by a character to account for the initial hyphen.
-  // This means if s was originally "-v" then name will be "v".
-  const char* name = s + 1;
 
-  // Check if we're dealing with a long flag.
-  bool is_long = false;
-  if (s[1] == '-') {
-    is_long = true;
+template <std::size_t N>
+parser_results static_parser<N>::parse(
+  int argc,
+  char** argv,
+  std::vector<const char*>& forwarded,
+  forward what) const
+{
+  return parse(argc, const_cast<const char**>(argv), forwarded, what);
+}
 
-    // Just -- is not a valid flag.
-    if (len == 2) {
-      return false;
-    }
 
-    // Shift the name forward to account for the extra hyphen. This means if s
-    // was originally "--output" then name will be "output".
-    name = s + 2;
-  }
+template <std::size_t N>
+void static_parser<N>::parse_into(
+  int argc,
+  const char** argv,
+  parser_results& out,
+  std::vector<const char*>& forwarded,
+  forward what) const
+{
+  parse_arguments_forwarding(
+    *this, nullptr, argc, argv, what, out, forwarded);
+}
 
-  // The first character of the flag name must be alpha-numeric. This is to
-  // prevent things like "---a" from being valid flags.
-  len = std::strlen(name);
-  if (!std::isalnum(name[0])) {
-    return false;
-  }
 
-  // At this point in is_valid_flag_definition() we would check if the short
-  // flag has only one character. At command line specification you can group
-  // short flags together or even add an argument to a short flag without a
-  // space delimiter. Thus we don't check if this has only one character
-  // because it might not.
+template <std::size_t N>
+template <typename ForwardIt>
+parser_results static_parser<N>::parse(ForwardIt first, ForwardIt last) const
+{
+  parser_results results;
+  parse_into(first, last, results);
+  return results;
+}
 
-  // If this is a long flag then we expect all characters *up to* an equal sign
-  // to be alpha-numeric or a hyphen. After the equal sign you are specify the
-  // argument to a long flag which can be basically anything.
-  if (is_long) {
-    bool encountered_equal = false;
-    return std::all_of(name, name + len, [&](const char& c) {
-        if (encountered_equal) {
-          return true;
-        } else {
-          if (c == '=') {
-            encountered_equal = true;
-            return true;
-          }
-          return std::isalnum(c) || c == '-';
-        }
-      });
-  }
 
-  // At this point we are not dealing with a long flag. We already checked that
-  // the first character is alpha-numeric so we've got the case of a single
-  // short flag covered. This might be a short flag group though and we might
-  // be tempted to check that each character of the short flag group is
-  // alpha-numeric. However, you can specify the argument for a short flag
-  // without a space delimiter (e.g. "-I/usr/local/include") so you can't tell
-  // if the rest of a short flag group is part of the argument or not unless
-  // you know what is a defined flag or not. We leave that kind of processing
-  // to the parser.
-  return true;
+template <std::size_t N>
+template <typename ForwardIt>
+void static_parser<N>::parse_into(
+  ForwardIt first, ForwardIt last, parser_results& out) const
+{
+  parse_range_into(*this, nullptr, first, last, out);
 }
 
 
-inline
-bool is_valid_flag_definition(
-  const char* s)
+template <std::size_t N>
+parse_error static_parser<N>::try_parse(
+  int argc, const char** argv, parser_results& out) const
 {
-  auto len = std::strlen(s);
+  return try_parse_arguments_into(*this, nullptr, argc, argv, out);
+}
 
-  // The shortest possible flag has two characters: a hyphen and an
-  // alpha-numeric character.
-  if (len < 2) {
-    return false;
-  }
 
-  // All flags must start with a hyphen.
-  if (s[0] != '-') {
-    return false;
-  }
+template <std::size_t N>
+parse_error static_parser<N>::try_parse(
+  int argc, char** argv, parser_results& out) const
+{
+  return try_parse(argc, const_cast<const char**>(argv), out);
+}
 
-  // Shift the name forward by a character to account for the initial hyphen.
-  // This means if s was originally "-v" then name will be "v".
-  const char* name = s + 1;
 
-  // Check if we're dealing with a long flag.
-  bool is_long = false;
-  if (s[1] == '-') {
-    is_long = true;
+template <std::size_t N>
+template <typename ForwardIt>
+parse_error static_parser<N>::try_parse(
+  ForwardIt first, ForwardIt last, parser_results& out) const
+{
+  return try_parse_range_into(*this, nullptr, first, last, out);
+}
 
-    // Just -- is not a valid flag.
-    if (len == 2) {
-      return false;
-    }
 
-    // Shift the name forward to account for the extra hyphen. This means if s
-    // was originally "--output" then name will be "output".
-    name = s + 2;
-  }
+template <std::size_t N>
+parse_error static_parser<N>::try_parse_all(
+  int argc, const char** argv, parser_results& out,
+  std::vector<parse_error>& errors) const
+{
+  errors.clear();
+  return try_parse_arguments_into(*this, nullptr, argc, argv, out, &errors);
+}
 
-  // The first character of the flag name must be alpha-numeric. This is to
-  // prevent things like "---a" from being valid flags.
-  len = std::strlen(name);
-  if (!std::isalnum(name[0])) {
-    return false;
-  }
 
-  // If this is a short flag then it must only have one character.
-  if (!is_long && len > 1) {
-    return false;
-  }
+template <std::size_t N>
+parse_error static_parser<N>::try_parse_all(
+  int argc, char** argv, parser_results& out,
+  std::vector<parse_error>& errors) const
+{
+  return try_parse_all(argc, const_cast<const char**>(argv), out, errors);
+}
 
-  // The rest of the characters must be alpha-numeric, but long flags are
-  // allowed to have hyphens too.
-  return std::all_of(name + 1, name + len, [&](const char& c) {
-      return std::isalnum(c) || (c == '-' && is_long);
-    });
+
+template <std::size_t N>
+template <typename ForwardIt>
+parse_error static_parser<N>::try_parse_all(
+  ForwardIt first, ForwardIt last, parser_results& out,
+  std::vector<parse_error>& errors) const
+{
+  errors.clear();
+  return try_parse_range_into(*this, nullptr, first, last, out, &errors);
 }
 
 
-inline
-bool flag_is_short(
-  const char* s)
+template <std::size_t N>
+const definition* static_parser<N>::definition_for(std::size_t) const
 {
-  return s[0] == '-' && std::isalnum(s[1]);
+  return nullptr;
 }
 
 
-inline
-bool parser_map::known_short_flag(
-  const char flag) const
+template <std::size_t N>
+const static_parser<N>& static_parser<N>::lookup() const
 {
-  return this->short_map[static_cast<std::size_t>(flag)] != nullptr;
+  return *this;
 }
 
 
-inline
-const definition* parser_map::get_definition_for_short_flag(
-  const char flag) const
+template <std::size_t N>
+incremental_parser<static_parser<N>> static_parser<N>::incremental() const
 {
-  return this->short_map[static_cast<std::size_t>(flag)];
+  return incremental_parser<static_parser<N>>(*this);
 }
 
 
-inline
-bool parser_map::known_long_flag(
-  const std::string& flag) const
+template <std::size_t N>
+parse_event_range<static_parser<N>> static_parser<N>::parse_events(
+  int argc, const char** argv) const
 {
-  const auto existing_long_flag = this->long_map.find(flag);
-  return existing_long_flag != long_map.end();
+  return parse_event_range<static_parser<N>> {this, argc, argv};
 }
 
 
-inline
-const definition* parser_map::get_definition_for_long_flag(
-  const std::string& flag) const
+template <std::size_t N>
+parse_event_range<static_parser<N>> static_parser<N>::parse_events(
+  int argc, char** argv) const
 {
-  const auto existing_long_flag = this->long_map.find(flag);
-  if (existing_long_flag == long_map.end()) {
-    return nullptr;
-  }
-  return existing_long_flag->second;
+  return parse_events(argc, const_cast<const char**>(argv));
 }
 
 
-inline
-parser_map validate_definitions(
-  const std::vector<definition>& definitions)
+template <std::size_t N, std::size_t P>
+constexpr static_parser<N> make_checked_static_parser(
+  const static_definition (&definitions)[N],
+  const static_sort<P>& flags)
 {
-  std::unordered_map<std::string, const definition*> long_map;
-  parser_map map {{{nullptr}}, std::move(long_map)};
+  return check_static_definitions(definitions, flags)
+    ? static_parser<N>(
+        definitions,
+        make_static_long_flag_ranks(definitions, make_index_sequence<N + 1>()),
+        flags,
+        make_index_sequence<256>(),
+        make_index_sequence<N * static_definition_max_flags>())
+    : throw invalid_flag("invalid static definitions");
+}
 
-  for (auto& defn : definitions) {
 
-    if (defn.flags.size() == 0) {
-      std::ostringstream msg;
-      msg << "option \"" << defn.name << "\" has no flag definitions";
-      throw invalid_flag(msg.str());
-    }
+template <std::size_t N>
+constexpr static_parser<N> make_static_parser(
+  const static_definition (&definitions)[N])
+{
+  static_assert(
+    N * static_definition_max_flags < 0xffff, "too many static definitions");
+  return make_checked_static_parser(
+    definitions,
+    make_static_flag_sort(
+      definitions,
+      make_index_sequence<
+        static_next_pow2(N * static_definition_max_flags)>()));
+}
 
-    for (auto& flag : defn.flags) {
 
-      if (!is_valid_flag_definition(flag.data())) {
-        std::ostringstream msg;
-        msg << "flag \"" << flag << "\" specified for option \"" << defn.name
-            << "\" is invalid";
-        throw invalid_flag(msg.str());
-      }
+template <typename Parser>
+incremental_parser<Parser>::incremental_parser(const Parser& parser)
+: parser_(&parser), state_(initial_parse_state()), argv_index_(0)
+{
+}
 
-      if (flag_is_short(flag.data())) {
-        const std::size_t short_flag_letter = static_cast<std::size_t>(flag[1]);
-        const auto existing_short_flag =
-          map.short_map[short_flag_letter];
-        bool short_flag_already_exists = (existing_short_flag != nullptr);
-        if (short_flag_already_exists) {
-          std::ostringstream msg;
-          msg << "duplicate short flag \"" << flag
-              << "\" found, specified by both option  \"" << defn.name
-              << "\" and option \"" << existing_short_flag->name;
-          throw invalid_flag(msg.str());
-        }
-        map.short_map[static_cast<std::size_t>(short_flag_letter)] = &defn;
-        continue;
-      }
 
-      // If we're here then this is a valid, long-style flag.
-      if (map.known_long_flag(flag)) {
-        const auto existing_long_flag = map.get_definition_for_long_flag(flag);
-        std::ostringstream msg;
-        msg << "duplicate long flag \"" << flag
-            << "\" found, specified by both option  \"" << defn.name
-            << "\" and option \"" << existing_long_flag->name;
-        throw invalid_flag(msg.str());
-      }
-      map.long_map.insert(std::make_pair(flag, &defn));
-    }
+template <typename Parser>
+template <typename Handler>
+void incremental_parser<Parser>::feed(const char* arg, Handler&& handler)
+{
+  ++this->argv_index_;
+  const arg_token token = lex_arg(arg);
+  const auto& lookup = this->parser_->lookup();
+  while (!parse_step(lookup, this->state_, token, this->argv_index_, handler)) {
   }
-
-  return map;
 }
 
 
-inline
-parser_results parser::parse(int argc, const char** argv) const
+template <typename Parser>
+void incremental_parser<Parser>::finish()
 {
-  // Inspect each definition to see if its valid. You may wonder "why don't
-  // you do this validation on construction?" I had thought about it but
-  // realized that since I've made the parser an aggregate type (granted it
-  // just "aggregates" a single vector) I would need to track any changes to
-  // the definitions vector and re-run the validity check in order to
-  // maintain this expected "validity invariant" on the object. That would
-  // then require hiding the definitions vector as a private entry and then
-  // turning the parser into a thin interface (by re-exposing setters and
-  // getters) to the vector methods just so that I can catch when the
-  // definition has been modified. It seems much simpler to just enforce the
-  // validity when you actually want to parse because it's at the moment of
-  // parsing that you know the definitions are complete.
-  parser_map map = validate_definitions(this->definitions);
+  const parse_state state = this->state_;
+  this->state_ = initial_parse_state();
+  this->argv_index_ = 0;
+  finish_parse(state);
+}
 
-  // Initialize the parser results that we'll be returning. Store the program
-  // name (assumed to be the first command line argument) and initialize
-  // everything else as empty.
-  std::unordered_map<std::string, option_results> options {};
-  std::vector<const char*> pos;
-  parser_results results {argv[0], std::move(options), std::move(pos)};
 
-  // Add an empty option result for each definition.
-  for (const auto& defn : this->definitions) {
-    option_results opt_results {{}};
-    results.options.insert(
-      std::make_pair(defn.name, opt_results));
-  }
+template <typename Parser>
+std::size_t incremental_parser<Parser>::count() const
+{
+  return this->argv_index_;
+}
 
-  // Don't start off ignoring flags. We only ignore flags after a -- shows up
-  // in the command line arguments.
-  bool ignore_flags = false;
 
-  // Keep track of any options that are expecting arguments.
-  const char* last_flag_expecting_args = nullptr;
-  option_result* last_option_expecting_args = nullptr;
-  unsigned int num_option_args_to_consume = 0;
+template <typename Parser>
+parse_event_iterator<Parser>::parse_event_iterator()
+: parser_(nullptr), argv_(nullptr), argc_(0), argv_index_(0),
+  in_token_(false), token_(), state_(initial_parse_state()), event_()
+{
+}
 
-  // Get pointers to pointers so we can treat the raw pointer array as an
-  // iterator for standard library algorithms. This isn't used yet but can be
-  // used to template this function to work on iterators over strings or
-  // C-strings.
-  const char** arg_i = argv + 1;
-  const char** arg_end = argv + argc;
 
-  while (arg_i != arg_end) {
-    auto arg_i_cstr = *arg_i;
-    auto arg_i_len = std::strlen(arg_i_cstr);
+template <typename Parser>
+parse_event_iterator<Parser>::parse_event_iterator(
+  const Parser& parser,
+  int argc,
+  const char** argv)
+: parser_(&parser), argv_(argv),
+  argc_(static_cast<std::size_t>(std::max(argc, 0))), argv_index_(1),
+  in_token_(false), token_(), state_(initial_parse_state()), event_()
+{
+  this->advance();
+}
 
-    // Some behavior to note: if the previous option is expecting an argument
-    // then the next entry will be treated as a positional argument even if
-    // it looks like a flag.
-    bool treat_as_positional_argument = (
-        ignore_flags
-        || num_option_args_to_consume > 0
-        || !cmd_line_arg_is_option_flag(arg_i_cstr)
-      );
-    if (treat_as_positional_argument) {
 
-      // If last option is expecting some specific positive number of
-      // arguments then give this argument to that option, *regardless of
-      // whether or not the argument looks like a flag or is the special "--"
-      // argument*.
-      if (num_option_args_to_consume > 0) {
-        last_option_expecting_args->arg = arg_i_cstr;
-        --num_option_args_to_consume;
-        ++arg_i;
-        continue;
+template <typename Parser>
+void parse_event_iterator<Parser>::advance()
+{
+  const auto& lookup = this->parser_->lookup();
+  bool emitted = false;
+  const auto sink = [&](const parse_event& event) {
+      this->event_ = event;
+      emitted = true;
+    };
+  while (!emitted) {
+    if (!this->in_token_) {
+      if (this->argv_index_ >= this->argc_) {
+        // Become the end iterator before checking for a dangling option so
+        // that a throwing iterator doesn't keep going.
+        this->parser_ = nullptr;
+        finish_parse(this->state_);
+        return;
       }
+      this->token_ = lex_arg(this->argv_[this->argv_index_]);
+      this->in_token_ = true;
+    }
+    if (parse_step(lookup, this->state_, this->token_, this->argv_index_,
+                   sink)) {
+      this->in_token_ = false;
+      ++this->argv_index_;
+    }
+  }
+}
 
-      // Now we check if this is just "--" which is a special argument that
-      // causes all following arguments to be treated as non-options and is
-      // itselve discarded.
-      if (std::strncmp(arg_i_cstr, "--", 2) == 0 && arg_i_len == 2) {
-        ignore_flags = true;
-        ++arg_i;
-        continue;
-      }
 
-      // If there are no expectations for option arguments then simply use
-      // this argument as a positional argument.
-      results.pos.push_back(arg_i_cstr);
-      ++arg_i;
-      continue;
-    }
+template <typename Parser>
+const parse_event& parse_event_iterator<Parser>::operator * () const
+{
+  return this->event_;
+}
 
-    // Reset the "expecting argument" state.
-    last_flag_expecting_args = nullptr;
-    last_option_expecting_args = nullptr;
-    num_option_args_to_consume = 0;
 
-    // If we're at this point then we're definitely dealing with something
-    // that is flag-like and has hyphen as the first character and has a
-    // length of at least two characters. How we handle this potential flag
-    // depends on whether or not it is a long-option so we check that first.
-    bool is_long_flag = (arg_i_cstr[1] == '-');
+template <typename Parser>
+const parse_event* parse_event_iterator<Parser>::operator -> () const
+{
+  return &this->event_;
+}
 
-    if (is_long_flag) {
 
-      // Long flags have a complication: their arguments can be specified
-      // using an '=' character right inside the argument. That means an
-      // argument like "--output=foobar.txt" is actually an option with flag
-      // "--output" and argument "foobar.txt". So we look for the first
-      // instance of the '=' character and keep it in long_flag_arg. If
-      // long_flag_arg is nullptr then we didn't find '='. We need the
-      // flag_len to construct long_flag_str below.
-      auto long_flag_arg = std::strchr(arg_i_cstr, '=');
-      std::size_t flag_len = arg_i_len;
-      if (long_flag_arg != nullptr) {
-        flag_len = static_cast<std::size_t>(long_flag_arg - arg_i_cstr);
-      }
-      std::string long_flag_str(arg_i_cstr, flag_len);
+template <typename Parser>
+parse_event_iterator<Parser>& parse_event_iterator<Parser>::operator ++ ()
+{
+  this->advance();
+  return *this;
+}
 
-      if (!map.known_long_flag(long_flag_str)) {
-        std::ostringstream msg;
-        msg << "found unexpected flag: " << long_flag_str;
-        throw unexpected_option_error(msg.str());
-      }
 
-      const auto defn = map.get_definition_for_long_flag(long_flag_str);
+template <typename Parser>
+parse_event_iterator<Parser> parse_event_iterator<Parser>::operator ++ (int)
+{
+  parse_event_iterator copy = *this;
+  this->advance();
+  return copy;
+}
 
-      if (long_flag_arg != nullptr && defn->num_args == 0) {
-        std::ostringstream msg;
-        msg << "found argument for option not expecting an argument: "
-            << arg_i_cstr;
-        throw unexpected_argument_error(msg.str());
-      }
 
-      // We've got a legitimate, known long flag option so we add an option
-      // result. This option result initially has an arg of nullptr, but that
-      // might change in the following block.
-      auto& opt_results = results.options[defn->name];
-      option_result opt_result {nullptr};
-      opt_results.all.push_back(std::move(opt_result));
-
-      if (defn->requires_arguments()) {
-        bool there_is_an_equal_delimited_arg = (long_flag_arg != nullptr);
-        if (there_is_an_equal_delimited_arg) {
-          // long_flag_arg would be "=foo" in the "--output=foo" case so we
-          // increment by 1 to get rid of the equal sign.
-          opt_results.all.back().arg = long_flag_arg + 1;
-        } else {
-          last_flag_expecting_args = arg_i_cstr;
-          last_option_expecting_args = &(opt_results.all.back());
-          num_option_args_to_consume = defn->num_args;
-        }
-      }
+template <typename Parser>
+bool parse_event_iterator<Parser>::operator == (
+  const parse_event_iterator& other) const
+{
+  return this->parser_ == nullptr && other.parser_ == nullptr;
+}
 
-      ++arg_i;
-      continue;
-    }
 
-    // If we've made it here then we're looking at either a short flag or a
-    // group of short flags. Short flags can be grouped together so long as
-    // they don't require any arguments unless the option that does is the
-    // last in the group ("-o x -v" is okay, "-vo x" is okay, "-ov x" is
-    // not). So starting after the dash we're going to process each character
-    // as if it were a separate flag. Note "sf_idx" stands for "short flag
-    // index".
-    for (std::size_t sf_idx = 1; sf_idx < arg_i_len; ++sf_idx) {
-      const auto short_flag = arg_i_cstr[sf_idx];
+template <typename Parser>
+bool parse_event_iterator<Parser>::operator != (
+  const parse_event_iterator& other) const
+{
+  return !(*this == other);
+}
 
-      if (!std::isalnum(short_flag)) {
-        std::ostringstream msg;
-        msg << "found non-alphanumeric character '" << arg_i_cstr[sf_idx]
-            << "' in flag group '" << arg_i_cstr << "'";
-        throw std::domain_error(msg.str());
-      }
 
-      if (!map.known_short_flag(short_flag)) {
-        std::ostringstream msg;
-        msg << "found unexpected flag '" << arg_i_cstr[sf_idx]
-            << "' in flag group '" << arg_i_cstr << "'";
-        throw unexpected_option_error(msg.str());
-      }
+template <typename Parser>
+parse_event_iterator<Parser> parse_event_range<Parser>::begin() const
+{
+  return parse_event_iterator<Parser>(*this->parser, this->argc, this->argv);
+}
 
-      auto defn = map.get_definition_for_short_flag(short_flag);
-      auto& opt_results = results.options[defn->name];
-
-      // Create an option result with an empty argument (for now) and add it
-      // to this option's results.
-      option_result opt_result {nullptr};
-      opt_results.all.push_back(std::move(opt_result));
-
-      if (defn->requires_arguments()) {
-
-        // If this short flag's option requires an argument and we're the
-        // last flag in the short flag group then just put the parser into
-        // "expecting argument for last option" state and move onto the next
-        // command line argument.
-        bool is_last_short_flag_in_group = (sf_idx == arg_i_len - 1);
-        if (is_last_short_flag_in_group) {
-          last_flag_expecting_args = arg_i_cstr;
-          last_option_expecting_args = &(opt_results.all.back());
-          num_option_args_to_consume = defn->num_args;
-          break;
-        }
 
-        // If this short flag's option requires an argument and we're NOT the
-        // last flag in the short flag group then we automatically consume
-        // the rest of the short flag group as the argument for this flag.
-        // This is how we get the POSIX behavior of being able to specify a
-        // flag's arguments without a white space delimiter (e.g.
-        // "-I/usr/local/include").
-        opt_results.all.back().arg = arg_i_cstr + sf_idx + 1;
-        break;
-      }
+template <typename Parser>
+parse_event_iterator<Parser> parse_event_range<Parser>::end() const
+{
+  return parse_event_iterator<Parser>();
+}
+
+
+inline
+const subcommand* subcommand_parser::find(const char* name) const
+{
+  for (const auto& command : this->commands) {
+    if (std::strcmp(command.name, name) == 0) {
+      return &command;
     }
+  }
+  return nullptr;
+}
 
-    ++arg_i;
-    continue;
+
+inline
+subcommand_results subcommand_parser::parse(int argc, const char** argv) const
+{
+  subcommand_results results {{}, nullptr, {}, 0, nullptr};
+  parse_arguments_until(
+    this->global.lookup(), this->global.map().names, argc, argv,
+    stop_at::first_positional, results.global);
+  const argv_span& rest = results.global.remainder;
+  if (rest.empty()) {
+    return results;
   }
 
-  // If we're done with all of the arguments but are still expecting
-  // arguments for a previous option then we haven't satisfied that option.
-  // This is an error.
-  if (num_option_args_to_consume > 0) {
+  results.command = this->find(rest.data[0]);
+  if (results.command == nullptr) {
     std::ostringstream msg;
-    msg << "last option \"" << last_flag_expecting_args
-        << "\" expects an argument but the parser ran out of command line "
-        << "arguments to parse";
-    throw option_lacks_argument_error(msg.str());
+    msg << "found unexpected subcommand: " << rest.data[0];
+    throw unexpected_subcommand_error(msg.str());
   }
-
+  results.argc = static_cast<int>(rest.size);
+  results.argv = rest.data;
+  const compiled_parser parser = results.command->make_parser();
+  parser.parse_into(results.argc, results.argv, results.results);
   return results;
 }
 
 
 inline
-parser_results parser::parse(int argc, char** argv) const
+subcommand_results subcommand_parser::parse(int argc, char** argv) const
 {
   return parse(argc, const_cast<const char**>(argv));
 }
@@ -1685,10 +8902,17 @@ std::string fmt_string(const std::string& s)
 }
 
 
+/**
+ * @brief
+ * Writes the help for each definition, see operator<<(std::ostream&, const
+ * argagg::parser&).
+ */
 inline
-std::ostream& operator << (std::ostream& os, const argagg::parser& x)
+void write_definitions_help(
+  std::ostream& os,
+  const std::vector<definition>& definitions)
 {
-  for (auto& definition : x.definitions) {
+  for (auto& definition : definitions) {
     os << "    ";
     for (auto& flag : definition.flags) {
       os << flag;
@@ -1698,6 +8922,145 @@ std::ostream& operator << (std::ostream& os, const argagg::parser& x)
     }
     os << "\n        " << definition.help << '\n';
   }
+}
+
+
+inline
+std::ostream& operator << (std::ostream& os, const argagg::parser& x)
+{
+  write_definitions_help(os, x.definitions);
+  return os;
+}
+
+
+inline
+std::ostream& operator << (std::ostream& os, const subcommand_parser& x)
+{
+  write_definitions_help(os, x.global.definitions());
+  os << "\nCommands:\n";
+  for (const auto& command : x.commands) {
+    os << "    " << command.name << "\n        " << command.help << '\n';
+  }
+  return os;
+}
+
+
+inline
+const char* program_basename(const char* path)
+{
+  const char* slash = std::strrchr(path, '/');
+  return slash == nullptr ? path : slash + 1;
+}
+
+
+constexpr
+bool multicall_name_tail_is_valid(const char* s)
+{
+  return *s == '\0' || (*s != '/' && multicall_name_tail_is_valid(s + 1));
+}
+
+
+template <std::size_t N>
+constexpr
+bool multicall_names_are_valid(
+  const subcommand (&programs)[N],
+  std::size_t lo,
+  std::size_t hi)
+{
+  return hi - lo == 1
+    ? programs[lo].name[0] != '\0' &&
+      multicall_name_tail_is_valid(programs[lo].name)
+    : multicall_names_are_valid(programs, lo, lo + (hi - lo) / 2) &&
+      multicall_names_are_valid(programs, lo + (hi - lo) / 2, hi);
+}
+
+
+template <std::size_t N, std::size_t... I>
+constexpr
+static_hash_values<N> make_multicall_hashes(
+  const subcommand (&programs)[N],
+  index_sequence<I...>)
+{
+  return static_hash_values<N> {{
+    static_flag_hash(programs[I].name, static_strlen(programs[I].name))...}};
+}
+
+
+template <std::size_t N>
+const subcommand* multicall_registry<N>::find(
+  const char* name,
+  std::size_t len) const
+{
+  const auto i = this->index.find(static_flag_hash(name, len));
+  if (i == no_option) {
+    return nullptr;
+  }
+  const subcommand& program = this->programs[i];
+  if (std::strncmp(program.name, name, len) != 0 ||
+      program.name[len] != '\0') {
+    return nullptr;
+  }
+  return &program;
+}
+
+
+template <std::size_t N>
+const subcommand* multicall_registry<N>::find(const char* name) const
+{
+  return this->find(name, std::strlen(name));
+}
+
+
+template <std::size_t N>
+multicall_results multicall_registry<N>::parse(
+  int argc,
+  const char** argv) const
+{
+  multicall_results results {nullptr, {}};
+  const char* name = argc > 0 ? program_basename(argv[0]) : "";
+  results.program = this->find(name);
+  if (results.program == nullptr) {
+    std::ostringstream msg;
+    msg << "found unexpected program name: " << name;
+    throw unexpected_program_error(msg.str());
+  }
+  const compiled_parser parser = results.program->make_parser();
+  parser.parse_into(argc, argv, results.results);
+  return results;
+}
+
+
+template <std::size_t N>
+multicall_results multicall_registry<N>::parse(int argc, char** argv) const
+{
+  return parse(argc, const_cast<const char**>(argv));
+}
+
+
+template <std::size_t N>
+constexpr multicall_registry<N> make_multicall_registry(
+  const subcommand (&programs)[N])
+{
+  static_assert(N < 0xffff, "too many multicall programs");
+  return !multicall_names_are_valid(programs, 0, N)
+    ? throw std::invalid_argument("invalid multicall program name")
+    : multicall_registry<N> {
+        programs,
+        make_static_hash_index(
+          make_multicall_hashes(programs, make_index_sequence<N>()), N)};
+}
+
+
+template <std::size_t N>
+std::ostream& operator << (
+  std::ostream& os,
+  const multicall_registry<N>& x)
+{
+  os << "Programs:\n";
+  for (std::size_t i = 0; i < N; ++i) {
+    os << "    " << x.programs[i].name << "\n        "
+       << x.programs[i].help << '\n';
+  }
   return os;
 }
 
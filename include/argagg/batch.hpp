@@ -0,0 +1,397 @@
+/*
+ * @file
+ * @brief
+ * Defines argagg::parse_batch() which parses many command lines in parallel
+ * with one shared parser. Requires linking with the platform's threads library.
+ *
+ * @copyright
+ * Copyright (c) 2018 Viet The Nguyen
+ *
+ * @copyright
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * @copyright
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * @copyright
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#pragma once
+#ifndef ARGAGG_ARGAGG_BATCH_HPP
+#define ARGAGG_ARGAGG_BATCH_HPP
+
+#include "argagg.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+
+namespace argagg {
+
+/**
+ * @brief
+ * The outcome of parsing one command line with parse_batch().
+ */
+struct batch_result {
+
+  /**
+   * @brief
+   * The parser results, empty when parsing failed.
+   */
+  parser_results results;
+
+  /**
+   * @brief
+   * The exception parsing threw or nullptr if it succeeded. Use
+   * std::rethrow_exception() to inspect it.
+   */
+  std::exception_ptr error;
+
+  /**
+   * @brief
+   * Returns true if the command line parsed successfully.
+   */
+  bool ok() const;
+
+};
+
+
+/**
+ * @brief
+ * Worker threads that are started once and then shared by every
+ * parse_batch() call given the pool, so a program that parses batches
+ * repeatedly doesn't pay for starting threads each time. The calling thread
+ * of a batch works too, so a pool of size n starts n - 1 threads.
+ *
+ * A pool runs one batch at a time; concurrent calls wait for each other.
+ */
+struct batch_pool {
+
+  /**
+   * @brief
+   * Starts num_threads - 1 worker threads, or
+   * std::thread::hardware_concurrency() - 1 when num_threads is zero. If a
+   * thread can't be started the pool is simply smaller.
+   */
+  explicit batch_pool(unsigned num_threads = 0);
+
+  batch_pool(const batch_pool&) = delete;
+  batch_pool& operator = (const batch_pool&) = delete;
+
+  /**
+   * @brief
+   * Stops and joins the worker threads.
+   */
+  ~batch_pool();
+
+  /**
+   * @brief
+   * Number of threads a batch runs on, including the calling thread.
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief
+   * Calls work(t) for each t in [0, num_threads) on its own thread, the
+   * calling thread being t = 0, and returns once all calls have returned.
+   * num_threads must not be more than size() and work must not throw.
+   */
+  void run(
+    const std::function<void(std::size_t)>& work,
+    std::size_t num_threads);
+
+private:
+
+  void worker(std::size_t self);
+
+  std::mutex run_mutex_;
+
+  std::mutex mutex_;
+
+  std::condition_variable wake_;
+
+  std::condition_variable done_;
+
+  const std::function<void(std::size_t)>* work_;
+
+  std::size_t num_working_;
+
+  std::size_t pending_;
+
+  std::uint64_t generation_;
+
+  bool stopping_;
+
+  std::vector<std::thread> threads_;
+
+};
+
+
+/**
+ * @brief
+ * Parses every command line in [first, last) with the parser on the threads
+ * of the pool, one of which is the calling thread. Each command line is a
+ * container of arguments that parse(ForwardIt, ForwardIt) accepts, such as
+ * an std::vector of std::string, with the program name first. The results
+ * are returned in input order and errors are captured per command line
+ * instead of thrown.
+ *
+ * The command lines are split evenly between the threads up front and
+ * threads that run out of work steal command lines from the others.
+ */
+template <typename Parser, typename RandomIt>
+std::vector<batch_result> parse_batch(
+  batch_pool& pool,
+  const Parser& parser,
+  RandomIt first,
+  RandomIt last);
+
+
+/**
+ * @brief
+ * Same as the parse_batch() above but compiles the parser once up front
+ * instead of validating its definitions for every command line.
+ */
+template <typename RandomIt>
+std::vector<batch_result> parse_batch(
+  batch_pool& pool,
+  const parser& argparser,
+  RandomIt first,
+  RandomIt last);
+
+
+/**
+ * @brief
+ * Same as parse_batch(batch_pool&, const Parser&, RandomIt, RandomIt) on a
+ * @ref batch_pool of num_threads threads (at most one per command line) that
+ * is started for this call only. Use a batch_pool directly to parse several
+ * batches without starting threads for each.
+ */
+template <typename Parser, typename RandomIt>
+std::vector<batch_result> parse_batch(
+  const Parser& parser,
+  RandomIt first,
+  RandomIt last,
+  unsigned num_threads = 0);
+
+} // namespace argagg
+
+
+// ---- end of declarations, header-only implementations follow ----
+
+
+namespace argagg {
+
+
+inline
+bool batch_result::ok() const
+{
+  return this->error == nullptr;
+}
+
+
+inline
+batch_pool::batch_pool(unsigned num_threads)
+: work_(nullptr), num_working_(0), pending_(0), generation_(0),
+  stopping_(false)
+{
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  try {
+    this->threads_.reserve(num_threads - 1);
+    for (std::size_t t = 1; t < num_threads; ++t) {
+      this->threads_.emplace_back(&batch_pool::worker, this, t);
+    }
+  } catch (const std::exception&) {
+  }
+}
+
+
+inline
+batch_pool::~batch_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->stopping_ = true;
+  }
+  this->wake_.notify_all();
+  for (auto& thread : this->threads_) {
+    thread.join();
+  }
+}
+
+
+inline
+std::size_t batch_pool::size() const
+{
+  return this->threads_.size() + 1;
+}
+
+
+inline
+void batch_pool::run(
+  const std::function<void(std::size_t)>& work,
+  std::size_t num_threads)
+{
+  std::lock_guard<std::mutex> run_lock(this->run_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->work_ = &work;
+    this->num_working_ = num_threads;
+    this->pending_ = num_threads - 1;
+    ++this->generation_;
+  }
+  this->wake_.notify_all();
+  work(0);
+  std::unique_lock<std::mutex> lock(this->mutex_);
+  this->done_.wait(lock, [this]() { return this->pending_ == 0; });
+}
+
+
+inline
+void batch_pool::worker(std::size_t self)
+{
+  std::uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(this->mutex_);
+  for (;;) {
+    this->wake_.wait(lock, [&]() {
+        return this->stopping_ || this->generation_ != seen;
+      });
+    if (this->stopping_) {
+      return;
+    }
+    seen = this->generation_;
+    if (self >= this->num_working_) {
+      continue;
+    }
+    const auto& work = *this->work_;
+    lock.unlock();
+    work(self);
+    lock.lock();
+    if (--this->pending_ == 0) {
+      this->done_.notify_one();
+    }
+  }
+}
+
+
+/**
+ * @brief
+ * The command lines a parse_batch() thread owns. The owner and thieves alike
+ * claim them one at a time from the front. Aligned to a cache line so
+ * threads don't contend over neighbouring queues.
+ */
+struct alignas(64) batch_queue {
+  std::atomic<std::size_t> next;
+  std::size_t end;
+};
+
+
+template <typename Parser, typename RandomIt>
+std::vector<batch_result> parse_batch(
+  batch_pool& pool,
+  const Parser& parser,
+  RandomIt first,
+  RandomIt last)
+{
+  const auto num_lines = static_cast<std::size_t>(std::distance(first, last));
+  std::vector<batch_result> results(num_lines);
+  if (num_lines == 0) {
+    return results;
+  }
+  const std::size_t num_queues = std::min(pool.size(), num_lines);
+
+  // std::vector and new[] only guarantee over-aligned storage from C++17, so
+  // align the queues by hand.
+  std::unique_ptr<char[]> storage(
+    new char[(num_queues + 1) * sizeof(batch_queue)]);
+  void* aligned = storage.get();
+  std::size_t space = (num_queues + 1) * sizeof(batch_queue);
+  std::align(
+    alignof(batch_queue), num_queues * sizeof(batch_queue), aligned, space);
+  batch_queue* queues = static_cast<batch_queue*>(aligned);
+  for (std::size_t i = 0; i < num_queues; ++i) {
+    new (&queues[i]) batch_queue;
+    queues[i].next = num_lines * i / num_queues;
+    queues[i].end = num_lines * (i + 1) / num_queues;
+  }
+
+  const std::function<void(std::size_t)> work = [&](std::size_t self) {
+      for (std::size_t k = 0; k < num_queues; ++k) {
+        batch_queue& queue = queues[(self + k) % num_queues];
+        std::size_t i;
+        while ((i = queue.next.fetch_add(1, std::memory_order_relaxed)) <
+               queue.end) {
+          const auto& line = first[static_cast<std::ptrdiff_t>(i)];
+          using std::begin;
+          using std::end;
+          try {
+            results[i].results = parser.parse(begin(line), end(line));
+          } catch (...) {
+            results[i].error = std::current_exception();
+          }
+        }
+      }
+    };
+  pool.run(work, num_queues);
+  return results;
+}
+
+
+template <typename RandomIt>
+std::vector<batch_result> parse_batch(
+  batch_pool& pool,
+  const parser& argparser,
+  RandomIt first,
+  RandomIt last)
+{
+  const compiled_parser compiled = argparser.compile();
+  return parse_batch(pool, compiled, first, last);
+}
+
+
+template <typename Parser, typename RandomIt>
+std::vector<batch_result> parse_batch(
+  const Parser& parser,
+  RandomIt first,
+  RandomIt last,
+  unsigned num_threads)
+{
+  const auto num_lines = static_cast<std::size_t>(std::distance(first, last));
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  batch_pool pool(static_cast<unsigned>(
+    std::min(static_cast<std::size_t>(num_threads),
+             std::max<std::size_t>(num_lines, 1))));
+  return parse_batch(pool, parser, first, last);
+}
+
+
+} // namespace argagg
+
+
+#endif // ARGAGG_ARGAGG_BATCH_HPP
@@ -0,0 +1,866 @@
+#include "../include/argagg/argagg.hpp"
+#include "../include/argagg/batch.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+// Written to by every benchmark so the compiler can't throw the work away.
+static volatile std::size_t g_sink = 0;
+
+
+// Calls f() the given number of times and returns the average wall clock time
+// per call in nanoseconds.
+template <typename F>
+static double ns_per_call(std::size_t iterations, F f)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    f();
+  }
+  const auto stop = std::chrono::steady_clock::now();
+  const std::chrono::duration<double, std::nano> elapsed = stop - start;
+  return elapsed.count() / static_cast<double>(iterations);
+}
+
+
+static void report(const std::string& name, double ns)
+{
+  std::cout << "  " << std::left << std::setw(48) << name
+            << std::right << std::setw(14) << std::fixed
+            << std::setprecision(1) << ns << " ns\n";
+}
+
+
+// A parser and command line that look like a typical tool invocation.
+static argagg::parser typical_parser()
+{
+  return argagg::parser {{
+      {"help", {"-h", "--help"}, "shows this help message", 0},
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"quiet", {"-q", "--quiet"}, "be quiet", 0},
+      {"jobs", {"-j", "--jobs"}, "number of jobs", 1},
+      {"output", {"-o", "--output"}, "output file", 1},
+      {"include", {"-I", "--include"}, "include path", 1},
+      {"define", {"-D", "--define"}, "preprocessor definition", 1},
+      {"config", {"-c", "--config"}, "configuration file", 1},
+      {"dry-run", {"-n", "--dry-run"}, "don't do anything", 0},
+      {"timeout", {"-t", "--timeout"}, "timeout in seconds", 1},
+    }};
+}
+
+
+static std::vector<const char*> typical_argv()
+{
+  return {
+    "tool", "-v", "--jobs=8", "-o", "out.bin", "-Iinclude", "-I", "src",
+    "--define", "NDEBUG", "-qn", "--timeout", "30", "input1.txt",
+    "input2.txt", "--", "-not-a-flag"};
+}
+
+
+static void bench_compiled_parser(std::size_t iterations)
+{
+  const argagg::parser parser = typical_parser();
+  const argagg::compiled_parser compiled = parser.compile();
+  std::vector<const char*> argv = typical_argv();
+  const int argc = static_cast<int>(argv.size());
+
+  report("walk argv (strlen only)", ns_per_call(iterations, [&]() {
+      std::size_t total = 0;
+      for (int i = 0; i < argc; ++i) {
+        total += std::strlen(argv[static_cast<std::size_t>(i)]);
+      }
+      g_sink = g_sink + total;
+    }));
+
+  report("parser::parse()", ns_per_call(iterations, [&]() {
+      g_sink = g_sink + parser.parse(argc, &(argv.front())).count();
+    }));
+
+  report("compiled_parser::parse()", ns_per_call(iterations, [&]() {
+      g_sink = g_sink + compiled.parse(argc, &(argv.front())).count();
+    }));
+
+  argagg::parser_results reused;
+  report("compiled_parser::parse_into()", ns_per_call(iterations, [&]() {
+      compiled.parse_into(argc, &(argv.front()), reused);
+      g_sink = g_sink + reused.count();
+    }));
+
+  report("compiled_parser::parse_into() arena", ns_per_call(iterations, [&]() {
+      argagg::monotonic_arena arena;
+      argagg::parser_results results(&arena);
+      compiled.parse_into(argc, &(argv.front()), results);
+      g_sink = g_sink + results.count();
+    }));
+}
+
+
+// Compares throwing parse errors with returning them from try_parse() for a
+// command line with an unknown flag.
+static void bench_parse_errors(std::size_t iterations)
+{
+  const argagg::compiled_parser compiled = typical_parser().compile();
+  std::vector<const char*> argv = typical_argv();
+  argv[argv.size() / 2] = "--unknown-flag";
+  const int argc = static_cast<int>(argv.size());
+  argagg::parser_results results;
+
+  report("compiled_parser::parse_into() throwing", ns_per_call(iterations,
+      [&]() {
+        try {
+          compiled.parse_into(argc, &(argv.front()), results);
+        } catch (const argagg::unexpected_option_error& e) {
+          g_sink = g_sink + std::strlen(e.what());
+        }
+      }));
+
+  report("compiled_parser::try_parse()", ns_per_call(iterations, [&]() {
+      const auto error = compiled.try_parse(argc, &(argv.front()), results);
+      g_sink = g_sink + error.argv_index;
+    }));
+}
+
+
+static void bench_option_lookup(std::size_t iterations)
+{
+  const argagg::parser parser = typical_parser();
+  const argagg::compiled_parser compiled = parser.compile();
+  std::vector<const char*> argv = typical_argv();
+  const argagg::parser_results args =
+    compiled.parse(static_cast<int>(argv.size()), &(argv.front()));
+  const argagg::option_handle include = compiled.handle("include");
+
+  report("parser_results[\"include\"]", ns_per_call(iterations, [&]() {
+      g_sink = g_sink + args["include"].count();
+    }));
+
+  report("parser_results[option_handle]", ns_per_call(iterations, [&]() {
+      g_sink = g_sink + args[include].count();
+    }));
+}
+
+
+static void bench_long_flag_lookup(std::size_t iterations)
+{
+  for (const std::size_t num_flags : {10u, 100u, 10000u}) {
+    const argagg::definition defn {"flag", {"--flag"}, "flag", 0};
+    std::vector<std::string> flags;
+    std::vector<argagg::long_flag_entry> entries;
+    std::unordered_map<std::string, const argagg::definition*> hash_map;
+    for (std::size_t i = 0; i < num_flags; ++i) {
+      flags.push_back("--long-flag-number-" + std::to_string(i));
+      entries.push_back({flags.back(), &defn});
+      hash_map.insert(std::make_pair(flags.back(), &defn));
+    }
+    argagg::long_flag_map perfect_map {};
+    perfect_map.build(entries);
+
+    // What the parser actually sees: null terminated command line arguments.
+    std::vector<const char*> args;
+    for (const auto& flag : flags) {
+      args.push_back(flag.c_str());
+    }
+
+    const std::string suffix = " (" + std::to_string(num_flags) + " flags)";
+    std::size_t i = 0;
+
+    report("std::unordered_map + std::string" + suffix,
+      ns_per_call(iterations, [&]() {
+        const char* arg = args[i++ % args.size()];
+        const std::string key(arg, std::strlen(arg));
+        g_sink = g_sink + (hash_map.find(key) != hash_map.end());
+      }));
+
+    report("long_flag_map" + suffix, ns_per_call(iterations, [&]() {
+        const char* arg = args[i++ % args.size()];
+        g_sink = g_sink +
+          (perfect_map.find(arg, std::strlen(arg)) != nullptr);
+      }));
+  }
+}
+
+// Simulates a huge argument list (e.g. from xargs or a build system) made of
+// long flags and file paths, and compares the instruction sets lex_args()
+// can use. Reported times are per argument.
+static void bench_simd_lex(std::size_t iterations)
+{
+  std::vector<argagg::simd_level> levels {argagg::simd_level::scalar};
+  if (argagg::best_simd_level() != argagg::simd_level::scalar) {
+    levels.push_back(argagg::simd_level::sse2);
+  }
+  if (argagg::best_simd_level() == argagg::simd_level::avx2) {
+    levels.push_back(argagg::simd_level::avx2);
+  }
+  const char* level_names[] = {"scalar", "sse2", "avx2"};
+
+  for (const std::size_t num_args : {1000u, 10000u, 100000u, 1000000u}) {
+    std::vector<std::string> storage;
+    storage.reserve(num_args);
+    for (std::size_t i = 0; i < num_args; ++i) {
+      const auto n = std::to_string(i);
+      switch (i % 4) {
+        case 0: storage.push_back("--include-directory-number-" + n); break;
+        case 1: storage.push_back("--define-preprocessor=SYMBOL_" + n); break;
+        case 2: storage.push_back("src/module/subdirectory/file" + n + ".cpp");
+          break;
+        default: storage.push_back("-I/usr/local/include/" + n); break;
+      }
+    }
+    std::vector<const char*> args;
+    for (const auto& arg : storage) {
+      args.push_back(arg.c_str());
+    }
+    std::vector<argagg::arg_token> tokens(num_args);
+    const std::size_t runs = std::max<std::size_t>(1, iterations / num_args);
+
+    for (const auto level : levels) {
+      const double ns = ns_per_call(runs, [&]() {
+          argagg::lex_args(
+            args.data(), args.data() + args.size(), tokens.data(), level);
+          g_sink = g_sink + tokens.back().len;
+        });
+      report(
+        std::string("lex_args ") + level_names[static_cast<int>(level)] +
+          " (" + std::to_string(num_args) + " args, per arg)",
+        ns / static_cast<double>(num_args));
+    }
+  }
+}
+
+
+// Compares the std::isalnum() calls flag validation used to make with the
+// character class table that replaced them.
+static void bench_char_class(std::size_t iterations)
+{
+  std::string text;
+  for (std::size_t i = 0; text.size() < 4096; ++i) {
+    text += "--include-directory-number-" + std::to_string(i) + "=/usr/lib ";
+  }
+  const auto per_char = [&](double ns) {
+      return ns / static_cast<double>(text.size());
+    };
+  const std::size_t runs = std::max<std::size_t>(1, iterations / 100);
+
+  report("std::isalnum(c) || c == '-' (per char)",
+    per_char(ns_per_call(runs, [&]() {
+      std::size_t total = 0;
+      for (const char c : text) {
+        total += (std::isalnum(c) || c == '-') ? 1u : 0u;
+      }
+      g_sink = g_sink + total;
+    })));
+
+  report("argagg::char_class(c) (per char)", per_char(ns_per_call(runs, [&]() {
+      const unsigned char name_class =
+        argagg::char_class_alnum | argagg::char_class_hyphen;
+      std::size_t total = 0;
+      for (const char c : text) {
+        total += (argagg::char_class(c) & name_class) != 0 ? 1u : 0u;
+      }
+      g_sink = g_sink + total;
+    })));
+
+  const char* flags[] = {"-h", "--help", "--include-directory", "-I",
+    "--dry-run", "--output-file-name"};
+  std::size_t i = 0;
+  report("is_valid_flag_definition()", ns_per_call(iterations, [&]() {
+      g_sink = g_sink +
+        (argagg::is_valid_flag_definition(flags[i++ % 6]) ? 1u : 0u);
+    }));
+
+  std::vector<const char*> argv = typical_argv();
+  report("lex_args() scalar (typical argv)", ns_per_call(iterations, [&]() {
+      argagg::arg_token tokens[32];
+      argagg::lex_args(argv.data(), argv.data() + argv.size(), tokens,
+        argagg::simd_level::scalar);
+      g_sink = g_sink + tokens[0].len;
+    }));
+}
+
+
+// Parses the same command line with parsers that have more and more
+// definitions. Only the options that occur are materialized so the parse
+// time should stay flat.
+static void bench_many_definitions(std::size_t iterations)
+{
+  std::vector<const char*> argv = typical_argv();
+  const int argc = static_cast<int>(argv.size());
+
+  for (const std::size_t num_definitions : {10u, 100u, 1000u, 10000u, 100000u})
+  {
+    argagg::parser parser = typical_parser();
+    for (std::size_t i = parser.definitions.size(); i < num_definitions; ++i) {
+      const auto name = "tunable-" + std::to_string(i);
+      parser.definitions.push_back({name, {"--" + name}, "a tunable", 1});
+    }
+    const argagg::compiled_parser compiled = parser.compile();
+
+    report(
+      "compiled_parser::parse() (" + std::to_string(num_definitions) +
+        " definitions)",
+      ns_per_call(iterations, [&]() {
+        g_sink = g_sink + compiled.parse(argc, &(argv.front())).count();
+      }));
+  }
+}
+
+
+
+// Splits and parses a command line received as a single string of about 200
+// bytes, reusing the storage of the previous command as a server would.
+static void bench_command_line(std::size_t iterations)
+{
+  const argagg::compiled_parser compiled = typical_parser().compile();
+  const std::string command =
+    "tool -v --jobs=8 -o 'build/output directory/out.bin' -Iinclude -I src "
+    "--define \"VERSION=\\\"1.2.3\\\"\" -qn --timeout 30 input1.txt "
+    "'input file 2.txt' input\\ 3.txt -- -not-a-flag trailing argument";
+
+  argagg::command_line cmd;
+  report("command_line::split() (" + std::to_string(command.size()) +
+           " bytes)",
+         ns_per_call(iterations, [&]() {
+      cmd.split(command);
+      g_sink = g_sink + cmd.size();
+    }));
+
+  argagg::parser_results results;
+  report("split() + compiled_parser::parse_into()",
+         ns_per_call(iterations, [&]() {
+      cmd.split(command);
+      compiled.parse_into(cmd.begin(), cmd.end(), results);
+      g_sink = g_sink + results.count();
+    }));
+}
+
+
+// Parses a batch of recorded command lines with parse_batch() on an
+// increasing number of threads up to the core count, starting the threads per
+// call and reusing a batch_pool. Reported times are per command line along
+// with the speedup over a single thread.
+static void bench_parse_batch(std::size_t iterations)
+{
+  const argagg::compiled_parser compiled = typical_parser().compile();
+  const std::vector<const char*> argv = typical_argv();
+  const std::size_t num_lines = 50000;
+  std::vector<std::vector<std::string>> lines(num_lines);
+  for (std::size_t i = 0; i < num_lines; ++i) {
+    lines[i].assign(argv.begin(), argv.end());
+    lines[i].push_back("input" + std::to_string(i) + ".txt");
+  }
+  const std::size_t runs = std::max<std::size_t>(1, iterations / num_lines);
+
+  const unsigned num_cores = std::max(1u, std::thread::hardware_concurrency());
+  double single = 0.0;
+  for (unsigned num_threads = 1; ; num_threads *= 2) {
+    num_threads = std::min(num_threads, num_cores);
+    const double ns = ns_per_call(runs, [&]() {
+        const auto results = argagg::parse_batch(
+          compiled, lines.begin(), lines.end(), num_threads);
+        g_sink = g_sink + results.back().results.count();
+      }) / static_cast<double>(num_lines);
+    if (num_threads == 1) {
+      single = ns;
+    }
+    std::ostringstream speedup;
+    speedup << std::fixed << std::setprecision(2) << single / ns;
+    report("parse_batch() " + std::to_string(num_threads) + " threads (" +
+             speedup.str() + "x, per line)",
+           ns);
+
+    argagg::batch_pool pool(num_threads);
+    report("parse_batch() " + std::to_string(num_threads) +
+             " threads, shared pool (per line)",
+           ns_per_call(runs, [&]() {
+             const auto results = argagg::parse_batch(
+               pool, compiled, lines.begin(), lines.end());
+             g_sink = g_sink + results.back().results.count();
+           }) / static_cast<double>(num_lines));
+    if (num_threads == num_cores) {
+      break;
+    }
+  }
+}
+
+
+static argagg::compiled_parser make_typical_compiled_parser()
+{
+  return typical_parser().compile();
+}
+
+
+// Compares building the parsers of 40 subcommands up front and routing on
+// the first positional argument by hand with subcommand_parser, which only
+// builds the selected subcommand's parser.
+static void bench_subcommands(std::size_t iterations)
+{
+  const std::size_t num_commands = 40;
+  std::vector<std::string> names;
+  for (std::size_t i = 0; i < num_commands; ++i) {
+    names.push_back("command" + std::to_string(i));
+  }
+  std::vector<const char*> argv = typical_argv();
+  argv.insert(argv.begin() + 1, names.back().c_str());
+  const int argc = static_cast<int>(argv.size());
+
+  report("build all parsers, parse one", ns_per_call(iterations, [&]() {
+      std::vector<argagg::compiled_parser> parsers;
+      for (std::size_t i = 0; i < num_commands; ++i) {
+        parsers.push_back(typical_parser().compile());
+      }
+      g_sink = g_sink + parsers.back().parse(argc - 1, &argv[1]).count();
+    }));
+
+  report("subcommand_parser::parse()", ns_per_call(iterations, [&]() {
+      argagg::subcommand_parser cli {argagg::compiled_parser {{}}, {}};
+      for (const auto& name : names) {
+        cli.commands.push_back(
+          {name.c_str(), "a subcommand", make_typical_compiled_parser});
+      }
+      g_sink = g_sink + cli.parse(argc, &(argv.front())).results.count();
+    }));
+}
+
+
+// A launcher command line, "launch -v -j 8 -- prog" and 200 arguments for
+// prog. Compares collecting the trailing arguments as positional arguments
+// and rebuilding an argv array for execv() from them with stopping at the
+// first positional argument and using the remainder as is.
+static void bench_remainder(std::size_t iterations)
+{
+  const argagg::compiled_parser parser = typical_parser().compile();
+  std::vector<const char*> argv {"launch", "-v", "-j", "8", "--", "prog"};
+  for (std::size_t i = 0; i < 200; ++i) {
+    argv.push_back("--child-flag");
+  }
+  const int argc = static_cast<int>(argv.size());
+  argv.push_back(nullptr);
+
+  report("parse() and rebuild argv", ns_per_call(iterations, [&]() {
+      const auto args = parser.parse(argc, &(argv.front()));
+      std::vector<const char*> child(args.pos.begin(), args.pos.end());
+      child.push_back(nullptr);
+      g_sink = g_sink + child.size();
+    }));
+
+  argagg::parser_results args;
+  report("parse_into() until first positional", ns_per_call(
+    iterations, [&]() {
+      parser.parse_into(argc, &(argv.front()), args,
+                        argagg::stop_at::first_positional);
+      g_sink = g_sink + args.remainder.size;
+    }));
+}
+
+
+// A compiler wrapper's command line of 5000 arguments, mostly unknown
+// options and inputs for the compiler with a few of typical_parser()'s
+// options in between. Compares the two pass approach of finding the unknown
+// options with try_parse_all() and parsing the remaining arguments again
+// with parsing once while forwarding.
+static void bench_forwarding(std::size_t iterations)
+{
+  const argagg::compiled_parser parser = typical_parser().compile();
+  std::vector<std::string> storage;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    storage.push_back("-Wwarning" + std::to_string(i));
+    storage.push_back("-I/usr/include/dir" + std::to_string(i));
+    storage.push_back("--param=value" + std::to_string(i));
+    storage.push_back("file" + std::to_string(i) + ".c");
+    storage.push_back(i % 100 == 0 ? "-v" : "-O2");
+  }
+  std::vector<const char*> argv {"cc-wrap", "-j", "8"};
+  for (const auto& arg : storage) {
+    argv.push_back(arg.c_str());
+  }
+  const int argc = static_cast<int>(argv.size());
+
+  std::vector<argagg::parse_error> errors;
+  std::vector<bool> unknown;
+  std::vector<const char*> own;
+  std::vector<const char*> forwarded;
+  argagg::parser_results args;
+  report("try_parse_all(), split, parse_into()", ns_per_call(
+    iterations, [&]() {
+      parser.try_parse_all(argc, &(argv.front()), args, errors);
+      unknown.assign(argv.size(), false);
+      for (const auto& error : errors) {
+        unknown[error.argv_index] = true;
+      }
+      own.clear();
+      forwarded.assign(1, "cc");
+      for (std::size_t i = 0; i < argv.size(); ++i) {
+        (unknown[i] ? forwarded : own).push_back(argv[i]);
+      }
+      forwarded.push_back(nullptr);
+      parser.parse_into(static_cast<int>(own.size()), &(own.front()), args);
+      g_sink = g_sink + forwarded.size() + args.count();
+    }));
+
+  report("parse_into() forwarding", ns_per_call(iterations, [&]() {
+      forwarded.assign(1, "cc");
+      parser.parse_into(argc, &(argv.front()), args, forwarded);
+      g_sink = g_sink + forwarded.size() + args.count();
+    }));
+}
+
+// A gcc-like command line of 5000 arguments matched against 32 prefix flags.
+// Compares finding the longest prefix by comparing every prefix flag in turn
+// with the prefix flag trie, as part of a whole parse. Reported times are per
+// argument.
+static void bench_prefix_flags(std::size_t iterations)
+{
+  const char* prefixes[] = {
+    "-Wl,", "-Wa,", "-Wp,", "-Werror=", "-Wno-error=", "-Wno-", "-W",
+    "-fno-", "-f", "-march=", "-mtune=", "-mcpu=", "-mno-", "-m", "-std=",
+    "--std=", "-O", "-g", "-D", "-U", "-I", "-L", "-l", "-isystem",
+    "-iquote", "-idirafter", "-include", "-imacros", "--param=",
+    "--sysroot=", "-MF", "-MT",
+  };
+  argagg::parser parser;
+  for (const char* prefix : prefixes) {
+    parser.definitions.push_back(
+      {prefix, {std::string(prefix) + "*"}, "a prefix flag", 1});
+  }
+  const argagg::compiled_parser compiled = parser.compile();
+
+  std::vector<std::string> storage;
+  for (std::size_t i = 0; storage.size() < 5000; ++i) {
+    storage.push_back("-Wl,-rpath,/opt/lib" + std::to_string(i));
+    storage.push_back("-Wno-unused-variable");
+    storage.push_back("-fno-strict-aliasing");
+    storage.push_back("-I/usr/include/dir" + std::to_string(i));
+    storage.push_back("-DNAME" + std::to_string(i) + "=1");
+    storage.push_back("-march=native");
+    storage.push_back("--param=max-inline-insns=" + std::to_string(i));
+    storage.push_back("file" + std::to_string(i) + ".c");
+  }
+  std::vector<const char*> argv {"gcc"};
+  for (const auto& arg : storage) {
+    argv.push_back(arg.c_str());
+  }
+  const int argc = static_cast<int>(argv.size());
+  const std::size_t num_args = storage.size();
+  iterations = std::max<std::size_t>(iterations / num_args, 1);
+
+  std::vector<std::size_t> prefix_lengths;
+  for (const char* prefix : prefixes) {
+    prefix_lengths.push_back(std::strlen(prefix));
+  }
+  report("compare every prefix flag", ns_per_call(iterations, [&]() {
+      for (std::size_t i = 1; i < argv.size(); ++i) {
+        std::size_t longest = 0;
+        for (std::size_t j = 0; j < prefix_lengths.size(); ++j) {
+          const std::size_t len = prefix_lengths[j];
+          if (len > longest && std::strncmp(argv[i], prefixes[j], len) == 0) {
+            longest = len;
+          }
+        }
+        g_sink = g_sink + longest;
+      }
+    }) / static_cast<double>(num_args));
+
+  argagg::parser_results args;
+  report("parse_into() with the prefix trie", ns_per_call(iterations, [&]() {
+      compiled.parse_into(argc, &(argv.front()), args);
+      g_sink = g_sink + args.count();
+    }) / static_cast<double>(num_args));
+}
+
+
+// Compares resolving abbreviated long flags by scanning every long flag with
+// the abbreviation trie, as part of a whole parse. Reported times are per
+// argument.
+static void bench_abbreviations(std::size_t iterations)
+{
+  argagg::parser parser;
+  std::vector<std::string> flags;
+  for (std::size_t i = 0; i < 64; ++i) {
+    flags.push_back("--option-" + std::to_string(i) + "-name");
+    parser.definitions.push_back(
+      {flags.back(), {flags.back()}, "a long flag", 1});
+  }
+  const argagg::compiled_parser compiled =
+    parser.compile(argagg::long_flag_abbreviations::allowed);
+
+  std::vector<std::string> storage;
+  for (std::size_t i = 0; storage.size() < 5000; ++i) {
+    storage.push_back("--option-" + std::to_string(i % 64) + "-n");
+    storage.push_back("value" + std::to_string(i));
+  }
+  std::vector<const char*> argv {"test"};
+  for (const auto& arg : storage) {
+    argv.push_back(arg.c_str());
+  }
+  const int argc = static_cast<int>(argv.size());
+  const std::size_t num_args = storage.size();
+  iterations = std::max<std::size_t>(iterations / num_args, 1);
+
+  report("scan every long flag", ns_per_call(iterations, [&]() {
+      for (std::size_t i = 1; i < argv.size(); i += 2) {
+        const std::size_t len = std::strlen(argv[i]);
+        std::size_t matches = 0;
+        for (const auto& flag : flags) {
+          if (flag.compare(0, len, argv[i], len) == 0) {
+            ++matches;
+          }
+        }
+        g_sink = g_sink + matches;
+      }
+    }) / static_cast<double>(num_args));
+
+  argagg::parser_results args;
+  report("parse_into() with the abbreviation trie",
+    ns_per_call(iterations, [&]() {
+      compiled.parse_into(argc, &(argv.front()), args);
+      g_sink = g_sink + args.count();
+    }) / static_cast<double>(num_args));
+}
+
+
+// 40 programs for bench_multicall(), which needs them at compile time.
+static constexpr argagg::subcommand multicall_programs[] = {
+#define ARGAGG_BENCH_PROGRAM(n) \
+    {"program" #n, "a program", make_typical_compiled_parser}
+    ARGAGG_BENCH_PROGRAM(0), ARGAGG_BENCH_PROGRAM(1), ARGAGG_BENCH_PROGRAM(2),
+    ARGAGG_BENCH_PROGRAM(3), ARGAGG_BENCH_PROGRAM(4), ARGAGG_BENCH_PROGRAM(5),
+    ARGAGG_BENCH_PROGRAM(6), ARGAGG_BENCH_PROGRAM(7), ARGAGG_BENCH_PROGRAM(8),
+    ARGAGG_BENCH_PROGRAM(9), ARGAGG_BENCH_PROGRAM(10), ARGAGG_BENCH_PROGRAM(11),
+    ARGAGG_BENCH_PROGRAM(12), ARGAGG_BENCH_PROGRAM(13),
+    ARGAGG_BENCH_PROGRAM(14), ARGAGG_BENCH_PROGRAM(15),
+    ARGAGG_BENCH_PROGRAM(16), ARGAGG_BENCH_PROGRAM(17),
+    ARGAGG_BENCH_PROGRAM(18), ARGAGG_BENCH_PROGRAM(19),
+    ARGAGG_BENCH_PROGRAM(20), ARGAGG_BENCH_PROGRAM(21),
+    ARGAGG_BENCH_PROGRAM(22), ARGAGG_BENCH_PROGRAM(23),
+    ARGAGG_BENCH_PROGRAM(24), ARGAGG_BENCH_PROGRAM(25),
+    ARGAGG_BENCH_PROGRAM(26), ARGAGG_BENCH_PROGRAM(27),
+    ARGAGG_BENCH_PROGRAM(28), ARGAGG_BENCH_PROGRAM(29),
+    ARGAGG_BENCH_PROGRAM(30), ARGAGG_BENCH_PROGRAM(31),
+    ARGAGG_BENCH_PROGRAM(32), ARGAGG_BENCH_PROGRAM(33),
+    ARGAGG_BENCH_PROGRAM(34), ARGAGG_BENCH_PROGRAM(35),
+    ARGAGG_BENCH_PROGRAM(36), ARGAGG_BENCH_PROGRAM(37),
+    ARGAGG_BENCH_PROGRAM(38), ARGAGG_BENCH_PROGRAM(39),
+#undef ARGAGG_BENCH_PROGRAM
+  };
+
+
+// Compares finding the program named by argv[0] among 40 by comparing names
+// in turn with the multicall_registry's perfect hash lookup, and reports the
+// whole dispatch including building the selected parser.
+static void bench_multicall(std::size_t iterations)
+{
+  static constexpr auto registry =
+    argagg::make_multicall_registry(multicall_programs);
+  std::vector<const char*> argv = typical_argv();
+  argv[0] = "/usr/local/bin/program39";
+  const int argc = static_cast<int>(argv.size());
+
+  report("find program by comparing names", ns_per_call(iterations, [&]() {
+      const char* name = argagg::program_basename(argv[0]);
+      for (const auto& program : multicall_programs) {
+        if (std::strcmp(program.name, name) == 0) {
+          g_sink = g_sink + static_cast<std::size_t>(program.name[0]);
+          break;
+        }
+      }
+    }));
+
+  report("multicall_registry::find()", ns_per_call(iterations, [&]() {
+      const auto program =
+        registry.find(argagg::program_basename(argv[0]));
+      g_sink = g_sink + static_cast<std::size_t>(program->name[0]);
+    }));
+
+  report("multicall_registry::parse()", ns_per_call(iterations, [&]() {
+      g_sink = g_sink + registry.parse(argc, &(argv.front())).results.count();
+    }));
+}
+
+// Size of the response file generated by bench_response_file(), in MiB.
+static std::size_t g_response_file_mib = 1024;
+
+
+// Generates a large response file of file paths and flags and expands and
+// parses it once, compared with reading it into a copy of every argument as
+// we used to. Reported times are per argument.
+static void bench_response_file(std::size_t)
+{
+  const std::string path = "argagg_benchmark_response_file.txt";
+  const std::size_t target_size = g_response_file_mib << 20;
+  std::size_t num_args = 0;
+  {
+    std::ofstream out(path, std::ios::binary);
+    std::string chunk;
+    std::size_t written = 0;
+    while (written < target_size) {
+      chunk.clear();
+      for (std::size_t i = 0; i < 1024; ++i, ++num_args) {
+        if (num_args % 8 == 0) {
+          chunk += "-I/usr/local/include/dir" + std::to_string(num_args);
+        } else {
+          chunk += "src/module/subdirectory/file" + std::to_string(num_args) +
+                   ".cpp";
+        }
+        chunk += '\n';
+      }
+      out << chunk;
+      written += chunk.size();
+    }
+  }
+
+  const argagg::compiled_parser compiled = typical_parser().compile();
+  std::vector<const char*> argv {"tool", "-v", nullptr};
+  const std::string response_arg = "@" + path;
+  argv[2] = response_arg.c_str();
+  const double per_arg = 1.0 / static_cast<double>(num_args);
+
+  report("copy into argv (" + std::to_string(g_response_file_mib) +
+           " MiB, per arg)",
+         per_arg * ns_per_call(1, [&]() {
+      std::ifstream in(path, std::ios::binary);
+      std::vector<std::string> storage;
+      std::string arg;
+      while (in >> arg) {
+        storage.push_back(arg);
+      }
+      std::vector<const char*> copied {"tool", "-v"};
+      for (const auto& a : storage) {
+        copied.push_back(a.c_str());
+      }
+      g_sink = g_sink + compiled.parse(
+        static_cast<int>(copied.size()), &(copied.front())).count();
+    }));
+
+  report("response_files (" + std::to_string(g_response_file_mib) +
+           " MiB, per arg)",
+         per_arg * ns_per_call(1, [&]() {
+      const argagg::response_files args(
+        static_cast<int>(argv.size()), &(argv.front()));
+      g_sink = g_sink + compiled.parse(args.begin(), args.end()).count();
+    }));
+
+  std::remove(path.c_str());
+}
+
+
+
+static constexpr argagg::static_definition typical_static_definitions[] = {
+    {"help", {"-h", "--help"}, "shows this help message", 0},
+    {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+    {"quiet", {"-q", "--quiet"}, "be quiet", 0},
+    {"jobs", {"-j", "--jobs"}, "number of jobs", 1},
+    {"output", {"-o", "--output"}, "output file", 1},
+    {"include", {"-I", "--include"}, "include path", 1},
+    {"define", {"-D", "--define"}, "preprocessor definition", 1},
+    {"config", {"-c", "--config"}, "configuration file", 1},
+    {"dry-run", {"-n", "--dry-run"}, "don't do anything", 0},
+    {"timeout", {"-t", "--timeout"}, "timeout in seconds", 1},
+  };
+
+
+// Compares what a short-lived program pays from startup to parsed results.
+static void bench_static_parser(std::size_t iterations)
+{
+  static constexpr auto static_parser =
+    argagg::make_static_parser(typical_static_definitions);
+  std::vector<const char*> argv = typical_argv();
+  const int argc = static_cast<int>(argv.size());
+
+  report("build parser + parser::parse()", ns_per_call(iterations, [&]() {
+      const argagg::parser parser = typical_parser();
+      g_sink = g_sink + parser.parse(argc, &(argv.front())).count();
+    }));
+
+  report("build parser + compile() + parse()", ns_per_call(iterations, [&]() {
+      const argagg::compiled_parser compiled = typical_parser().compile();
+      g_sink = g_sink + compiled.parse(argc, &(argv.front())).count();
+    }));
+
+  report("static_parser::parse()", ns_per_call(iterations, [&]() {
+      g_sink = g_sink + static_parser.parse(argc, &(argv.front())).count();
+    }));
+}
+
+
+int main(int argc, const char** argv)
+{
+  using benchmark_fn = void (*)(std::size_t);
+  const std::vector<std::pair<std::string, benchmark_fn>> benchmarks {
+      {"compiled_parser", bench_compiled_parser},
+      {"parse_errors", bench_parse_errors},
+      {"option_lookup", bench_option_lookup},
+      {"long_flag_lookup", bench_long_flag_lookup},
+      {"static_parser", bench_static_parser},
+      {"simd_lex", bench_simd_lex},
+      {"char_class", bench_char_class},
+      {"many_definitions", bench_many_definitions},
+      {"subcommands", bench_subcommands},
+      {"multicall", bench_multicall},
+      {"remainder", bench_remainder},
+      {"forwarding", bench_forwarding},
+      {"prefix_flags", bench_prefix_flags},
+      {"abbreviations", bench_abbreviations},
+      {"command_line", bench_command_line},
+      {"parse_batch", bench_parse_batch},
+      {"response_file", bench_response_file},
+    };
+
+  argagg::parser argparser {{
+      {"help", {"-h", "--help"}, "shows this help message", 0},
+      {"iterations", {"-n", "--iterations"},
+        "number of iterations per measurement (default: 100000)", 1},
+      {"response-file-size", {"--response-file-size"},
+        "size of the response_file benchmark's file in MiB (default: 1024)",
+        1},
+    }};
+
+  argagg::parser_results args;
+  try {
+    args = argparser.parse(argc, argv);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  if (args["help"]) {
+    std::cerr << "Usage: " << argv[0] << " [options] [BENCHMARK...]\n"
+              << argparser << "\nBenchmarks:\n";
+    for (const auto& benchmark : benchmarks) {
+      std::cerr << "    " << benchmark.first << '\n';
+    }
+    return EXIT_SUCCESS;
+  }
+
+  const auto iterations = args["iterations"].as<std::size_t>(100000);
+  g_response_file_mib =
+    args["response-file-size"].as<std::size_t>(g_response_file_mib);
+
+  for (const auto& benchmark : benchmarks) {
+    if (args.count() > 0) {
+      const auto selected = args.all_as<std::string>();
+      if (std::find(selected.begin(), selected.end(), benchmark.first) ==
+          selected.end()) {
+        continue;
+      }
+    }
+    std::cout << benchmark.first << ":\n";
+    benchmark.second(iterations);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -3,8 +3,16 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
 #include <vector>
 
 
@@ -29,6 +37,203 @@ TEST_CASE("cmd_line_arg_is_option_flag")
 }
 
 
+TEST_CASE("lex_arg")
+{
+  SUBCASE("positional") {
+    const auto token = argagg::lex_arg("foo.txt");
+    CHECK(token.kind == argagg::arg_kind::positional);
+    CHECK(token.len == 7);
+    CHECK(argagg::lex_arg("-").kind == argagg::arg_kind::positional);
+    CHECK(argagg::lex_arg("---a").kind == argagg::arg_kind::positional);
+    CHECK(argagg::lex_arg("--a@b=c").kind == argagg::arg_kind::positional);
+    CHECK(argagg::lex_arg("--a@b=c").len == 7);
+  }
+  SUBCASE("terminator") {
+    const auto token = argagg::lex_arg("--");
+    CHECK(token.kind == argagg::arg_kind::terminator);
+    CHECK(token.len == 2);
+  }
+  SUBCASE("short group") {
+    const auto token = argagg::lex_arg("-I/usr/include");
+    CHECK(token.kind == argagg::arg_kind::short_group);
+    CHECK(token.len == 14);
+    CHECK(std::string(token.name, token.name_len) == "I/usr/include");
+    CHECK(token.value == nullptr);
+  }
+  SUBCASE("long flag") {
+    const auto token = argagg::lex_arg("--foo-bar");
+    CHECK(token.kind == argagg::arg_kind::long_flag);
+    CHECK(token.len == 9);
+    CHECK(std::string(token.name, token.name_len) == "--foo-bar");
+    CHECK(token.value == nullptr);
+  }
+  SUBCASE("long flag with argument") {
+    const auto token = argagg::lex_arg("--output=a=b");
+    CHECK(token.kind == argagg::arg_kind::long_flag);
+    CHECK(token.len == 12);
+    CHECK(std::string(token.name, token.name_len) == "--output");
+    CHECK(std::string(token.value) == "a=b");
+    CHECK(token.value_len == 3);
+  }
+}
+
+
+TEST_CASE("lex_arg with length")
+{
+  const std::vector<std::string> args {
+    "foo.txt", "-", "", "---a", "--a@b=c", "--", "-I/usr/include",
+    "--foo-bar", "--output=a=b", "--o=", "-v"};
+  for (const auto& arg : args) {
+    const auto expected = argagg::lex_arg(arg.c_str());
+    const auto token = argagg::lex_arg(arg.c_str(), arg.size());
+    CHECK(token.kind == expected.kind);
+    CHECK(token.len == expected.len);
+    CHECK(token.name == expected.name);
+    CHECK(token.name_len == expected.name_len);
+    CHECK(token.value == expected.value);
+    CHECK(token.value_len == expected.value_len);
+  }
+
+  SUBCASE("embedded null") {
+    const std::string arg("--foo\0bar", 9);
+    const auto token = argagg::lex_arg(arg.c_str(), arg.size());
+    CHECK(token.kind == argagg::arg_kind::positional);
+    CHECK(token.len == 9);
+  }
+
+  SUBCASE("views that aren't null terminated") {
+    // Every prefix of a long flag that is longer than a few vector widths.
+    // Each is copied into a buffer of exactly its length so reading past the
+    // view is caught by AddressSanitizer, and is followed in the text by more
+    // flag characters so that it changes the result.
+    const std::string text =
+      "--abcdefghijklmnopqrstuvwxyz-0123456789-ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+      "=value-abcdefghijklmnopqrstuvwxyz";
+    const std::size_t equal_sign = text.find('=');
+    for (std::size_t len = 0; len <= text.size(); ++len) {
+      std::unique_ptr<char[]> view(new char[len + 1]);
+      std::memcpy(view.get() + 1, text.data(), len);
+      const char* s = view.get() + 1;
+      const auto token = argagg::lex_arg(s, len);
+      CHECK(token.len == len);
+      if (len < 2) {
+        CHECK(token.kind == argagg::arg_kind::positional);
+      } else if (len == 2) {
+        CHECK(token.kind == argagg::arg_kind::terminator);
+      } else if (len <= equal_sign) {
+        CHECK(token.kind == argagg::arg_kind::long_flag);
+        CHECK(token.name_len == len);
+        CHECK(token.value == nullptr);
+      } else {
+        CHECK(token.kind == argagg::arg_kind::long_flag);
+        CHECK(token.name_len == equal_sign);
+        CHECK(token.value == s + equal_sign + 1);
+        CHECK(token.value_len == len - equal_sign - 1);
+      }
+    }
+
+    const char* buffer = "--abcd=x";
+    const auto token = argagg::lex_arg(buffer, 4);
+    CHECK(token.kind == argagg::arg_kind::long_flag);
+    CHECK(token.len == 4);
+    CHECK(token.name_len == 4);
+    CHECK(token.value == nullptr);
+    CHECK(token.value_len == 0);
+  }
+}
+
+
+TEST_CASE("lex_args")
+{
+  // Long flags of every length up to a few vector widths, each placed at
+  // every alignment, with and without a bad character and an equal sign.
+  // (len == bad means there is no bad character.)
+  std::vector<std::string> storage;
+  for (std::size_t len = 1; len < 80; ++len) {
+    for (const std::size_t bad : {std::size_t{0}, len / 2, len - 1, len}) {
+      std::string name(len, 'a');
+      if (bad < len) {
+        name[bad] = (bad % 2 == 0) ? '@' : static_cast<char>(0xe9);
+      }
+      storage.push_back("--" + name);
+      storage.push_back("--" + name + "=value-" + name);
+    }
+  }
+  storage.push_back("-");
+  storage.push_back("--");
+  storage.push_back("-abc");
+  storage.push_back("positional");
+  storage.push_back("");
+
+  std::vector<char> buffer;
+  std::vector<std::size_t> offsets;
+  for (const auto& s : storage) {
+    for (std::size_t pad = 0; pad < 32; ++pad) {
+      buffer.insert(buffer.end(), pad, 'x');
+      offsets.push_back(buffer.size());
+      buffer.insert(buffer.end(), s.begin(), s.end());
+      buffer.push_back('\0');
+    }
+  }
+  std::vector<const char*> args;
+  for (const auto offset : offsets) {
+    args.push_back(buffer.data() + offset);
+  }
+
+  std::vector<argagg::simd_level> levels {argagg::simd_level::scalar};
+  if (argagg::best_simd_level() != argagg::simd_level::scalar) {
+    levels.push_back(argagg::simd_level::sse2);
+  }
+  if (argagg::best_simd_level() == argagg::simd_level::avx2) {
+    levels.push_back(argagg::simd_level::avx2);
+  }
+
+  std::vector<argagg::arg_token> reference(args.size());
+  argagg::lex_args(
+    args.data(), args.data() + args.size(), reference.data(),
+    argagg::simd_level::scalar);
+
+  for (const auto level : levels) {
+    std::vector<argagg::arg_token> tokens(args.size());
+    argagg::lex_args(
+      args.data(), args.data() + args.size(), tokens.data(), level);
+    for (std::size_t i = 0; i < args.size(); ++i) {
+      const argagg::arg_token& expected = reference[i];
+      CHECK(tokens[i].kind == expected.kind);
+      CHECK(tokens[i].len == expected.len);
+      CHECK(tokens[i].len == std::strlen(args[i]));
+      CHECK(tokens[i].name == expected.name);
+      CHECK(tokens[i].name_len == expected.name_len);
+      CHECK(tokens[i].value == expected.value);
+      CHECK(tokens[i].value_len == expected.value_len);
+    }
+  }
+}
+
+
+TEST_CASE("char_class")
+{
+  static_assert(argagg::char_is_alnum('a'), "");
+  static_assert(!argagg::char_is_alnum('-'), "");
+  static_assert(argagg::char_class('-') == argagg::char_class_hyphen, "");
+  static_assert(argagg::char_class('=') == argagg::char_class_equal_sign, "");
+  for (int i = 0; i < 256; ++i) {
+    const char c = static_cast<char>(i);
+    const bool alnum = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                       (c >= 'A' && c <= 'Z');
+    CHECK(argagg::char_is_alnum(c) == alnum);
+    CHECK(((argagg::char_class(c) & argagg::char_class_hyphen) != 0) ==
+          (c == '-'));
+    CHECK(((argagg::char_class(c) & argagg::char_class_equal_sign) != 0) ==
+          (c == '='));
+  }
+  // Bytes outside of ASCII are never alpha-numeric, whatever the locale.
+  CHECK(argagg::is_valid_flag_definition("--caf\xe9") == false);
+  CHECK(argagg::cmd_line_arg_is_option_flag("--caf\xe9") == false);
+  CHECK(argagg::cmd_line_arg_is_option_flag("-\xe9") == false);
+}
+
+
 TEST_CASE("is_valid_flag_definition")
 {
   CHECK(argagg::is_valid_flag_definition("") == false);
@@ -60,6 +265,71 @@ TEST_CASE("flag_is_short")
 }
 
 
+TEST_CASE("long_flag_map")
+{
+  std::vector<argagg::definition> definitions;
+  definitions.push_back({"a", {"--a"}, "a", 0});
+  definitions.push_back({"b", {"--b"}, "b", 0});
+  const argagg::definition* a = &definitions[0];
+  const argagg::definition* b = &definitions[1];
+  SUBCASE("empty") {
+    argagg::long_flag_map map {};
+    map.build({});
+    CHECK(map.size() == 0);
+    CHECK(map.find("--a", 3) == nullptr);
+  }
+  SUBCASE("many flags") {
+    std::vector<std::string> flags;
+    std::vector<argagg::long_flag_entry> entries;
+    for (int i = 0; i < 1000; ++i) {
+      flags.push_back("--flag-" + std::to_string(i));
+      entries.push_back({flags.back(), (i % 2) ? a : b});
+    }
+    argagg::long_flag_map map {};
+    map.build(entries);
+    CHECK(map.size() == 1000);
+    for (int i = 0; i < 1000; ++i) {
+      const auto& flag = flags[static_cast<std::size_t>(i)];
+      CHECK(map.find(flag.data(), flag.size()) == ((i % 2) ? a : b));
+    }
+    CHECK(map.find("--flag-1000", 11) == nullptr);
+    CHECK(map.find("--flag-1=foo", 8) == a);
+    CHECK(map.find("--flag-1", 7) == nullptr);
+    CHECK(map.find("", 0) == nullptr);
+  }
+  SUBCASE("sorted") {
+    std::vector<std::string> flags;
+    std::vector<argagg::long_flag_entry> entries;
+    for (int i = 0; i < 1000; ++i) {
+      flags.push_back("--flag-" + std::to_string(i));
+      entries.push_back({flags.back(), (i % 2) ? a : b});
+    }
+    std::sort(entries.begin(), entries.end(),
+      [](const argagg::long_flag_entry& x, const argagg::long_flag_entry& y) {
+        return x.flag < y.flag;
+      });
+    argagg::long_flag_map map {};
+    map.build_sorted(entries);
+    CHECK(map.size() == 1000);
+    for (int i = 0; i < 1000; ++i) {
+      const auto& flag = flags[static_cast<std::size_t>(i)];
+      CHECK(map.find(flag.data(), flag.size()) == ((i % 2) ? a : b));
+    }
+    CHECK(map.find("--flag-1000", 11) == nullptr);
+    CHECK(map.find("--flag-1=foo", 8) == a);
+    CHECK(map.find("--flag-1", 7) == nullptr);
+    CHECK(map.find("--flag-99999", 12) == nullptr);
+    CHECK(map.find("", 0) == nullptr);
+  }
+  SUBCASE("duplicate flags") {
+    argagg::long_flag_map map {};
+    CHECK_THROWS_AS({
+      map.build({{"--a", a}, {"--a", b}});
+    }, const std::logic_error&);
+  }
+}
+
+
 TEST_CASE("intro example")
 {
   argagg::parser argparser {{
@@ -203,6 +473,7 @@ TEST_CASE("no definitions")
     CHECK(::std::string(args.pos[0]) == "foo");
     CHECK(::std::string(args.pos[1]) == "bar");
     CHECK(::std::string(args.pos[2]) == "baz");
+    CHECK(args.pos_lengths == std::vector<std::size_t>({3, 3, 3}));
   }
   SUBCASE("with flags") {
     std::vector<const char*> argv {
@@ -314,6 +585,15 @@ TEST_CASE("invalid definitions")
       argagg::parser_results args = parser.parse(argv.size(), &(argv.front()));
     }, const argagg::invalid_flag&);
   }
+  SUBCASE("duplicate names") {
+    argagg::parser parser {{
+        {"bad", {"--bad"}, "bad", 0},
+        {"bad", {"--bad2"}, "bad2", 0},
+      }};
+    CHECK_THROWS_AS({
+      argagg::parser_results args = parser.parse(argv.size(), &(argv.front()));
+    }, const argagg::invalid_flag&);
+  }
 }
 
 
@@ -602,6 +882,8 @@ TEST_CASE("flag stop")
     CHECK(args.as<std::string>(4) == "dog");
     CHECK(args.as<std::string>(5) == "-d");
     CHECK(args.as<std::string>(6) == "cat");
+    CHECK(args.pos_lengths ==
+          std::vector<std::size_t>({3, 9, 3, 7, 3, 2, 3}));
   }
   SUBCASE("flag stop consumed as argument for option") {
     std::vector<const char*> argv {
@@ -846,6 +1128,1462 @@ TEST_CASE("gcc example")
 }
 
 
+TEST_CASE("gcc prefix flags")
+{
+  argagg::parser parser {{
+      {"verbose", {"-v"}, "be verbose", 0},
+      {"version", {"--version"}, "print version", 0},
+      {"warning", {"-W"}, "enable a warning", 1},
+      {"werror", {"-Werror=*"}, "make a warning an error", 1},
+      {"no warning", {"-Wno-*"}, "disable a warning", 1},
+      {"no werror", {"-Wno-error=*"}, "don't make a warning an error", 1},
+      {"linker", {"-Wl,*"}, "pass an option to the linker", 1},
+      {"feature", {"-f"}, "enable a feature", 1},
+      {"no feature", {"-fno-*"}, "disable a feature", 1},
+      {"standard", {"-std=*", "--std=*"}, "language standard", 1},
+      {"param", {"--param"}, "set a parameter", 1},
+      {"define", {"-D"}, "define a macro", 1},
+    }};
+
+  SUBCASE("longest prefix wins") {
+    std::vector<const char*> argv {
+      "gcc", "-Wl,-rpath,/opt/lib", "-Wall", "-Werror=format", "-Werror",
+      "-Wno-unused", "-Wno-error=shadow", "-fno-strict-aliasing", "-fPIC",
+      "-std=c11", "--std=c++11", "-DNAME=VAL", "-Wl,", "test.c"};
+    const auto args = parser.parse(argv.size(), &(argv.front()));
+    CHECK(args["linker"].count() == 2);
+    CHECK(args["linker"][0].as<std::string>() == "-rpath,/opt/lib");
+    CHECK(args["linker"][1].as<std::string>() == "");
+    CHECK(args["warning"].count() == 2);
+    CHECK(args["warning"][0].as<std::string>() == "all");
+    CHECK(args["warning"][1].as<std::string>() == "error");
+    CHECK(args["werror"].as<std::string>() == "format");
+    CHECK(args["no warning"].as<std::string>() == "unused");
+    CHECK(args["no werror"].as<std::string>() == "shadow");
+    CHECK(args["no feature"].as<std::string>() == "strict-aliasing");
+    CHECK(args["feature"].as<std::string>() == "PIC");
+    CHECK(args["standard"].count() == 2);
+    CHECK(args["standard"][0].as<std::string>() == "c11");
+    CHECK(args["standard"][1].as<std::string>() == "c++11");
+    CHECK(args["define"].as<std::string>() == "NAME=VAL");
+    REQUIRE(args.count() == 1);
+    CHECK(args.as<std::string>(0) == "test.c");
+  }
+
+  SUBCASE("exact flags and option arguments") {
+    std::vector<const char*> argv {
+      "gcc", "--param", "-Wl,x", "--version", "-v", "-D", "-fno-x", "--",
+      "-Wl,y"};
+    const auto args = parser.parse(argv.size(), &(argv.front()));
+    CHECK(args["param"].as<std::string>() == "-Wl,x");
+    CHECK(args["version"].count() == 1);
+    CHECK(args["verbose"].count() == 1);
+    CHECK(args["define"].as<std::string>() == "-fno-x");
+    CHECK_FALSE(args.has_option("linker"));
+    CHECK_FALSE(args.has_option("no feature"));
+    REQUIRE(args.count() == 1);
+    CHECK(args.as<std::string>(0) == "-Wl,y");
+  }
+
+  SUBCASE("unknown flags") {
+    std::vector<const char*> argv {"gcc", "--stdlib=libc++"};
+    CHECK_THROWS_AS({
+      parser.parse(argv.size(), &(argv.front()));
+    }, const argagg::unexpected_option_error&);
+  }
+
+  SUBCASE("invalid definitions") {
+    const std::vector<argagg::parser> invalid {
+      argagg::parser {{{"a", {"-Wl,*"}, "", 0}}},
+      argagg::parser {{{"a", {"-*"}, "", 1}}},
+      argagg::parser {{{"a", {"*"}, "", 1}}},
+      argagg::parser {{{"a", {"--*"}, "", 1}}},
+      argagg::parser {{{"a", {"-a*b*"}, "", 1}}},
+      argagg::parser {{{"a", {"-Wl,*"}, "", 1}, {"b", {"-Wl,*"}, "", 1}}},
+      argagg::parser {{{"x", {"--foo.*"}, "", 1}}},
+      argagg::parser {{{"x", {"--foo.bar=*"}, "", 1}}},
+    };
+    for (const auto& p : invalid) {
+      CHECK_THROWS_AS(p.compile(), const argagg::invalid_flag&);
+    }
+    const argagg::parser valid {{
+        {"a", {"--a*"}, "", 1},
+        {"b", {"--b-c=d.e,*"}, "", 1},
+        {"c", {"-c.d*"}, "", 1},
+      }};
+    CHECK_NOTHROW(valid.compile());
+    std::vector<const char*> argv {
+      "gcc", "--b-c=d.e,f", "-c.dx", "--foo.bar"};
+    const auto args = valid.parse(argv.size(), &(argv.front()));
+    CHECK(args["b"].as<std::string>() == "f");
+    CHECK(args["c"].as<std::string>() == "x");
+    REQUIRE(args.count() == 1);
+    CHECK(args.as<std::string>(0) == "--foo.bar");
+  }
+}
+
+
+TEST_CASE("long flag abbreviations")
+{
+  const argagg::parser parser {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"version", {"--version"}, "print version", 0},
+      {"color", {"--color", "--colour"}, "colorize output", 1},
+      {"out", {"--out"}, "output file", 1},
+      {"output-format", {"--output-format"}, "output format", 1},
+      {"define", {"--define=*"}, "define a macro", 1},
+      {"debug", {"--debug"}, "debug level", 1},
+    }};
+  const argagg::compiled_parser compiled =
+    parser.compile(argagg::long_flag_abbreviations::allowed);
+  argagg::parser_results args;
+
+  SUBCASE("unique abbreviations") {
+    std::vector<const char*> argv {
+      "test", "--verb", "--vers", "--colo", "auto", "--col=never",
+      "--output-f=json", "--out", "a.out", "--de", "1", "file"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK_FALSE(error);
+    CHECK(args["verbose"].count() == 1);
+    CHECK(args["version"].count() == 1);
+    CHECK(args["color"].count() == 2);
+    CHECK(args["color"][0].as<std::string>() == "auto");
+    CHECK(args["color"][1].as<std::string>() == "never");
+    CHECK(args["output-format"].as<std::string>() == "json");
+    CHECK(args["out"].as<std::string>() == "a.out");
+    CHECK(args["debug"].as<std::string>() == "1");
+    REQUIRE(args.count() == 1);
+    CHECK(args.as<std::string>(0) == "file");
+  }
+
+  SUBCASE("prefix flags take precedence") {
+    std::vector<const char*> argv {"test", "--define=X", "--d", "2"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK_FALSE(error);
+    CHECK(args["define"].as<std::string>() == "X");
+    CHECK(args["debug"].as<std::string>() == "2");
+  }
+
+  SUBCASE("ambiguous abbreviations") {
+    std::vector<const char*> argv {"test", "--verb", "--ver=1"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK(error.kind == argagg::parse_error_kind::ambiguous_option);
+    CHECK(error.argv_index == 2);
+    CHECK(error.message() ==
+      "found ambiguous abbreviation of long flags: --ver");
+    CHECK(args["verbose"].count() == 1);
+    CHECK_THROWS_AS({
+      compiled.parse(argv.size(), &(argv.front()));
+    }, const argagg::ambiguous_option_error&);
+  }
+
+  SUBCASE("abbreviations of flags without arguments") {
+    std::vector<const char*> argv {"test", "--verb=1"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK(error.kind == argagg::parse_error_kind::unexpected_argument);
+  }
+
+  SUBCASE("unknown flags") {
+    std::vector<const char*> argv {"test", "--verbosity"};
+    CHECK_THROWS_AS({
+      compiled.parse(argv.size(), &(argv.front()));
+    }, const argagg::unexpected_option_error&);
+  }
+
+  SUBCASE("disallowed by default") {
+    std::vector<const char*> argv {"test", "--verb"};
+    CHECK_THROWS_AS({
+      parser.parse(argv.size(), &(argv.front()));
+    }, const argagg::unexpected_option_error&);
+    CHECK_THROWS_AS({
+      parser.compile().parse(argv.size(), &(argv.front()));
+    }, const argagg::unexpected_option_error&);
+  }
+
+  SUBCASE("copies keep abbreviations") {
+    const argagg::compiled_parser copy = compiled;
+    std::vector<const char*> argv {"test", "--verb"};
+    CHECK(copy.parse(argv.size(), &(argv.front()))["verbose"].count() == 1);
+  }
+}
+
+
+TEST_CASE("compiled parser")
+{
+  argagg::parser parser {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output filename", 1},
+    }};
+  SUBCASE("parses like parser") {
+    const argagg::compiled_parser compiled = parser.compile();
+    std::vector<const char*> argv {
+      "test", "-v", "--output=foo", "bar"};
+    argagg::parser_results args =
+      compiled.parse(argv.size(), &(argv.front()));
+    CHECK(args.has_option("verbose") == true);
+    CHECK(args["output"].as<std::string>() == "foo");
+    CHECK(args.count() == 1);
+    CHECK(args.as<std::string>(0) == "bar");
+  }
+  SUBCASE("reusable") {
+    const argagg::compiled_parser compiled = parser.compile();
+    std::vector<const char*> argv1 {
+      "test", "-v"};
+    std::vector<const char*> argv2 {
+      "test", "-o", "baz"};
+    argagg::parser_results args1 =
+      compiled.parse(argv1.size(), &(argv1.front()));
+    argagg::parser_results args2 =
+      compiled.parse(argv2.size(), &(argv2.front()));
+    CHECK(args1.has_option("verbose") == true);
+    CHECK(args1.has_option("output") == false);
+    CHECK(args2.has_option("verbose") == false);
+    CHECK(args2["output"].as<std::string>() == "baz");
+  }
+  SUBCASE("independent of source parser") {
+    argagg::compiled_parser compiled = parser.compile();
+    parser.definitions.clear();
+    argagg::compiled_parser copy = compiled;
+    compiled = argagg::compiled_parser({});
+    std::vector<const char*> argv {
+      "test", "--verbose"};
+    argagg::parser_results args = copy.parse(argv.size(), &(argv.front()));
+    CHECK(args.has_option("verbose") == true);
+    CHECK(copy.definitions().size() == 2);
+    CHECK(compiled.definitions().size() == 0);
+  }
+  SUBCASE("results only for options that occur") {
+    const argagg::compiled_parser compiled = parser.compile();
+    std::vector<const char*> argv {
+      "test", "-o", "foo", "-o", "bar"};
+    argagg::parser_results args =
+      compiled.parse(argv.size(), &(argv.front()));
+    REQUIRE(args.options.size() == 1);
+    REQUIRE(args.ordinals.size() == 1);
+    CHECK(args.ordinals[0] == 1);
+    CHECK(args.options[0].count() == 2);
+    CHECK(&args.options[0] == &args["output"]);
+    CHECK(args.options[0].as<std::string>() == "bar");
+    CHECK(args.find(argagg::option_handle {0}) == nullptr);
+    CHECK(args.find(argagg::option_handle {1}) == &args.options[0]);
+    const argagg::parser_results& const_args = args;
+    CHECK(const_args["verbose"].count() == 0);
+    CHECK(args.options.size() == 1);
+    CHECK(args["verbose"].count() == 0);
+    REQUIRE(args.options.size() == 2);
+    CHECK(args.ordinals[0] == 0);
+    CHECK(args.ordinals[1] == 1);
+    CHECK(args["output"].count() == 2);
+  }
+  SUBCASE("validates on compile") {
+    parser.definitions.push_back({"bad", {"-v"}, "duplicate", 0});
+    CHECK_THROWS_AS({
+      argagg::compiled_parser compiled = parser.compile();
+    }, const argagg::invalid_flag&);
+  }
+}
+
+
+TEST_CASE("option handles")
+{
+  argagg::parser parser;
+  const argagg::option_handle verbose =
+    parser.add({"verbose", {"-v", "--verbose"}, "be verbose", 0});
+  const argagg::typed_option_handle<int> threads =
+    parser.add<int>({"threads", {"-t", "--threads"}, "threads", 1});
+  const argagg::compiled_parser compiled = parser.compile();
+  SUBCASE("handles index results") {
+    std::vector<const char*> argv {
+      "test", "-v", "--threads", "4", "-t", "8"};
+    argagg::parser_results args =
+      compiled.parse(argv.size(), &(argv.front()));
+    CHECK(args.has_option(verbose) == true);
+    CHECK(args[verbose].count() == 1);
+    CHECK(args.has_option(threads) == true);
+    CHECK(args[threads].count() == 2);
+    CHECK(args.get(threads) == 8);
+    CHECK(&args[threads] == &args["threads"]);
+  }
+  SUBCASE("defaults") {
+    std::vector<const char*> argv {
+      "test"};
+    argagg::parser_results args =
+      compiled.parse(argv.size(), &(argv.front()));
+    CHECK(args.has_option(verbose) == false);
+    CHECK(args.get(threads, 1) == 1);
+  }
+  SUBCASE("handles by name") {
+    CHECK(compiled.handle("verbose").index == verbose.index);
+    CHECK(compiled.handle<int>("threads").index == threads.index);
+    CHECK_THROWS_AS({
+      compiled.handle("output");
+    }, const argagg::unknown_option&);
+  }
+}
+
+
+static constexpr argagg::static_definition static_definitions[] = {
+    {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+    {"output", {"-o", "--output"}, "output filename", 1},
+    {"version", {"--version"}, "print version", 0},
+  };
+static constexpr auto static_argparser =
+  argagg::make_static_parser(static_definitions);
+static_assert(static_argparser.handle("output").index == 1,
+              "static_parser handles are constant expressions");
+
+static constexpr argagg::static_definition static_many_long_flags[] = {
+    {"a", {"-a", "--alpha", "--first"}, "", 0},
+    {"b", {"--bravo", "--second"}, "", 0},
+    {"c", {"--charlie", "--third", "--c3", "--c4"}, "", 0},
+    {"d", {"-d"}, "", 1},
+    {"e", {"--echo"}, "", 0},
+    {"f", {"--foxtrot", "--f2"}, "", 0},
+    {"g", {"--golf"}, "", 0},
+    {"h", {"--hotel", "--h2", "--h3"}, "", 0},
+    {"i", {"--india"}, "", 0},
+    {"j", {"--juliett", "--j2"}, "", 0},
+  };
+static constexpr auto static_many_long_flags_parser =
+  argagg::make_static_parser(static_many_long_flags);
+static constexpr argagg::static_definition static_short_flags_only[] = {
+    {"a", {"-a"}, "", 0},
+  };
+static constexpr auto static_short_flags_only_parser =
+  argagg::make_static_parser(static_short_flags_only);
+
+// A few hundred long flags so building the static tables at compile time is
+// exercised at a realistic scale.
+#define STATIC_LONG_FLAGS_DEFINITION(n) \
+    {"o" #n, {"--option-" #n, "--option-alias-" #n, "--o" #n}, "", 0}
+#define STATIC_LONG_FLAGS_DEFINITIONS(n) \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 0), \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 1), \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 2), \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 3), \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 4), \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 5), \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 6), \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 7), \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 8), \
+    STATIC_LONG_FLAGS_DEFINITION(n ## 9)
+static constexpr argagg::static_definition static_hundreds_of_long_flags[] = {
+    STATIC_LONG_FLAGS_DEFINITIONS(1),
+    STATIC_LONG_FLAGS_DEFINITIONS(2),
+    STATIC_LONG_FLAGS_DEFINITIONS(3),
+    STATIC_LONG_FLAGS_DEFINITIONS(4),
+    STATIC_LONG_FLAGS_DEFINITIONS(5),
+    STATIC_LONG_FLAGS_DEFINITIONS(6),
+    STATIC_LONG_FLAGS_DEFINITIONS(7),
+    STATIC_LONG_FLAGS_DEFINITIONS(8),
+    STATIC_LONG_FLAGS_DEFINITIONS(9),
+    STATIC_LONG_FLAGS_DEFINITIONS(10),
+    STATIC_LONG_FLAGS_DEFINITIONS(11),
+    STATIC_LONG_FLAGS_DEFINITIONS(12),
+    {"v", {"-v", "--verbose"}, "", 0},
+  };
+#undef STATIC_LONG_FLAGS_DEFINITIONS
+#undef STATIC_LONG_FLAGS_DEFINITION
+static constexpr auto static_hundreds_of_long_flags_parser =
+  argagg::make_static_parser(static_hundreds_of_long_flags);
+
+
+TEST_CASE("static parser")
+{
+  constexpr auto verbose = static_argparser.handle("verbose");
+  constexpr auto output = static_argparser.handle<std::string>("output");
+  constexpr auto version = static_argparser.handle("version");
+  SUBCASE("parse") {
+    std::vector<const char*> argv {
+      "test", "-vo", "foo", "--verbose", "--output=bar", "baz", "--version"};
+    argagg::parser_results args =
+      static_argparser.parse(argv.size(), &(argv.front()));
+    CHECK(args[verbose].count() == 2);
+    CHECK(args[output].count() == 2);
+    CHECK(args[output][0].as<std::string>() == "foo");
+    CHECK(args.get(output) == "bar");
+    CHECK(args.has_option(version) == true);
+    CHECK(args.count() == 1);
+    CHECK(args.as<std::string>(0) == "baz");
+  }
+  SUBCASE("unknown flags") {
+    std::vector<const char*> argv {
+      "test", "--verbosity"};
+    CHECK_THROWS_AS({
+      static_argparser.parse(argv.size(), &(argv.front()));
+    }, const argagg::unexpected_option_error&);
+  }
+  SUBCASE("no name index") {
+    std::vector<const char*> argv {
+      "test"};
+    argagg::parser_results args =
+      static_argparser.parse(argv.size(), &(argv.front()));
+    CHECK(args.has_option("verbose") == false);
+    CHECK_THROWS_AS({
+      args["verbose"];
+    }, const argagg::unknown_option&);
+  }
+  SUBCASE("long flag table") {
+    const auto& p = static_many_long_flags_parser;
+    REQUIRE(p.num_long_flags == 18);
+    for (std::size_t i = 0; i < p.num_long_flags; ++i) {
+      const auto& entry = p.long_map[i];
+      CHECK(p.find_long_flag(entry.flag, entry.len) == entry.ordinal);
+    }
+    CHECK(p.find_long_flag("--alph", 6) == argagg::no_option);
+    CHECK(p.find_long_flag("--alphabet", 10) == argagg::no_option);
+    CHECK(p.find_long_flag("--d", 3) == argagg::no_option);
+    CHECK(p.find_long_flag("--firstly", 7) == 0);
+    CHECK(static_short_flags_only_parser.find_long_flag("--a", 3) ==
+          argagg::no_option);
+  }
+  SUBCASE("hundreds of long flags") {
+    const auto& p = static_hundreds_of_long_flags_parser;
+    REQUIRE(p.num_long_flags == 361);
+    for (std::size_t i = 0; i < p.num_long_flags; ++i) {
+      const auto& entry = p.long_map[i];
+      CHECK(p.find_long_flag(entry.flag, entry.len) == entry.ordinal);
+    }
+    CHECK(p.find_long_flag("--option-10", 11) == 0);
+    CHECK(p.find_long_flag("--o129", 6) == 119);
+    CHECK(p.find_long_flag("--verbose", 9) == 120);
+    CHECK(p.find_long_flag("--option-130", 12) == argagg::no_option);
+    CHECK(p.find_long_flag("--option-1", 10) == argagg::no_option);
+    CHECK(p.find_long_flag("--o9", 4) == argagg::no_option);
+    CHECK(p.short_map[static_cast<unsigned char>('v')] == 121);
+    CHECK(p.short_map[static_cast<unsigned char>('o')] == 0);
+  }
+  SUBCASE("invalid definitions at run time") {
+    // These would be compile errors if the result were constexpr.
+    static const argagg::static_definition duplicate[] = {
+        {"a", {"-a"}, "a", 0},
+        {"b", {"-b", "-a"}, "b", 0},
+      };
+    static const argagg::static_definition invalid[] = {
+        {"a", {"-a", "--a=b"}, "a", 0},
+      };
+    static const argagg::static_definition no_flags[] = {
+        {"a", {}, "a", 0},
+      };
+    static const argagg::static_definition duplicate_name[] = {
+        {"a", {"-a"}, "a", 0},
+        {"a", {"-b"}, "b", 0},
+      };
+    CHECK_THROWS_AS({
+      argagg::make_static_parser(duplicate);
+    }, const argagg::invalid_flag&);
+    CHECK_THROWS_AS({
+      argagg::make_static_parser(invalid);
+    }, const argagg::invalid_flag&);
+    CHECK_THROWS_AS({
+      argagg::make_static_parser(no_flags);
+    }, const argagg::invalid_flag&);
+    CHECK_THROWS_AS({
+      argagg::make_static_parser(duplicate_name);
+    }, const argagg::invalid_flag&);
+    CHECK_THROWS_AS({
+      static_argparser.handle("missing");
+    }, const argagg::unknown_option&);
+  }
+}
+
+
+namespace range_test {
+
+// An argument type from outside of argagg, supported through its own
+// to_arg_view() overload.
+struct word {
+  std::string text;
+};
+
+argagg::arg_view to_arg_view(const word& w)
+{
+  return argagg::arg_view {w.text.c_str(), w.text.size()};
+}
+
+} // namespace range_test
+
+
+TEST_CASE("range parse")
+{
+  const argagg::parser parser {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+    }};
+  const argagg::compiled_parser compiled = parser.compile();
+
+  SUBCASE("vector of std::string") {
+    const std::vector<std::string> args {
+      "test", "-vo", "foo", "bar", "--output=baz", "qux"};
+    const auto results = compiled.parse(args.begin(), args.end());
+    CHECK(results.program == args[0].c_str());
+    CHECK(results["verbose"].count() == 1);
+    REQUIRE(results["output"].count() == 2);
+    CHECK(results["output"][0].arg == args[2].c_str());
+    CHECK(results["output"][1].as<std::string>() == "baz");
+    REQUIRE(results.count() == 2);
+    CHECK(results.pos[0] == args[3].c_str());
+    CHECK(results.pos_lengths[0] == 3);
+    CHECK(results.pos[1] == args[5].c_str());
+  }
+
+  SUBCASE("list of std::string with parser") {
+    const std::list<std::string> args {"test", "--verbose", "-o", "foo"};
+    const auto results = parser.parse(args.begin(), args.end());
+    CHECK(results["verbose"].count() == 1);
+    CHECK(results["output"].as<std::string>() == "foo");
+  }
+
+  SUBCASE("pointer and length pairs") {
+    const char* buffer = "test\0-o\0foo\0bar";
+    const std::vector<std::pair<const char*, std::size_t>> args {
+      {buffer, 4}, {buffer + 5, 2}, {buffer + 8, 3}, {buffer + 12, 3}};
+    const auto results = compiled.parse(args.begin(), args.end());
+    CHECK(results["output"].as<std::string>() == "foo");
+    REQUIRE(results.count() == 1);
+    CHECK(results.pos_lengths[0] == 3);
+  }
+
+  SUBCASE("views of flags that aren't null terminated") {
+    // "--verbose" and "-v" are cut out of longer strings, and "--verb" is
+    // an unknown flag even though the buffer continues with "ose".
+    const char* buffer = "test--verbose=1-vx--verbose";
+    const std::vector<std::pair<const char*, std::size_t>> args {
+      {buffer, 4}, {buffer + 4, 9}, {buffer + 15, 2}, {buffer + 18, 9}};
+    const auto results = compiled.parse(args.begin(), args.end());
+    CHECK(results["verbose"].count() == 3);
+    CHECK(results.count() == 0);
+    const std::vector<std::pair<const char*, std::size_t>> truncated {
+      {buffer, 4}, {buffer + 4, 6}};
+    CHECK_THROWS_AS({
+      compiled.parse(truncated.begin(), truncated.end());
+    }, const argagg::unexpected_option_error&);
+  }
+
+  SUBCASE("argv array") {
+    const char* argv[] = {"test", "-v", "foo"};
+    const auto results = compiled.parse(std::begin(argv), std::end(argv));
+    CHECK(results["verbose"].count() == 1);
+    CHECK(results.count() == 1);
+  }
+
+  SUBCASE("custom argument type") {
+    const std::vector<range_test::word> args {{"test"}, {"-o"}, {"foo"}};
+    const auto results = compiled.parse(args.begin(), args.end());
+    CHECK(results["output"].as<std::string>() == "foo");
+  }
+
+#ifdef ARGAGG_HAS_STRING_VIEW
+  SUBCASE("std::string_view") {
+    const std::vector<std::string_view> args {"test", "--output=foo", "bar"};
+    const auto results = compiled.parse(args.begin(), args.end());
+    CHECK(results["output"].as<std::string>() == "foo");
+    CHECK(results.count() == 1);
+  }
+#endif
+
+  SUBCASE("empty range") {
+    const std::vector<std::string> args;
+    const auto results = compiled.parse(args.begin(), args.end());
+    CHECK(results.program == nullptr);
+    CHECK(results.count() == 0);
+  }
+
+  SUBCASE("same errors as parse()") {
+    const std::vector<std::string> args {"test", "--output"};
+    CHECK_THROWS_AS({
+      compiled.parse(args.begin(), args.end());
+    }, const argagg::option_lacks_argument_error&);
+  }
+
+  SUBCASE("static parser") {
+    const std::vector<std::string> args {"test", "--output", "foo"};
+    const auto results = static_argparser.parse(args.begin(), args.end());
+    CHECK(results[static_argparser.handle("output")].as<std::string>() ==
+          "foo");
+  }
+}
+
+
+static std::vector<std::string> split(const std::string& command)
+{
+  argagg::command_line cmd;
+  cmd.split(command);
+  std::vector<std::string> args;
+  for (const auto& arg : cmd) {
+    CHECK(arg.data[arg.size] == '\0');
+    args.push_back(std::string(arg.data, arg.size));
+  }
+  return args;
+}
+
+
+TEST_CASE("command line splitting")
+{
+  using args = std::vector<std::string>;
+  CHECK((split("") == args {}));
+  CHECK((split(" \t\n ") == args {}));
+  CHECK((split("deploy  --force\tx\n") == args {"deploy", "--force", "x"}));
+  CHECK((split("a 'b c' \"d e\"") == args {"a", "b c", "d e"}));
+  CHECK((split("a'b'\"c\"d") == args {"abcd"}));
+  CHECK((split("'' \"\"") == args {"", ""}));
+  CHECK((split("'a\\b' 'a\"b'") == args {"a\\b", "a\"b"}));
+  CHECK((split("\"a\\\"b\\\\c\\$d\\x\"") == args {"a\"b\\c$d\\x"}));
+  CHECK((split("a\\ b \\'c") == args {"a b", "'c"}));
+  CHECK((split("a\\\nb \"c\\\nd\"") == args {"ab", "cd"}));
+  CHECK((split("--output=\"out file\"") == args {"--output=out file"}));
+  CHECK((split("$HOME *.txt") == args {"$HOME", "*.txt"}));
+
+  CHECK_THROWS_AS({
+    split("a 'b");
+  }, const argagg::command_line_error&);
+  CHECK_THROWS_AS({
+    split("a \"b");
+  }, const argagg::command_line_error&);
+  CHECK_THROWS_AS({
+    split("a\\");
+  }, const argagg::command_line_error&);
+
+  SUBCASE("in place") {
+    char buffer[] = "tool -o 'x y' z";
+    std::vector<argagg::arg_view> views;
+    argagg::split_command_line(
+      buffer, buffer + sizeof(buffer) - 1, std::back_inserter(views));
+    REQUIRE(views.size() == 4);
+    CHECK(views[2].data == buffer + 8);
+    CHECK(views[2].data == std::string("x y"));
+    CHECK(views[3].data == std::string("z"));
+  }
+
+  SUBCASE("parse") {
+    const argagg::compiled_parser compiled {{
+        {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+        {"output", {"-o", "--output"}, "output file", 1},
+      }};
+    argagg::command_line cmd;
+    cmd.split("tool -v --output 'my file' \"--not an option\"");
+    auto results = compiled.parse(cmd.begin(), cmd.end());
+    CHECK(results.program == std::string("tool"));
+    CHECK(results["verbose"].count() == 1);
+    CHECK(results["output"].as<std::string>() == "my file");
+    REQUIRE(results.count() == 1);
+    CHECK(results.pos[0] == std::string("--not an option"));
+    cmd.split("tool -o x");
+    compiled.parse_into(cmd.begin(), cmd.end(), results);
+    CHECK(results["output"].as<std::string>() == "x");
+  }
+}
+
+
+// Returns the message of the exception parse() throws for argv.
+static std::string parse_exception_message(
+  const argagg::compiled_parser& compiled,
+  std::vector<const char*>& argv)
+{
+  try {
+    compiled.parse(argv.size(), &(argv.front()));
+  } catch (const std::exception& e) {
+    return e.what();
+  }
+  return "";
+}
+
+
+TEST_CASE("try_parse")
+{
+  const argagg::compiled_parser compiled {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+    }};
+  argagg::parser_results args;
+
+  SUBCASE("success") {
+    std::vector<const char*> argv {"test", "-v", "-o", "foo", "bar"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK_FALSE(error);
+    CHECK(error.kind == argagg::parse_error_kind::none);
+    CHECK(error.message() == "");
+    CHECK(args["output"].as<std::string>() == "foo");
+    CHECK(args.count() == 1);
+  }
+
+  SUBCASE("unexpected long flag") {
+    std::vector<const char*> argv {"test", "-v", "--unknown=1", "-v"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK(error);
+    CHECK(error.kind == argagg::parse_error_kind::unexpected_option);
+    CHECK(error.argv_index == 2);
+    CHECK(error.offset == 0);
+    CHECK(error.message() == "found unexpected flag: --unknown");
+    CHECK(error.message() == parse_exception_message(compiled, argv));
+    CHECK(args["verbose"].count() == 1);
+    CHECK_THROWS_AS({
+      error.raise();
+    }, const argagg::unexpected_option_error&);
+  }
+
+  SUBCASE("unexpected short flag") {
+    std::vector<const char*> argv {"test", "-vxv"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK(error.kind == argagg::parse_error_kind::unexpected_option);
+    CHECK(error.argv_index == 1);
+    CHECK(error.offset == 2);
+    CHECK(error.message() == parse_exception_message(compiled, argv));
+  }
+
+  SUBCASE("unexpected argument") {
+    std::vector<const char*> argv {"test", "--verbose=yes"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK(error.kind == argagg::parse_error_kind::unexpected_argument);
+    CHECK(error.argv_index == 1);
+    CHECK(error.offset == 10);
+    CHECK(error.message() == parse_exception_message(compiled, argv));
+    CHECK_THROWS_AS({
+      error.raise();
+    }, const argagg::unexpected_argument_error&);
+  }
+
+  SUBCASE("option lacks argument") {
+    std::vector<const char*> argv {"test", "foo", "-vo"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK(error.kind == argagg::parse_error_kind::option_lacks_argument);
+    CHECK(error.argv_index == 2);
+    CHECK(error.offset == 2);
+    CHECK(error.message() == parse_exception_message(compiled, argv));
+    CHECK_THROWS_AS({
+      error.raise();
+    }, const argagg::option_lacks_argument_error&);
+  }
+
+  SUBCASE("non-alphanumeric flag") {
+    std::vector<const char*> argv {"test", "-v.", "foo"};
+    const auto error = compiled.try_parse(argv.size(), &(argv.front()), args);
+    CHECK(error.kind == argagg::parse_error_kind::non_alphanumeric_flag);
+    CHECK(error.argv_index == 1);
+    CHECK(error.offset == 2);
+    CHECK(error.message() == parse_exception_message(compiled, argv));
+    CHECK_THROWS_AS({
+      error.raise();
+    }, const std::domain_error&);
+  }
+
+  SUBCASE("range") {
+    const std::vector<std::string> argv {"test", "-o"};
+    const auto error = compiled.try_parse(argv.begin(), argv.end(), args);
+    CHECK(error.kind == argagg::parse_error_kind::option_lacks_argument);
+    CHECK(error.argv_index == 1);
+  }
+
+  SUBCASE("static parser") {
+    std::vector<const char*> argv {"test", "--bad"};
+    const auto error =
+      static_argparser.try_parse(argv.size(), &(argv.front()), args);
+    CHECK(error.kind == argagg::parse_error_kind::unexpected_option);
+    CHECK(error.message() == "found unexpected flag: --bad");
+  }
+}
+
+
+TEST_CASE("try_parse_all")
+{
+  const argagg::compiled_parser compiled {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+    }};
+  argagg::parser_results args;
+  std::vector<argagg::parse_error> errors;
+
+  SUBCASE("every error in one pass") {
+    std::vector<const char*> argv {
+      "test", "--bad", "-v", "--verbose=1", "-vxyv", "foo", "-v.", "-o"};
+    const auto first =
+      compiled.try_parse_all(argv.size(), &(argv.front()), args, errors);
+    REQUIRE(errors.size() == 6);
+    CHECK(first.kind == argagg::parse_error_kind::unexpected_option);
+    CHECK(first.argv_index == 1);
+    CHECK(errors[1].kind == argagg::parse_error_kind::unexpected_argument);
+    CHECK(errors[1].argv_index == 3);
+    CHECK(errors[2].kind == argagg::parse_error_kind::unexpected_option);
+    CHECK(errors[2].argv_index == 4);
+    CHECK(errors[2].offset == 2);
+    CHECK(errors[3].kind == argagg::parse_error_kind::unexpected_option);
+    CHECK(errors[3].offset == 3);
+    CHECK(errors[4].kind == argagg::parse_error_kind::non_alphanumeric_flag);
+    CHECK(errors[4].argv_index == 6);
+    CHECK(errors[5].kind == argagg::parse_error_kind::option_lacks_argument);
+    CHECK(errors[5].argv_index == 7);
+
+    // Everything else still parsed.
+    CHECK(args["verbose"].count() == 4);
+    REQUIRE(args.count() == 1);
+    CHECK(args.pos[0] == std::string("foo"));
+
+    std::ostringstream os;
+    argagg::write_parse_errors(os, errors);
+    const std::string report = os.str();
+    CHECK(report.find("argument 1: found unexpected flag: --bad\n") == 0);
+    CHECK(std::count(report.begin(), report.end(), '\n') == 6);
+  }
+
+  SUBCASE("no errors") {
+    std::vector<const char*> argv {"test", "-v", "-o", "foo"};
+    errors.push_back(argagg::parse_error {
+        argagg::parse_error_kind::unexpected_option, 1, 0, "-x"});
+    CHECK_FALSE(
+      compiled.try_parse_all(argv.size(), &(argv.front()), args, errors));
+    CHECK(errors.empty());
+    CHECK(args["output"].as<std::string>() == "foo");
+  }
+
+  SUBCASE("range and static parser") {
+    const std::vector<std::string> argv {"test", "--bad", "-x", "--output"};
+    compiled.try_parse_all(argv.begin(), argv.end(), args, errors);
+    CHECK(errors.size() == 3);
+    static_argparser.try_parse_all(argv.begin(), argv.end(), args, errors);
+    CHECK(errors.size() == 3);
+  }
+}
+
+
+TEST_CASE("stop at")
+{
+  const argagg::parser argparser {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"env", {"-e", "--env"}, "environment variable", 1},
+    }};
+  const argagg::compiled_parser compiled = argparser.compile();
+  constexpr static argagg::static_definition static_definitions[] = {
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"env", {"-e", "--env"}, "environment variable", 1},
+    };
+  constexpr static auto static_argparser =
+    argagg::make_static_parser(static_definitions);
+  constexpr auto verbose = static_argparser.handle("verbose");
+  constexpr auto env = static_argparser.handle("env");
+  using argagg::stop_at;
+
+  SUBCASE("first positional") {
+    std::vector<const char*> argv {
+      "launch", "-v", "-e", "A=1", "prog", "-v", "--", "x", nullptr};
+    const int argc = static_cast<int>(argv.size()) - 1;
+    for (const auto& args : {
+        argparser.parse(argc, &(argv.front()), stop_at::first_positional),
+        compiled.parse(argc, &(argv.front()), stop_at::first_positional),
+        static_argparser.parse(
+          argc, &(argv.front()), stop_at::first_positional)}) {
+      CHECK(args[verbose].count() == 1);
+      CHECK(args[env].as<std::string>() == "A=1");
+      CHECK(args.pos.empty());
+      CHECK(args.remainder.data == &argv[4]);
+      CHECK(args.remainder.size == 4);
+      CHECK(args.remainder.data[args.remainder.size] == nullptr);
+    }
+  }
+
+  SUBCASE("first positional after separator") {
+    std::vector<const char*> argv {"launch", "-v", "--", "-v", "x"};
+    const auto args = compiled.parse(
+      argv.size(), &(argv.front()), stop_at::first_positional);
+    CHECK(args["verbose"].count() == 1);
+    CHECK(args.remainder.data == &argv[3]);
+    CHECK(args.remainder.size == 2);
+  }
+
+  SUBCASE("separator") {
+    std::vector<const char*> argv {
+      "launch", "a", "-v", "b", "--", "-v", "c"};
+    const auto args = compiled.parse(
+      argv.size(), &(argv.front()), stop_at::separator);
+    CHECK(args["verbose"].count() == 1);
+    REQUIRE(args.pos.size() == 2);
+    CHECK(args.pos[0] == argv[1]);
+    CHECK(args.pos[1] == argv[3]);
+    CHECK(args.remainder.data == &argv[5]);
+    CHECK(std::vector<const char*>(
+            args.remainder.begin(), args.remainder.end()) ==
+          std::vector<const char*>(argv.begin() + 5, argv.end()));
+  }
+
+  SUBCASE("separator as option argument") {
+    std::vector<const char*> argv {"launch", "-e", "--", "--", "x"};
+    const auto args = compiled.parse(
+      argv.size(), &(argv.front()), stop_at::separator);
+    CHECK(args["env"].as<std::string>() == "--");
+    CHECK(args.remainder.data == &argv[4]);
+    CHECK(args.remainder.size == 1);
+  }
+
+  SUBCASE("nothing left") {
+    std::vector<const char*> argv {"launch", "-v", "a"};
+    const auto args = compiled.parse(
+      argv.size(), &(argv.front()), stop_at::separator);
+    CHECK(args.pos.size() == 1);
+    CHECK(args.remainder.empty());
+    CHECK(args.remainder.data == &argv.front() + argv.size());
+    const auto plain = compiled.parse(argv.size(), &(argv.front()));
+    CHECK(plain.remainder.empty());
+  }
+
+  SUBCASE("errors") {
+    std::vector<const char*> unknown {"launch", "-x", "prog"};
+    CHECK_THROWS_AS({
+      compiled.parse(
+        unknown.size(), &(unknown.front()), stop_at::first_positional);
+    }, const argagg::unexpected_option_error&);
+    std::vector<const char*> lacking {"launch", "-e"};
+    CHECK_THROWS_AS({
+      compiled.parse(
+        lacking.size(), &(lacking.front()), stop_at::first_positional);
+    }, const argagg::option_lacks_argument_error&);
+    std::vector<const char*> after {"launch", "prog", "-x"};
+    CHECK(compiled.parse(
+            after.size(), &(after.front()), stop_at::first_positional)
+          .remainder.size == 2);
+  }
+}
+
+
+TEST_CASE("forward unknown options")
+{
+  const argagg::parser argparser {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+    }};
+  const argagg::compiled_parser compiled = argparser.compile();
+  constexpr static argagg::static_definition static_definitions[] = {
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+    };
+  constexpr static auto static_argparser =
+    argagg::make_static_parser(static_definitions);
+  constexpr auto verbose = static_argparser.handle("verbose");
+  constexpr auto output = static_argparser.handle("output");
+  using argagg::forward;
+
+  std::vector<const char*> argv {
+    "cc-wrap", "-Wall", "-v", "a.c", "--std=c11", "-o", "a.out", "-I/inc",
+    "-O2", "b.c", "--", "-c.c"};
+  const int argc = static_cast<int>(argv.size());
+
+  SUBCASE("unknown options") {
+    std::vector<const char*> forwarded {"cc"};
+    std::vector<const char*> expected {
+      "cc", argv[1], argv[4], argv[7], argv[8], nullptr};
+    for (int i = 0; i < 3; ++i) {
+      forwarded.resize(1);
+      const auto args =
+        i == 0 ? argparser.parse(argc, &(argv.front()), forwarded)
+        : i == 1 ? compiled.parse(argc, &(argv.front()), forwarded)
+        : static_argparser.parse(argc, &(argv.front()), forwarded);
+      CHECK(forwarded == expected);
+      CHECK(args[verbose].count() == 1);
+      CHECK(args[output].as<std::string>() == "a.out");
+      REQUIRE(args.pos.size() == 3);
+      CHECK(args.pos[0] == argv[3]);
+      CHECK(args.pos[1] == argv[9]);
+      CHECK(args.pos[2] == argv[11]);
+    }
+  }
+
+  SUBCASE("unknown options and positionals") {
+    std::vector<const char*> forwarded;
+    const auto args = compiled.parse(
+      argc, &(argv.front()), forwarded,
+      forward::unknown_options_and_positionals);
+    CHECK(forwarded == (std::vector<const char*> {
+        argv[1], argv[3], argv[4], argv[7], argv[8], argv[9], argv[10],
+        argv[11], nullptr}));
+    CHECK(args["verbose"].count() == 1);
+    CHECK(args["output"].as<std::string>() == "a.out");
+    CHECK(args.pos.empty());
+  }
+
+  SUBCASE("separate arguments are not forwarded") {
+    std::vector<const char*> separate {"wrap", "-x", "c", "-o", "-y"};
+    std::vector<const char*> forwarded;
+    const auto args = compiled.parse(
+      separate.size(), &(separate.front()), forwarded);
+    CHECK(forwarded == (std::vector<const char*> {separate[1], nullptr}));
+    REQUIRE(args.pos.size() == 1);
+    CHECK(args.pos[0] == separate[2]);
+    CHECK(args["output"].as<std::string>() == "-y");
+  }
+
+  SUBCASE("errors") {
+    std::vector<const char*> forwarded;
+    std::vector<const char*> mid_group {"wrap", "-vx"};
+    CHECK_THROWS_AS({
+      compiled.parse(mid_group.size(), &(mid_group.front()), forwarded);
+    }, const argagg::unexpected_option_error&);
+    std::vector<const char*> lacking {"wrap", "-x", "-o"};
+    CHECK_THROWS_AS({
+      compiled.parse(lacking.size(), &(lacking.front()), forwarded);
+    }, const argagg::option_lacks_argument_error&);
+    std::vector<const char*> unexpected_arg {"wrap", "--verbose=1"};
+    CHECK_THROWS_AS({
+      compiled.parse(
+        unexpected_arg.size(), &(unexpected_arg.front()), forwarded);
+    }, const argagg::unexpected_argument_error&);
+  }
+}
+
+
+namespace subcommand_test {
+
+int num_clone_parsers = 0;
+int num_commit_parsers = 0;
+
+argagg::compiled_parser make_clone_parser()
+{
+  ++num_clone_parsers;
+  return argagg::compiled_parser {{
+      {"depth", {"--depth"}, "history depth", 1},
+    }};
+}
+
+argagg::compiled_parser make_commit_parser()
+{
+  ++num_commit_parsers;
+  return argagg::compiled_parser {{
+      {"message", {"-m", "--message"}, "commit message", 1},
+      {"all", {"-a", "--all"}, "commit all changes", 0},
+    }};
+}
+
+} // namespace subcommand_test
+
+
+TEST_CASE("subcommands")
+{
+  using namespace subcommand_test;
+  num_clone_parsers = 0;
+  num_commit_parsers = 0;
+  const argagg::subcommand_parser cli {
+    argagg::compiled_parser {{
+        {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+        {"dir", {"-C"}, "run in this directory", 1},
+      }},
+    {
+      {"clone", "clone a repository", make_clone_parser},
+      {"commit", "record changes", make_commit_parser},
+    }};
+
+  SUBCASE("only the selected subcommand is built") {
+    std::vector<const char*> argv {
+      "git", "-v", "-C", "repo", "commit", "-am", "fix", "file.txt", "--",
+      "-v"};
+    const auto args = cli.parse(argv.size(), &(argv.front()));
+    CHECK(num_clone_parsers == 0);
+    CHECK(num_commit_parsers == 1);
+    CHECK(args.global["verbose"].count() == 1);
+    CHECK(args.global["dir"].as<std::string>() == "repo");
+    CHECK(args.global.count() == 0);
+    REQUIRE(args.command != nullptr);
+    CHECK(args.command->name == std::string("commit"));
+    CHECK(args.argc == 6);
+    CHECK(args.argv == &argv[4]);
+    CHECK(args.results.program == argv[4]);
+    CHECK(args.results["all"].count() == 1);
+    CHECK(args.results["message"].as<std::string>() == "fix");
+    REQUIRE(args.results.count() == 2);
+    CHECK(args.results.pos[1] == argv[9]);
+  }
+
+  SUBCASE("no subcommand") {
+    std::vector<const char*> argv {"git", "--verbose"};
+    const auto args = cli.parse(argv.size(), &(argv.front()));
+    CHECK(args.command == nullptr);
+    CHECK(args.global["verbose"].count() == 1);
+    CHECK(args.argc == 0);
+    CHECK(num_clone_parsers + num_commit_parsers == 0);
+  }
+
+  SUBCASE("unknown subcommand") {
+    std::vector<const char*> argv {"git", "push"};
+    CHECK_THROWS_AS({
+      cli.parse(argv.size(), &(argv.front()));
+    }, const argagg::unexpected_subcommand_error&);
+  }
+
+  SUBCASE("errors") {
+    std::vector<const char*> global_error {"git", "--bad", "clone"};
+    CHECK_THROWS_AS({
+      cli.parse(global_error.size(), &(global_error.front()));
+    }, const argagg::unexpected_option_error&);
+    std::vector<const char*> command_error {"git", "clone", "-v"};
+    CHECK_THROWS_AS({
+      cli.parse(command_error.size(), &(command_error.front()));
+    }, const argagg::unexpected_option_error&);
+    std::vector<const char*> lacking {"git", "-C"};
+    CHECK_THROWS_AS({
+      cli.parse(lacking.size(), &(lacking.front()));
+    }, const argagg::option_lacks_argument_error&);
+  }
+
+  SUBCASE("help") {
+    std::ostringstream os;
+    os << cli;
+    CHECK(os.str().find("\nCommands:\n    clone\n        clone a repository\n")
+          != std::string::npos);
+  }
+}
+
+
+namespace multicall_test {
+
+int num_parsers = 0;
+
+argagg::compiled_parser make_parser()
+{
+  ++num_parsers;
+  return argagg::compiled_parser {{
+      {"number", {"-n"}, "number the output lines", 0},
+    }};
+}
+
+constexpr argagg::subcommand programs[] = {
+    {"cat", "concatenate files", make_parser},
+    {"echo", "write arguments", make_parser},
+    {"ls", "list directory contents", make_parser},
+    {"true", "do nothing successfully", make_parser},
+    {"false", "do nothing unsuccessfully", make_parser},
+    {"head", "output the first part of files", make_parser},
+    {"tail", "output the last part of files", make_parser},
+  };
+
+constexpr auto registry = argagg::make_multicall_registry(programs);
+
+} // namespace multicall_test
+
+
+TEST_CASE("multicall registry")
+{
+  using namespace multicall_test;
+  num_parsers = 0;
+
+  SUBCASE("program_basename") {
+    CHECK(argagg::program_basename("cat") == std::string("cat"));
+    CHECK(argagg::program_basename("/usr/bin/cat") == std::string("cat"));
+    CHECK(argagg::program_basename("./bin/") == std::string(""));
+  }
+
+  SUBCASE("find") {
+    for (const auto& program : programs) {
+      CHECK(registry.find(program.name) == &program);
+    }
+    CHECK(registry.find("") == nullptr);
+    CHECK(registry.find("ca") == nullptr);
+    CHECK(registry.find("cats") == nullptr);
+    CHECK(registry.find("busybox") == nullptr);
+    CHECK(registry.find("lsx", 2) == &programs[2]);
+  }
+
+  SUBCASE("only the selected program is built") {
+    std::vector<const char*> argv {"/bin/head", "-n", "file.txt"};
+    const auto args = registry.parse(argv.size(), &(argv.front()));
+    CHECK(num_parsers == 1);
+    REQUIRE(args.program != nullptr);
+    CHECK(args.program == &programs[5]);
+    CHECK(args.results.program == argv[0]);
+    CHECK(args.results["number"].count() == 1);
+    REQUIRE(args.results.count() == 1);
+    CHECK(args.results.pos[0] == argv[2]);
+  }
+
+  SUBCASE("unknown program") {
+    std::vector<const char*> argv {"/bin/busybox", "cat"};
+    CHECK_THROWS_AS({
+      registry.parse(argv.size(), &(argv.front()));
+    }, const argagg::unexpected_program_error&);
+    CHECK_THROWS_AS({
+      registry.parse(0, &(argv.front()));
+    }, const argagg::unexpected_program_error&);
+    CHECK(num_parsers == 0);
+  }
+
+  SUBCASE("help") {
+    std::ostringstream os;
+    os << registry;
+    CHECK(os.str().find("Programs:\n    cat\n        concatenate files\n")
+          == 0);
+  }
+}
+
+
+TEST_CASE("incremental parser")
+{
+  const argagg::compiled_parser compiled {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+      {"include", {"-I", "--include"}, "include path", 1},
+    }};
+  auto incremental = compiled.incremental();
+  std::vector<argagg::parse_event> events;
+  const auto handler = [&](const argagg::parse_event& event) {
+      events.push_back(event);
+    };
+
+  SUBCASE("events are emitted as soon as they are complete") {
+    incremental.feed("-vo", handler);
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].kind == argagg::parse_event_kind::option);
+    CHECK(events[0].ordinal == 0);
+    CHECK(events[0].defn == &compiled.definitions()[0]);
+    CHECK(events[0].value == nullptr);
+    CHECK(events[0].argv_index == 1);
+    incremental.feed("out", handler);
+    REQUIRE(events.size() == 2);
+    CHECK(events[1].ordinal == 1);
+    CHECK(events[1].value == std::string("out"));
+    CHECK(events[1].value_len == 3);
+    CHECK(events[1].argv_index == 1);
+    incremental.feed("-vvIfoo", handler);
+    REQUIRE(events.size() == 5);
+    CHECK(events[2].ordinal == 0);
+    CHECK(events[3].ordinal == 0);
+    CHECK(events[4].ordinal == 2);
+    CHECK(events[4].value == std::string("foo"));
+    CHECK(events[4].argv_index == 3);
+    incremental.feed("--", handler);
+    incremental.feed("-v", handler);
+    REQUIRE(events.size() == 6);
+    CHECK(events[5].kind == argagg::parse_event_kind::positional);
+    CHECK(events[5].ordinal == argagg::no_option);
+    CHECK(events[5].value == std::string("-v"));
+    CHECK(events[5].argv_index == 5);
+    CHECK(incremental.count() == 5);
+    incremental.finish();
+    CHECK(incremental.count() == 0);
+  }
+
+  SUBCASE("finish with an option waiting for its argument") {
+    incremental.feed("--output", handler);
+    CHECK(events.empty());
+    CHECK_THROWS_AS({
+      incremental.finish();
+    }, const argagg::option_lacks_argument_error&);
+    incremental.feed("-v", handler);
+    CHECK(events.size() == 1);
+    incremental.finish();
+  }
+
+  SUBCASE("same errors as parse()") {
+    CHECK_THROWS_AS({
+      incremental.feed("--verbose=1", handler);
+    }, const argagg::unexpected_argument_error&);
+    CHECK_THROWS_AS({
+      incremental.feed("-x", handler);
+    }, const argagg::unexpected_option_error&);
+  }
+
+  SUBCASE("static parser") {
+    auto static_incremental = static_argparser.incremental();
+    static_incremental.feed("--output=foo", handler);
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].ordinal == static_argparser.handle("output").index);
+    CHECK(events[0].defn == nullptr);
+    CHECK(events[0].value == std::string("foo"));
+    static_incremental.finish();
+  }
+}
+
+
+TEST_CASE("parse events")
+{
+  const argagg::compiled_parser compiled {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+      {"include", {"-I", "--include"}, "include path", 1},
+    }};
+  std::vector<argagg::parse_event> events;
+
+  SUBCASE("events in argv order") {
+    std::vector<const char*> argv {
+      "test", "-vo", "out", "foo", "-vIbar", "--include", "baz", "--", "-v"};
+    for (const auto& event : compiled.parse_events(argv.size(),
+                                                   &(argv.front()))) {
+      events.push_back(event);
+    }
+    REQUIRE(events.size() == 7);
+    CHECK(events[0].ordinal == 0);
+    CHECK(events[0].defn == &compiled.definitions()[0]);
+    CHECK(events[0].argv_index == 1);
+    CHECK(events[1].ordinal == 1);
+    CHECK(events[1].value == std::string("out"));
+    CHECK(events[1].argv_index == 1);
+    CHECK(events[2].kind == argagg::parse_event_kind::positional);
+    CHECK(events[2].value == std::string("foo"));
+    CHECK(events[2].argv_index == 3);
+    CHECK(events[3].ordinal == 0);
+    CHECK(events[4].ordinal == 2);
+    CHECK(events[4].value == std::string("bar"));
+    CHECK(events[4].value_len == 3);
+    CHECK(events[5].ordinal == 2);
+    CHECK(events[5].value == std::string("baz"));
+    CHECK(events[5].argv_index == 5);
+    CHECK(events[6].kind == argagg::parse_event_kind::positional);
+    CHECK(events[6].value == std::string("-v"));
+    CHECK(events[6].argv_index == 8);
+  }
+
+  SUBCASE("empty command line") {
+    std::vector<const char*> argv {"test"};
+    const auto range = compiled.parse_events(argv.size(), &(argv.front()));
+    CHECK(range.begin() == range.end());
+  }
+
+  SUBCASE("stops early") {
+    std::vector<const char*> argv {"test", "-v", "--unknown"};
+    auto it = compiled.parse_events(argv.size(), &(argv.front())).begin();
+    CHECK(it->ordinal == 0);
+    CHECK_THROWS_AS({
+      ++it;
+    }, const argagg::unexpected_option_error&);
+  }
+
+  SUBCASE("option waiting for its argument") {
+    std::vector<const char*> argv {"test", "-v", "--output"};
+    auto range = compiled.parse_events(argv.size(), &(argv.front()));
+    auto it = range.begin();
+    CHECK(it != range.end());
+    CHECK_THROWS_AS({
+      ++it;
+    }, const argagg::option_lacks_argument_error&);
+    CHECK(it == range.end());
+  }
+
+  SUBCASE("static parser") {
+    std::vector<const char*> argv {"test", "--output=foo", "bar"};
+    for (const auto& event : static_argparser.parse_events(argv.size(),
+                                                           &(argv.front()))) {
+      events.push_back(event);
+    }
+    REQUIRE(events.size() == 2);
+    CHECK(events[0].ordinal == static_argparser.handle("output").index);
+    CHECK(events[0].value == std::string("foo"));
+    CHECK(events[1].kind == argagg::parse_event_kind::positional);
+  }
+}
+
+
+// Counts what goes through it so tests can tell where memory came from.
+struct counting_memory : public argagg::results_memory {
+  argagg::monotonic_arena arena;
+  std::size_t allocations = 0;
+  void* allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    ++allocations;
+    return arena.allocate(bytes, alignment);
+  }
+  void deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+  {
+    arena.deallocate(p, bytes, alignment);
+  }
+};
+
+
+TEST_CASE("contiguous option storage")
+{
+  argagg::parser parser {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+      {"include", {"-I", "--include"}, "include path", 1},
+    }};
+  const argagg::compiled_parser compiled = parser.compile();
+  std::vector<const char*> argv {
+    "test", "-I", "a", "-v", "-Ib", "-o", "x", "--include=c", "-v", "pos"};
+
+  SUBCASE("occurrences are grouped by definition in order") {
+    argagg::parser_results args =
+      compiled.parse(argv.size(), &(argv.front()));
+    REQUIRE(args.values.size() == 6);
+    REQUIRE(args.options.size() == 3);
+    CHECK(args.options[0].all.data() == &args.values[0]);
+    CHECK(args.options[1].all.data() == &args.values[2]);
+    CHECK(args.options[2].all.data() == &args.values[3]);
+    CHECK(args["verbose"].count() == 2);
+    CHECK(args["output"].as<std::string>() == "x");
+    REQUIRE(args["include"].count() == 3);
+    CHECK(args["include"][0].as<std::string>() == "a");
+    CHECK(args["include"][1].as<std::string>() == "b");
+    CHECK(args["include"][2].as<std::string>() == "c");
+    const std::vector<std::size_t> value_ordinals {0, 0, 1, 2, 2, 2};
+    CHECK(std::equal(
+      value_ordinals.begin(), value_ordinals.end(),
+      args.value_ordinals.begin()));
+  }
+
+  SUBCASE("copies point at their own storage") {
+    argagg::parser_results copy;
+    {
+      const argagg::parser_results args =
+        compiled.parse(argv.size(), &(argv.front()));
+      copy = args;
+      CHECK(copy["include"].all.data() != args["include"].all.data());
+    }
+    CHECK(copy["include"].all.data() == &copy.values[3]);
+    CHECK(copy["include"].as<std::string>() == "c");
+    const argagg::parser_results moved = std::move(copy);
+    CHECK(moved["include"].all.data() == &moved.values[3]);
+  }
+
+  SUBCASE("option storage comes from the caller's memory") {
+    counting_memory memory;
+    argagg::parser_results args(&memory);
+    compiled.parse_into(argv.size(), &(argv.front()), args);
+    CHECK(memory.allocations == 4);
+    CHECK(args["include"].count() == 3);
+    compiled.parse_into(argv.size(), &(argv.front()), args);
+    CHECK(memory.allocations == 4);
+  }
+}
+
+
+TEST_CASE("monotonic_arena")
+{
+  argagg::monotonic_arena arena(64);
+  void* a = arena.allocate(3, 1);
+  void* b = arena.allocate(8, 8);
+  CHECK(reinterpret_cast<std::uintptr_t>(b) % 8 == 0);
+  CHECK(static_cast<char*>(b) >= static_cast<char*>(a) + 3);
+  void* big = arena.allocate(1000, 16);
+  CHECK(reinterpret_cast<std::uintptr_t>(big) % 16 == 0);
+  std::memset(big, 0, 1000);
+  arena.release();
+  void* c = arena.allocate(16, 16);
+  CHECK(c != nullptr);
+
+  SUBCASE("alignment past the end of a block") {
+    // Fill a block up to a few bytes before its end so that aligning the next
+    // allocation overshoots it.
+    for (std::size_t block_size : {61u, 63u, 100u}) {
+      argagg::monotonic_arena mixed(block_size);
+      for (std::size_t i = 0; i < 200; ++i) {
+        char* one = static_cast<char*>(mixed.allocate(1, 1));
+        *one = 'x';
+        const std::size_t alignment = std::size_t{1} << (i % 5);
+        char* p = static_cast<char*>(mixed.allocate(alignment, alignment));
+        CHECK(reinterpret_cast<std::uintptr_t>(p) % alignment == 0);
+        std::memset(p, 0, alignment);
+      }
+    }
+    argagg::monotonic_arena repro(61);
+    for (int i = 0; i < 49; ++i) {
+      repro.allocate(1, 1);
+    }
+    char* eight = static_cast<char*>(repro.allocate(8, 8));
+    std::memset(eight, 0, 8);
+  }
+
+  SUBCASE("zero block size") {
+    argagg::monotonic_arena empty(0);
+    char* p = static_cast<char*>(empty.allocate(32, 8));
+    std::memset(p, 0, 32);
+    CHECK(reinterpret_cast<std::uintptr_t>(p) % 8 == 0);
+  }
+}
+
+
 TEST_CASE("argument conversions")
 {
   argagg::parser parser {{
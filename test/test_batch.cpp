@@ -0,0 +1,97 @@
+#include "../include/argagg/argagg.hpp"
+#include "../include/argagg/batch.hpp"
+
+#include "doctest.h"
+
+#include <string>
+#include <vector>
+
+
+TEST_CASE("parse_batch")
+{
+  const argagg::parser parser {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+    }};
+  const argagg::compiled_parser compiled = parser.compile();
+
+  // Every seventh line is missing the argument to its last option.
+  std::vector<std::vector<std::string>> lines;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    std::vector<std::string> line {"tool", "-o", "out" + std::to_string(i)};
+    for (std::size_t j = 0; j < i % 5; ++j) {
+      line.push_back("-v");
+    }
+    if (i % 7 == 0) {
+      line.push_back("--output");
+    }
+    lines.push_back(line);
+  }
+
+  const auto check = [&](const std::vector<argagg::batch_result>& results) {
+      REQUIRE(results.size() == lines.size());
+      for (std::size_t i = 0; i < lines.size(); ++i) {
+        if (i % 7 == 0) {
+          CHECK_FALSE(results[i].ok());
+          CHECK_THROWS_AS({
+            std::rethrow_exception(results[i].error);
+          }, const argagg::option_lacks_argument_error&);
+          continue;
+        }
+        REQUIRE(results[i].ok());
+        const auto& args = results[i].results;
+        CHECK(args["output"].as<std::string>() == "out" + std::to_string(i));
+        CHECK(args["verbose"].count() == i % 5);
+      }
+    };
+
+  SUBCASE("single thread") {
+    check(argagg::parse_batch(compiled, lines.begin(), lines.end(), 1));
+  }
+
+  SUBCASE("more threads than lines per thread") {
+    check(argagg::parse_batch(compiled, lines.begin(), lines.end(), 8));
+  }
+
+  SUBCASE("default thread count") {
+    check(argagg::parse_batch(compiled, lines.begin(), lines.end()));
+  }
+
+  SUBCASE("uncompiled parser") {
+    check(argagg::parse_batch(parser, lines.begin(), lines.end(), 4));
+  }
+
+  SUBCASE("shared pool") {
+    argagg::batch_pool pool(4);
+    CHECK(pool.size() == 4);
+    for (int run = 0; run < 3; ++run) {
+      check(argagg::parse_batch(pool, compiled, lines.begin(), lines.end()));
+    }
+    check(argagg::parse_batch(pool, parser, lines.begin(), lines.end()));
+    const std::vector<std::vector<std::string>> one {{"tool", "-v"}};
+    const auto results = argagg::parse_batch(pool, compiled, one.begin(),
+                                             one.end());
+    REQUIRE(results.size() == 1);
+    CHECK(results[0].ok());
+  }
+
+  SUBCASE("pool of one thread") {
+    argagg::batch_pool pool(1);
+    CHECK(pool.size() == 1);
+    check(argagg::parse_batch(pool, compiled, lines.begin(), lines.end()));
+  }
+
+  SUBCASE("few lines") {
+    const std::vector<std::vector<std::string>> two {
+      {"tool", "-v"}, {"tool", "--unknown"}};
+    const auto results = argagg::parse_batch(compiled, two.begin(), two.end(),
+                                             16);
+    REQUIRE(results.size() == 2);
+    CHECK(results[0].ok());
+    CHECK_FALSE(results[1].ok());
+  }
+
+  SUBCASE("no lines") {
+    CHECK(argagg::parse_batch(compiled, lines.end(), lines.end()).empty());
+  }
+}
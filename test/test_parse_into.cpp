@@ -0,0 +1,310 @@
+#include "../include/argagg/argagg.hpp"
+
+#include "doctest.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+
+// Count every heap allocation made by the test executable so the tests below
+// can check that a warmed up parse_into() doesn't allocate. Every replaceable
+// allocation and deallocation function goes through count_new() and free(),
+// so the counter also sees allocations that bypass the plain operator new
+// (such as std::stable_sort()'s nothrow buffer) and sanitizers never see a
+// mismatched pair.
+static std::atomic<std::size_t> g_num_allocations(0);
+
+
+static void* count_new(std::size_t size) noexcept
+{
+  ++g_num_allocations;
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+
+void* operator new(std::size_t size)
+{
+  if (void* p = count_new(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+
+void* operator new[](std::size_t size)
+{
+  if (void* p = count_new(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  return count_new(size);
+}
+
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  return count_new(size);
+}
+
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+
+void operator delete[](void* p) noexcept
+{
+  std::free(p);
+}
+
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+  std::free(p);
+}
+
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+  std::free(p);
+}
+
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+#endif
+
+
+static argagg::parser parse_into_parser()
+{
+  return argagg::parser {{
+      {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+      {"output", {"-o", "--output"}, "output file", 1},
+      {"include", {"-I", "--include"}, "include path", 1},
+    }};
+}
+
+
+TEST_CASE("parse_into")
+{
+  const argagg::compiled_parser compiled = parse_into_parser().compile();
+  argagg::parser_results args;
+
+  SUBCASE("results match parse()") {
+    std::vector<const char*> argv {
+      "test", "-v", "--output=foo", "-Iinclude", "bar", "baz"};
+    compiled.parse_into(argv.size(), &(argv.front()), args);
+    const argagg::parser_results expected =
+      compiled.parse(argv.size(), &(argv.front()));
+    CHECK(args.program == expected.program);
+    CHECK(args.options.size() == expected.options.size());
+    CHECK(args.ordinals == expected.ordinals);
+    CHECK(args.pos == expected.pos);
+    CHECK(args.pos_lengths == expected.pos_lengths);
+    CHECK(args["output"].as<std::string>() == "foo");
+    CHECK(args["include"].as<std::string>() == "include");
+    CHECK(args.count() == 2);
+  }
+
+  SUBCASE("nothing leaks from the previous parse") {
+    std::vector<const char*> first {"first", "-v", "-o", "foo", "bar"};
+    compiled.parse_into(first.size(), &(first.front()), args);
+    CHECK(args.has_option("verbose"));
+    std::vector<const char*> second {"second", "-I", "include"};
+    compiled.parse_into(second.size(), &(second.front()), args);
+    CHECK(args.program == std::string("second"));
+    CHECK_FALSE(args.has_option("verbose"));
+    CHECK_FALSE(args.has_option("output"));
+    CHECK(args["include"].count() == 1);
+    CHECK(args.count() == 0);
+  }
+
+  SUBCASE("results from another parser") {
+    const argagg::compiled_parser other {{
+        {"help", {"-h"}, "help", 0},
+      }};
+    std::vector<const char*> first {"first", "-h"};
+    other.parse_into(first.size(), &(first.front()), args);
+    std::vector<const char*> second {"second", "-v"};
+    compiled.parse_into(second.size(), &(second.front()), args);
+    CHECK(args.options.size() == 1);
+    CHECK(args["verbose"].count() == 1);
+  }
+
+  SUBCASE("parser::parse_into") {
+    const argagg::parser parser = parse_into_parser();
+    std::vector<const char*> argv {"test", "-o", "foo"};
+    parser.parse_into(argv.size(), &(argv.front()), args);
+    CHECK(args["output"].as<std::string>() == "foo");
+  }
+}
+
+
+TEST_CASE("parse_into does not allocate once warmed up")
+{
+  const argagg::compiled_parser compiled = parse_into_parser().compile();
+  argagg::parser_results args;
+  std::vector<const char*> long_argv {
+    "test", "-v", "--output=foo", "-I", "a", "-Ib", "--include", "c", "d", "e",
+    "f"};
+  std::vector<const char*> short_argv {"test", "-I", "x", "y"};
+
+  compiled.parse_into(long_argv.size(), &(long_argv.front()), args);
+  compiled.parse_into(short_argv.size(), &(short_argv.front()), args);
+
+  const std::size_t before = g_num_allocations;
+  for (int i = 0; i < 100; ++i) {
+    compiled.parse_into(long_argv.size(), &(long_argv.front()), args);
+    compiled.parse_into(short_argv.size(), &(short_argv.front()), args);
+  }
+  CHECK(g_num_allocations - before == 0);
+  CHECK(args["include"].as<std::string>() == "x");
+  CHECK(args.count() == 1);
+
+  // Make sure allocations are actually being counted.
+  const std::size_t before_parse = g_num_allocations;
+  const argagg::parser_results fresh =
+    compiled.parse(short_argv.size(), &(short_argv.front()));
+  CHECK(g_num_allocations > before_parse);
+  CHECK(fresh.count() == 1);
+}
+
+
+TEST_CASE("parse_events does not allocate")
+{
+  const argagg::compiled_parser compiled = parse_into_parser().compile();
+  std::vector<const char*> argv {
+    "test", "-v", "--output=foo", "-I", "a", "-Ib", "--include", "c", "d", "e",
+    "f"};
+
+  const std::size_t before = g_num_allocations;
+  std::size_t num_events = 0;
+  std::size_t num_positionals = 0;
+  for (const auto& event : compiled.parse_events(argv.size(),
+                                                 &(argv.front()))) {
+    ++num_events;
+    if (event.kind == argagg::parse_event_kind::positional) {
+      ++num_positionals;
+    }
+  }
+  CHECK(g_num_allocations - before == 0);
+  CHECK(num_events == 8);
+  CHECK(num_positionals == 3);
+}
+
+
+TEST_CASE("command_line splitting and parsing does not allocate")
+{
+  const argagg::compiled_parser compiled = parse_into_parser().compile();
+  argagg::parser_results args;
+  argagg::command_line cmd;
+  const std::string long_command =
+    "test -v --output='out file' -I a -Ib --include \"c d\" e\\ f g";
+  const std::string short_command = "test -I x y";
+
+  cmd.split(long_command);
+  compiled.parse_into(cmd.begin(), cmd.end(), args);
+
+  const std::size_t before = g_num_allocations;
+  for (int i = 0; i < 100; ++i) {
+    cmd.split(long_command);
+    compiled.parse_into(cmd.begin(), cmd.end(), args);
+    cmd.split(short_command);
+    compiled.parse_into(cmd.begin(), cmd.end(), args);
+  }
+  CHECK(g_num_allocations - before == 0);
+  CHECK(args["include"].as<std::string>() == "x");
+  CHECK(args.count() == 1);
+}
+
+
+TEST_CASE("try_parse does not allocate for bad command lines")
+{
+  const argagg::compiled_parser compiled = parse_into_parser().compile();
+  argagg::parser_results args;
+  std::vector<const char*> good {"test", "-v", "-o", "foo", "bar"};
+  std::vector<const char*> unknown {"test", "-v", "--unknown", "bar"};
+  std::vector<const char*> lacking {"test", "-v", "bar", "--output"};
+
+  CHECK_FALSE(compiled.try_parse(good.size(), &(good.front()), args));
+
+  const std::size_t before = g_num_allocations;
+  for (int i = 0; i < 100; ++i) {
+    CHECK(compiled.try_parse(unknown.size(), &(unknown.front()), args));
+    CHECK(compiled.try_parse(lacking.size(), &(lacking.front()), args));
+  }
+  CHECK(g_num_allocations - before == 0);
+}
+
+
+TEST_CASE("stopping at the first positional argument doesn't copy the rest")
+{
+  const argagg::compiled_parser compiled = parse_into_parser().compile();
+  std::vector<const char*> short_tail {"test", "-v", "-o", "foo", "prog"};
+  std::vector<const char*> long_tail = short_tail;
+  for (int i = 0; i < 1000; ++i) {
+    long_tail.push_back("arg");
+  }
+
+  std::size_t before = g_num_allocations;
+  argagg::parser_results short_args;
+  compiled.parse_into(short_tail.size(), &(short_tail.front()), short_args,
+                      argagg::stop_at::first_positional);
+  const std::size_t short_allocations = g_num_allocations - before;
+
+  before = g_num_allocations;
+  argagg::parser_results long_args;
+  compiled.parse_into(long_tail.size(), &(long_tail.front()), long_args,
+                      argagg::stop_at::first_positional);
+  CHECK(g_num_allocations - before == short_allocations);
+  CHECK(long_args.pos.empty());
+  CHECK(long_args.remainder.size == 1001);
+
+  before = g_num_allocations;
+  for (int i = 0; i < 100; ++i) {
+    compiled.parse_into(long_tail.size(), &(long_tail.front()), long_args,
+                        argagg::stop_at::first_positional);
+  }
+  CHECK(g_num_allocations - before == 0);
+}
+
+
+TEST_CASE("forwarding unknown options does not allocate once warmed up")
+{
+  const argagg::compiled_parser compiled = parse_into_parser().compile();
+  argagg::parser_results args;
+  std::vector<const char*> forwarded;
+  std::vector<const char*> argv {
+    "test", "-Wall", "-v", "-o", "foo", "--std=c11", "bar", "-O2"};
+
+  compiled.parse_into(argv.size(), &(argv.front()), args, forwarded,
+                      argagg::forward::unknown_options_and_positionals);
+  CHECK(forwarded.size() == 5);
+
+  const std::size_t before = g_num_allocations;
+  for (int i = 0; i < 100; ++i) {
+    forwarded.clear();
+    compiled.parse_into(argv.size(), &(argv.front()), args, forwarded,
+                        argagg::forward::unknown_options_and_positionals);
+  }
+  CHECK(g_num_allocations - before == 0);
+  CHECK(args["output"].as<std::string>() == "foo");
+}
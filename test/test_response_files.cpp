@@ -0,0 +1,150 @@
+#include "../include/argagg/argagg.hpp"
+
+#include "doctest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// Writes a response file for the duration of a test.
+struct temp_response_file {
+  std::string path;
+  temp_response_file(const std::string& path, const std::string& contents)
+  : path(path)
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << contents;
+  }
+  ~temp_response_file()
+  {
+    std::remove(this->path.c_str());
+  }
+};
+
+
+static std::vector<std::string> expanded(const argagg::response_files& args)
+{
+  std::vector<std::string> result;
+  for (const auto& arg : args) {
+    CHECK(arg.data[arg.size] == '\0');
+    result.push_back(std::string(arg.data, arg.size));
+  }
+  return result;
+}
+
+
+TEST_CASE("response files")
+{
+  SUBCASE("whitespace, quotes and escapes") {
+    const temp_response_file file("argagg_rsp_quotes.txt",
+      "-v\n  --output 'out file'\t\"a \\\"b\\\"\" c\\ d ''\r\ne");
+    std::vector<const char*> argv {"test", "x", "@argagg_rsp_quotes.txt", "y"};
+    const argagg::response_files args(argv.size(), &(argv.front()));
+    const std::vector<std::string> expected {
+      "test", "x", "-v", "--output", "out file", "a \"b\"", "c d", "", "e", "y"};
+    CHECK(expanded(args) == expected);
+    CHECK(args.size() == expected.size());
+  }
+
+  SUBCASE("null delimited") {
+    const temp_response_file file("argagg_rsp_null.txt",
+      std::string("a b\0--c\0d", 9));
+    std::vector<const char*> argv {"test", "@argagg_rsp_null.txt"};
+    const argagg::response_files args(argv.size(), &(argv.front()));
+    const std::vector<std::string> expected {"test", "a b", "--c", "d"};
+    CHECK(expanded(args) == expected);
+  }
+
+  SUBCASE("trailing null") {
+    const temp_response_file file("argagg_rsp_null.txt",
+      std::string("a\0b\0", 4));
+    std::vector<const char*> argv {"test", "@argagg_rsp_null.txt"};
+    const argagg::response_files args(argv.size(), &(argv.front()));
+    const std::vector<std::string> expected {"test", "a", "b"};
+    CHECK(expanded(args) == expected);
+  }
+
+  SUBCASE("nested") {
+    const temp_response_file inner("argagg_rsp_inner.txt", "b c");
+    const temp_response_file outer("argagg_rsp_outer.txt",
+      "a @argagg_rsp_inner.txt d");
+    std::vector<const char*> argv {"test", "@argagg_rsp_outer.txt", "e"};
+    const argagg::response_files args(argv.size(), &(argv.front()));
+    const std::vector<std::string> expected {"test", "a", "b", "c", "d", "e"};
+    CHECK(expanded(args) == expected);
+  }
+
+  SUBCASE("empty file") {
+    const temp_response_file file("argagg_rsp_empty.txt", "");
+    std::vector<const char*> argv {"test", "@argagg_rsp_empty.txt", "a"};
+    const argagg::response_files args(argv.size(), &(argv.front()));
+    const std::vector<std::string> expected {"test", "a"};
+    CHECK(expanded(args) == expected);
+  }
+
+  SUBCASE("missing files are kept") {
+    std::vector<const char*> argv {
+      "@test", "@argagg_rsp_missing.txt", "@", "user@example.com"};
+    const argagg::response_files args(argv.size(), &(argv.front()));
+    const std::vector<std::string> expected {
+      "@test", "@argagg_rsp_missing.txt", "@", "user@example.com"};
+    CHECK(expanded(args) == expected);
+    CHECK(args.begin()[1].data == argv[1]);
+  }
+
+  SUBCASE("recursion is limited") {
+    const temp_response_file file("argagg_rsp_loop.txt",
+      "a @argagg_rsp_loop.txt");
+    std::vector<const char*> argv {"test", "@argagg_rsp_loop.txt"};
+    CHECK_THROWS_AS({
+      argagg::response_files args(argv.size(), &(argv.front()));
+    }, const argagg::response_file_error&);
+  }
+
+  SUBCASE("last argument ending on a page boundary") {
+    // Fill whole pages so the last argument has no room for a terminator
+    // in the mapping.
+    for (const std::size_t size : {4096u, 16384u, 65536u}) {
+      std::string contents(size - 4, 'x');
+      contents[size / 2] = ' ';
+      contents += " end";
+      const temp_response_file file("argagg_rsp_page.txt", contents);
+      std::vector<const char*> argv {"test", "@argagg_rsp_page.txt"};
+      const argagg::response_files args(argv.size(), &(argv.front()));
+      const auto result = expanded(args);
+      REQUIRE(result.size() == 4);
+      CHECK(result[3] == "end");
+    }
+  }
+
+  SUBCASE("moved") {
+    const temp_response_file file("argagg_rsp_move.txt", "a b");
+    std::vector<const char*> argv {"test", "@argagg_rsp_move.txt"};
+    argagg::response_files args(argv.size(), &(argv.front()));
+    argagg::response_files moved(std::move(args));
+    const std::vector<std::string> expected {"test", "a", "b"};
+    CHECK(expanded(moved) == expected);
+    argagg::response_files assigned(0, static_cast<const char**>(nullptr));
+    assigned = std::move(moved);
+    CHECK(expanded(assigned) == expected);
+  }
+
+  SUBCASE("parse") {
+    const temp_response_file file("argagg_rsp_parse.txt",
+      "-v --output=foo\nbar '--not an option'");
+    const argagg::compiled_parser compiled {{
+        {"verbose", {"-v", "--verbose"}, "be verbose", 0},
+        {"output", {"-o", "--output"}, "output file", 1},
+      }};
+    std::vector<const char*> argv {"test", "@argagg_rsp_parse.txt", "baz"};
+    const argagg::response_files args(argv.size(), &(argv.front()));
+    const auto results = compiled.parse(args.begin(), args.end());
+    CHECK(results["verbose"].count() == 1);
+    CHECK(results["output"].as<std::string>() == "foo");
+    REQUIRE(results.count() == 3);
+    CHECK(results.pos[1] == std::string("--not an option"));
+    CHECK(results.pos[2] == argv[2]);
+  }
+}